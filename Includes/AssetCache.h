@@ -0,0 +1,85 @@
+// AssetCache.h
+// Process-wide cache of bitmaps loaded from disk, keyed by path. Every
+// Sprite made from an already loaded file shares the same GDI bitmap; the
+// bitmap is freed when the last holder and the cache have let go of it.
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include "main.h"
+#include "ImageFile.h"
+#include "BmpCodec.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CBitmapAsset
+{
+public:
+	explicit CBitmapAsset(HBITMAP hBitmap);
+	~CBitmapAsset();
+
+	// Maps a file and reads only its headers; the bitmap is made from the
+	// mapped pages the first time it is asked for. NULL if unreadable.
+	static CBitmapAsset *mapFile(const char *szFileName);
+
+	// The bitmap, decoding a mapped file first; 0 if that fails
+	HBITMAP getBitmap();
+	bool isDecoded() const { return mhBitmap != 0; }
+
+	// Width and height are known before decoding, the rest only after
+	const BITMAP &getInfo() const { return mInfo; }
+
+	// Monochrome mask of the whole bitmap for a colour key: 1 where the
+	// pixel is transparent, 0 where it is drawn. Built on first request and
+	// kept for as long as the bitmap, so all sprites using it share it.
+	HBITMAP getMask(COLORREF crTransparent);
+
+private:
+	CBitmapAsset();
+	CBitmapAsset(const CBitmapAsset&);
+	CBitmapAsset& operator=(const CBitmapAsset&);
+
+	bool decode();
+
+	HBITMAP mhBitmap;
+	BITMAP mInfo;
+
+	// File of a mapped asset, open until it is decoded
+	CMappedFile mMapping;
+	SBmpLayout mLayout;
+
+	// Built masks and the colour key of each (in practice there is one)
+	std::vector<std::pair<COLORREF, HBITMAP> > mMasks;
+};
+
+typedef std::shared_ptr<CBitmapAsset> BitmapAssetPtr;
+
+class CAssetCache
+{
+public:
+	static CAssetCache &instance();
+
+	// Returns the shared bitmap for a file, loading it on first use only.
+	// ELM_MAPPED leaves the pixels on disk until something draws them, for
+	// bitmaps that are seldom or never shown. NULL when the file cannot be
+	// loaded (failures are not cached).
+	BitmapAssetPtr loadBitmap(const char *szFileName, ELoadMode eMode = ELM_IMMEDIATE);
+
+	// Drops cached bitmaps no sprite is using any more
+	void trim();
+
+	// Forgets everything; bitmaps still held by sprites stay alive until they go
+	void clear();
+
+	size_t getCount() const { return mBitmaps.size(); }
+
+private:
+	CAssetCache() {}
+	CAssetCache(const CAssetCache&);
+	CAssetCache& operator=(const CAssetCache&);
+
+	std::unordered_map<std::string, BitmapAssetPtr> mBitmaps;
+};
+
+#endif // ASSETCACHE_H
@@ -0,0 +1,54 @@
+#pragma once
+// AtlasIndex.h
+// Binary index of a packed sprite atlas: which page and rectangle every
+// original bitmap ended up in, plus its transparent colour key. Shared by
+// the offline packer (Tools/AtlasPacker) and the runtime CSpriteAtlas.
+//
+// File layout, all integers little endian:
+//	DWORD magic ('ATLS'), DWORD version, DWORD page count, DWORD entry count
+//	page count x  { WORD length, char name[length] }	page bitmaps, relative to the index
+//	entry count x { WORD length, char name[length], WORD page,
+//					WORD left, WORD top, WORD width, WORD height, DWORD colour key }
+#include "PlatformTypes.h"
+#include <string>
+#include <vector>
+
+#define ATLAS_MAGIC		0x534C5441	// "ATLS"
+#define ATLAS_VERSION	1
+
+struct SAtlasEntry
+{
+	std::string strName;		// normalized path of the source bitmap
+	WORD uPage;
+	RECT rcSource;				// right / bottom exclusive
+	COLORREF crTransparent;
+};
+
+class CAtlasIndex
+{
+public:
+	bool Load(const char *szFileName);
+	bool Save(const char *szFileName) const;
+	void Clear();
+
+	// Page bitmaps are stored relative to the index file
+	WORD AddPage(const std::string &strPage);
+	void AddEntry(const SAtlasEntry &entry);
+
+	size_t GetPageCount() const { return m_Pages.size(); }
+	const std::string &GetPage(size_t uPage) const { return m_Pages[uPage]; }
+
+	size_t GetEntryCount() const { return m_Entries.size(); }
+	const SAtlasEntry &GetEntry(size_t uEntry) const { return m_Entries[uEntry]; }
+
+	// Finds the entry for a bitmap path as the game spells it
+	const SAtlasEntry *Find(const char *szName) const;
+
+	// Lower case, forward slashes, no leading "./"
+	static std::string NormalizeName(const char *szName);
+
+private:
+	std::vector<std::string> m_Pages;
+	// kept sorted by name
+	std::vector<SAtlasEntry> m_Entries;
+};
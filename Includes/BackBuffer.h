@@ -4,6 +4,9 @@
 #ifndef BACKBUFFER_H
 #define BACKBUFFER_H
 #include "main.h"
+#include "Framebuffer.h"
+#include <vector>
+#include <unordered_map>
 
 class BackBuffer
 {
@@ -11,12 +14,39 @@ public:
 	BackBuffer(HWND hWnd, int width, int height);
 	~BackBuffer();
 
+	// Only the dirty region is touched: reset() clears it and clips all
+	// drawing on getDC() to it, present() copies it to the window and
+	// leaves the back buffer clean again.
 	void present();
 	void reset();
 
+	void invalidate(const RECT &rc);
+	void invalidateAll();
+	bool isDirty() const { return !mDirty.empty(); }
+	bool isVisible(const RECT &rc) const;
+	const std::vector<RECT> &getDirtyRects() const { return mDirty; }
+
+	// Marks the dirty region clean without copying it anywhere (offscreen
+	// buffers that are never presented)
+	void validate();
+
+	// Colour reset() clears to, white unless changed
+	void setClearColor(COLORREF cr) { mClearPixel = ColorRefToPixel(cr); }
+
+	// Retained frame bookkeeping. Every item drawn in a frame reports where
+	// it draws (rcBounds) and what it draws there (an image and the source
+	// position in it). Items that move or change, appear or disappear
+	// invalidate their old and new bounds; endTracking() closes the frame.
+	void track(const void *pItem, const RECT &rcBounds, const void *pImage, POINT ptSource);
+	void endTracking();
+
 	HDC getDC() const { return mhDC; }
 	HWND getHWND() const { return mhWnd; }
 
+	// CPU view of the surface pixels (top-down, 32 bits per pixel). Call
+	// GdiFlush() before touching it after GDI drawing into getDC().
+	CFramebuffer &getFramebuffer() { return mFramebuffer; }
+
 	int width() const { return mWidth; }
 	int height() const { return mHeight; }
 
@@ -31,12 +61,30 @@ private:
 	BackBuffer(const BackBuffer& rhs);
 	BackBuffer& operator=(const BackBuffer& rhs);
 
+private:
+	struct SDrawRecord
+	{
+		RECT rcBounds;
+		const void *pImage;
+		POINT ptSource;
+		ULONG uFrame;		// last frame the item was tracked in
+	};
+
+	// Past this many disjoint rectangles the region becomes their bounding box
+	enum { MAX_DIRTY_RECTS = 32 };
+
 private:
 	HWND mhWnd;
 	HDC mhDC;
 	HBITMAP mhSurface;
 	HBITMAP mhOldObject;
+	CFramebuffer mFramebuffer;
 	int mWidth;
 	int mHeight;
+	DWORD mClearPixel;
+
+	std::vector<RECT> mDirty;			// disjoint dirty rectangles
+	std::unordered_map<const void*, SDrawRecord> mDrawn;
+	ULONG mTrackFrame;
 };
 #endif // BACKBUFFER_H
\ No newline at end of file
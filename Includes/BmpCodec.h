@@ -0,0 +1,128 @@
+#pragma once
+// BmpCodec.h
+// Platform independent BMP reader / writer. Handles uncompressed 8-bit
+// palettized, 24-bit and 32-bit files stored bottom-up or top-down, and
+// decodes straight into bottom-up RGBQUAD rows, the layout CImageFile keeps
+// in m_pRGB (the same rows GetDIBits returns for a positive height).
+#include "PlatformTypes.h"
+#include <stdio.h>
+
+enum EBmpResult
+{
+	EBR_OK,
+	EBR_IOERROR,		// file could not be opened, read or written
+	EBR_BADFORMAT,		// not a BMP or truncated
+	EBR_UNSUPPORTED		// valid BMP in a format we do not decode (RLE, 16-bit, ...)
+};
+
+// Size of BITMAPFILEHEADER on disk
+#define BMP_FILEHEADER_SIZE	14
+
+// Everything needed to find and convert the pixel rows of a BMP file
+struct SBmpLayout
+{
+	LONG lWidth;
+	LONG lHeight;			// always positive, see bTopDown
+	bool bTopDown;			// first stored row is the top one
+	WORD uBitCount;			// 8, 24 or 32
+	DWORD uPixelOffset;		// offset of the first stored row from the file start
+	DWORD uStride;			// bytes per stored row, padded to 4
+	DWORD uColors;			// palette entries, 8-bit only
+	RGBQUAD Palette[256];
+};
+
+// Parses the file and info headers (and palette) at the start of a BMP.
+// uSize is the number of bytes available, the whole file when known.
+EBmpResult BmpParse(const BYTE *pFile, size_t uSize, SBmpLayout &layout);
+
+// Returns the stored row that holds bottom-up row y (0 = bottom)
+inline LONG BmpStoredRow(const SBmpLayout &layout, LONG y)
+{
+	return layout.bTopDown ? layout.lHeight - 1 - y : y;
+}
+
+// Converts one stored row into lWidth RGBQUAD pixels
+void BmpConvertRow(const SBmpLayout &layout, const BYTE *pRow, RGBQUAD *pDst);
+
+// Decodes an in-memory file into lWidth * lHeight bottom-up pixels
+EBmpResult BmpDecode(const BYTE *pFile, size_t uSize, const SBmpLayout &layout, RGBQUAD *pDst);
+
+// Describes lWidth x lHeight bottom-up RGBQUAD pixels as a 32-bit DIB
+void BmpMakeInfoHeader(LONG lWidth, LONG lHeight, BITMAPINFOHEADER &bi);
+
+// True when the stored rows already are bottom-up RGBQUADs, so the pixel
+// data of a file in memory can be used in place
+inline bool BmpIsNativeLayout(const SBmpLayout &layout)
+{
+	return layout.uBitCount == 32 && !layout.bTopDown;
+}
+
+// Reads a BMP from disk. On success pPixels is a new[] buffer of
+// bottom-up pixels and bi describes it as a 32-bit bottom-up DIB.
+EBmpResult BmpLoadFile(const char *szFileName, BITMAPINFOHEADER &bi, RGBQUAD *&pPixels);
+
+// Writes bottom-up pixels as a 24 or 32-bit BMP
+EBmpResult BmpSaveFile(const char *szFileName, const RGBQUAD *pPixels, LONG lWidth, LONG lHeight, WORD uBitCount = 24);
+
+// Reads a BMP one row at a time, bottom row first, so consumers such as
+// CStreamingResampler never need the whole image in memory. Bottom-up files
+// are read front to back, top-down ones seek to every row.
+class CBmpReader
+{
+public:
+	CBmpReader();
+	~CBmpReader();
+
+	// Parses the headers, GetLayout() then has the size and format
+	EBmpResult Open(const char *szFileName);
+
+	// Reads and converts the next lWidth pixels
+	EBmpResult ReadRow(RGBQUAD *pRow);
+
+	void Close();
+
+	bool IsOpen() const { return m_pFile != NULL; }
+	const SBmpLayout &GetLayout() const { return m_Layout; }
+
+private:
+	CBmpReader(const CBmpReader&);
+	CBmpReader& operator=(const CBmpReader&);
+
+	FILE *m_pFile;
+	SBmpLayout m_Layout;
+	LONG m_lRowsRead;
+	LONG m_lNextStored;		// stored row the file position is at
+	BYTE *m_pRowBuffer;
+};
+
+// Writes a BMP one row at a time, so producers such as
+// CStreamingResampler never need the whole image in memory.
+class CBmpWriter
+{
+public:
+	CBmpWriter();
+	~CBmpWriter();
+
+	// Rows are then expected bottom row first, or top row first if bTopDown
+	EBmpResult Open(const char *szFileName, LONG lWidth, LONG lHeight, WORD uBitCount = 24, bool bTopDown = false);
+
+	// Appends the next lWidth pixels
+	EBmpResult WriteRow(const RGBQUAD *pRow);
+
+	// Fails if fewer rows than announced were written
+	EBmpResult Close();
+
+	bool IsOpen() const { return m_pFile != NULL; }
+
+private:
+	CBmpWriter(const CBmpWriter&);
+	CBmpWriter& operator=(const CBmpWriter&);
+
+	FILE *m_pFile;
+	LONG m_lWidth;
+	LONG m_lHeight;
+	LONG m_lRowsWritten;
+	WORD m_uBitCount;
+	DWORD m_uStride;
+	BYTE *m_pRowBuffer;
+};
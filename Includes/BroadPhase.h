@@ -0,0 +1,64 @@
+#pragma once
+// BroadPhase.h
+// Uniform grid over axis aligned boxes for collision queries. The grid is
+// rebuilt from scratch every tick: Clear(), Insert() every box, Build(),
+// then any number of queries. Boxes are identified by the index the caller
+// inserted them with (typically their position in its own array).
+#include <vector>
+#include <cstddef>
+
+struct SAabb
+{
+	double left, top, right, bottom;
+};
+
+class CBroadPhase
+{
+public:
+	CBroadPhase();
+
+	// dCellSize should be about the size of the larger objects
+	void SetCellSize(double dCellSize) { m_dCellSize = dCellSize; }
+
+	void Clear();
+	void Insert(unsigned int uId, const SAabb &box);
+
+	// Sizes the grid to the inserted boxes and bins them
+	void Build();
+
+	// Ids of the boxes overlapping box (open intervals, touching edges do not
+	// count), in increasing id order
+	void QueryBox(const SAabb &box, std::vector<unsigned int> &ids) const;
+
+	// Ids of the boxes containing the point (closed intervals), in
+	// increasing id order
+	void QueryPoint(double x, double y, std::vector<unsigned int> &ids) const;
+
+	size_t GetCount() const { return m_Boxes.size(); }
+	const SAabb &GetBox(size_t uIndex) const { return m_Boxes[uIndex]; }
+	unsigned int GetId(size_t uIndex) const { return m_Ids[uIndex]; }
+
+private:
+	// Cell range covered by a box, clamped to the grid
+	void CellRange(const SAabb &box, int &x0, int &y0, int &x1, int &y1) const;
+	void Gather(const SAabb &box, bool bPoint, std::vector<unsigned int> &ids) const;
+
+	double m_dCellSize;
+
+	// inserted boxes
+	std::vector<SAabb> m_Boxes;
+	std::vector<unsigned int> m_Ids;
+
+	// grid placement
+	double m_dOriginX, m_dOriginY;
+	double m_dCell;				// actual cell size, grows for very large areas
+	int m_nColumns, m_nRows;
+
+	// boxes of cell c are m_CellItems[m_CellStart[c] .. m_CellStart[c + 1])
+	std::vector<unsigned int> m_CellStart;
+	std::vector<unsigned int> m_CellItems;
+
+	// per box stamp so a box spanning several cells is reported once
+	mutable std::vector<unsigned int> m_Stamp;
+	mutable unsigned int m_uQuery;
+};
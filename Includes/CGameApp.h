@@ -19,7 +19,14 @@
 #include "ImageFile.h"
 #include "ScoreSprite.h"
 #include "MenuSprite.h"
+#include "SpriteAtlas.h"
+#include "RenderLayer.h"
+#include "ObjectPool.h"
+#include "Simulation.h"
+#include "InputLog.h"
+#include "LevelFile.h"
 #include <string>
+#include <vector>
 using namespace std;
 
 //-----------------------------------------------------------------------------
@@ -33,8 +40,10 @@ using namespace std;
 //-----------------------------------------------------------------------------
 // Name : CGameApp (Class)
 // Desc : Central game engine, initialises the game and handles core processes.
+//		The rules live in CSimulation, the app is its window, keyboard,
+//		speakers and screen.
 //-----------------------------------------------------------------------------
-class CGameApp
+class CGameApp : public CSimInput, public CSimAudio, public CSimRenderer
 {
 public:
 	//-------------------------------------------------------------------------
@@ -51,6 +60,11 @@ public:
 	int		 BeginGame( );
 	bool		ShutDown( );
 
+	// CSimulation callbacks
+	unsigned int GetButtons( int nPlayer );
+	void		PlayEffect( ESimSound eSound );
+	void		DrawObject( ESimObject eObject, unsigned int uVariant, double x, double y );
+
 	enum GameState {
 		START,
 		ONGOING,
@@ -58,15 +72,9 @@ public:
 		WON,
 		PAUSE
 	};
-	enum Levels {
-		LEVEL1,
-		LEVEL2,
-		LEVEL3,
-		LEVEL4,
-		LEVEL5
-	};
 
 	BackBuffer*				m_pBBuffer;
+	RenderLayer*			m_pHudLayer;		// Lives, scores and labels, drawn over everything
 	
 private:
 	//-------------------------------------------------------------------------
@@ -78,23 +86,29 @@ private:
 	bool		CreateDisplay	 ( );
 	void		SetupGameState	( );
 	void		AnimateObjects	( );
-	void		DrawObjects	   ( );
+	void		DrawObjects	   ( double alpha );
+	void		StepSimulation	( );
 	void		ProcessInput	  ( );
-	void		addEnemies(int nrEnemies, int timeVelocity, int velocity);
-	void		removeDead();
-	bool		CollisionPlayer1();
-	bool		CollisionPlayer2();
-	bool		bulletCollision(const Sprite& bullet, CPlayer& p1);
-	void		fireBullet(const Vec2 position, const Vec2 velocity);
-	bool		detectBulletCollision(const Sprite* bullet);
 	void		setPLives(int livesP1, int livesP2);
 	void		updateGameState();
 	void		scrollingBackground(int speed);
 	void		saveGame();
 	void		loadGame();
-	void		addPowerUp(int powerUp);
-	bool		powerUpCollision(Sprite* powerUp, CPlayer* p1);
-	bool		CollisionEnemy(CPlayer* enemy);
+	void		queueLives(list<Sprite*>& hearts, int lives);
+	bool		loadLevels();
+	Sprite*		loadLabel(const string& strBitmap);
+	void		queueLevelLabel();
+	Sprite*		getPowerUpSprite(unsigned int id);
+	void		growPools(size_t cars, size_t bullets, size_t explosions);
+	void		sizePools();
+	void		configureSimulation();
+	void		startSession(const SSimSave* pSave, bool bEndless);
+	void		startReplay(LPCTSTR szFileName);
+	void		endSession();
+	void		queueSprite(Sprite* pSprite);
+	void		queueScore(ScoreSprite* pScore);
+	void		queueImage(CImageFile* pImage, int y);
+	void		queueLayer(RenderLayer* pLayer);
 
 	
 	//-------------------------------------------------------------------------
@@ -107,6 +121,7 @@ private:
 	//-------------------------------------------------------------------------
 	CTimer				  m_Timer;			// Game timer
 	ULONG				   m_LastFrameRate;	// Used for making sure we update only when fps changes.
+	float					m_fAccumulator;		// Frame time not yet simulated
 	
 	HWND					m_hWnd;			 // Main window HWND
 	HICON				   m_hIcon;			// Window Icon
@@ -125,10 +140,42 @@ private:
 
 	CImageFile				m_imgBackground;
 	CImageFile				m_imgBackgroundMenu;
+	CSpriteAtlas			m_spriteAtlas;
+	int						m_nBackgroundY;		// Scroll offset of m_imgBackground
+	DWORD					m_nBackgroundTime;	// Tick count of the last scroll step
+
+	// What DrawObjects shows this frame, in drawing order
+	struct DrawItem
+	{
+		Sprite*				pSprite;		// sprite to draw, or
+		CImageFile*			pImage;			// full screen image painted at nImageY, or
+		RenderLayer*		pLayer;			// layer to composite
+		int					nImageY;
+		RECT				rcBounds;
+	};
+	vector<DrawItem>		m_drawList;
 
 	CPlayer*				m_pPlayer;
 	CPlayer*				m_pPlayer2;
-	list<CPlayer*>			m_enemies;
+
+	// The game itself. The players above are only drawn for it.
+	CSimulation				m_sim;
+	unsigned int			m_buttons[SIM_PLAYERS];	// Held for the next step
+	CInputRecorder			m_recorder;			// Logs the buttons of every step
+	CInputReplay			m_replay;			// Steps of a recorded session
+	bool					m_bReplay;			// m_replay drives the simulation
+	bool					m_bEndless;			// Playing the infinite road
+	SLevelFile				m_levelFile;		// data/levels.txt
+
+	// Sprites lent to the simulation's objects, taken back every frame
+	CObjectPool<Sprite>		m_carPools[ESC_COUNT];
+	CObjectPool<Sprite>		m_bulletPool;
+	CObjectPool<AnimatedSprite>	m_explosionPool;
+
+	// Sprites the last frame asked each pool for
+	size_t					m_carDemand[ESC_COUNT];
+	size_t					m_bulletDemand;
+	size_t					m_explosionDemand;
 
 	list<Sprite*>			m_livesGreen;		// Lives for green player
 	list<Sprite*>			m_livesRed;		// Lives for green player
@@ -136,21 +183,16 @@ private:
 	ScoreSprite*			m_scoreP1;			// Score for the player 1
 	ScoreSprite*			m_scoreP2;			// Score for the player 1
 
-	list<Sprite*>			bullets;
 	int						frameCounter = 0;
 
 	list<Sprite*>				p1Life;
 	list<Sprite*>				p2Life;
 
 	GameState					m_gameState;			// Game state (ongoing, won, lost)
-	Levels						m_levels;
 	Sprite*						m_wonSprite;			// Information to be displayed when game is won
 	Sprite*						m_lostSprite;		// Information to be displayed when game is lost
-	Sprite*						m_level1Text;
-	Sprite*						m_level2Text;
-	Sprite*						m_level3Text;
-	Sprite*						m_level4Text;
-	Sprite*						m_level5Text;
+	vector<Sprite*>				m_levelLabels;		// HUD text of each listed level, NULL if it has none
+	Sprite*						m_endlessLabel;
 
 	Sprite*						livesText;
 	Sprite*						scoreText;
@@ -171,7 +213,6 @@ private:
 	Sprite*						shieldPower;
 
 	MenuSprite*					gameMenu;
-	string						levelForSave;
 
 
 
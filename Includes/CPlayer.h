@@ -57,6 +57,7 @@ public:
 	//-------------------------------------------------------------------------
 	void					Update( float dt );
 	void					Draw();
+	Sprite*					GetDrawSprite();
 	void					Move(ULONG ulDirection);
 	Vec2&					Position();
 	Vec2&					Velocity();
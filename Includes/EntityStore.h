@@ -0,0 +1,117 @@
+#pragma once
+// EntityStore.h
+// Data oriented storage for the simulated objects (traffic, bullets,
+// power-ups). Every attribute lives in its own contiguous array indexed by a
+// dense entity index, so per tick passes are plain loops over arrays.
+// Entities are referred to from outside through handles made of a slot and a
+// generation: slots never move, dense indices do (removal swaps the last
+// entity into the hole), and a handle to a destroyed entity stops resolving
+// once its slot is reused.
+#include "BroadPhase.h"
+#include <vector>
+#include <cstddef>
+
+enum EEntityKind
+{
+	EEK_CAR,
+	EEK_BULLET,
+	EEK_POWERUP,
+	EEK_COUNT
+};
+
+// State flags
+#define EEF_DEAD		0x0001		// to be removed
+#define EEF_EXPLODING	0x0002		// frozen while its explosion plays
+
+struct SEntityHandle
+{
+	unsigned int uSlot;
+	unsigned int uGeneration;		// 0 is never issued
+};
+
+class CEntityStore
+{
+public:
+	CEntityStore();
+
+	static SEntityHandle InvalidHandle();
+
+	SEntityHandle Create(EEntityKind eKind, double x, double y, double vx, double vy,
+		double dHalfWidth, double dHalfHeight, unsigned int uVariant);
+	void Destroy(SEntityHandle h);
+	void DestroyAt(size_t uIndex);
+	void Clear();
+
+	// Destroys every entity with uFlag set in one pass. The survivors keep
+	// their relative order. Returns the number destroyed.
+	size_t RemoveFlagged(unsigned int uFlag);
+
+	bool IsValid(SEntityHandle h) const;
+	// Dense index of a valid handle
+	size_t IndexOf(SEntityHandle h) const { return m_SlotIndex[h.uSlot]; }
+	// Dense index of the live entity in a slot
+	size_t IndexOfSlot(unsigned int uSlot) const { return m_SlotIndex[uSlot]; }
+	unsigned int SlotAt(size_t uIndex) const { return m_Slot[uIndex]; }
+	SEntityHandle HandleAt(size_t uIndex) const;
+
+	size_t GetCount() const { return m_Kind.size(); }
+	size_t CountOf(EEntityKind eKind) const { return m_KindCount[eKind]; }
+
+	// Per entity attributes, by dense index
+	double &PosX(size_t i) { return m_PosX[i]; }
+	double &PosY(size_t i) { return m_PosY[i]; }
+	double &VelX(size_t i) { return m_VelX[i]; }
+	double &VelY(size_t i) { return m_VelY[i]; }
+	double PosX(size_t i) const { return m_PosX[i]; }
+	double PosY(size_t i) const { return m_PosY[i]; }
+	double VelX(size_t i) const { return m_VelX[i]; }
+	double VelY(size_t i) const { return m_VelY[i]; }
+	double PrevX(size_t i) const { return m_PrevX[i]; }
+	double PrevY(size_t i) const { return m_PrevY[i]; }
+	double HalfWidth(size_t i) const { return m_HalfW[i]; }
+	double HalfHeight(size_t i) const { return m_HalfH[i]; }
+	unsigned int &Flags(size_t i) { return m_Flags[i]; }
+	unsigned int Flags(size_t i) const { return m_Flags[i]; }
+	// Seconds into the current effect (explosion), starts at 0
+	double &Timer(size_t i) { return m_Timer[i]; }
+	double Timer(size_t i) const { return m_Timer[i]; }
+	EEntityKind Kind(size_t i) const { return (EEntityKind)m_Kind[i]; }
+	// Which model of its kind the entity is
+	unsigned int Variant(size_t i) const { return m_Variant[i]; }
+
+	SAabb GetBox(size_t i) const;
+
+	// Remembers the current positions as the previous state, call before
+	// each simulation step so drawing can interpolate between the two
+	void SaveState();
+
+	// Advances every entity by its velocity
+	void Integrate(double dt);
+
+	// Sets uFlag on entities of a kind whose bottom edge reaches dLimitY
+	void FlagBelow(EEntityKind eKind, double dLimitY, unsigned int uFlag);
+
+	// Inserts the boxes of the live entities of one kind into the grid. Ids
+	// are slots, so they survive other entities being destroyed before the
+	// grid is queried.
+	void FillBroadPhase(EEntityKind eKind, CBroadPhase &broadPhase) const;
+
+private:
+	// dense arrays
+	std::vector<double> m_PosX, m_PosY;
+	std::vector<double> m_PrevX, m_PrevY;		// positions before the last step
+	std::vector<double> m_VelX, m_VelY;
+	std::vector<double> m_HalfW, m_HalfH;
+	std::vector<unsigned int> m_Flags;
+	std::vector<double> m_Timer;
+	std::vector<unsigned char> m_Kind;
+	std::vector<unsigned int> m_Variant;
+	std::vector<unsigned int> m_Slot;			// dense index -> slot
+
+	// slot table
+	std::vector<unsigned int> m_SlotIndex;		// slot -> dense index
+	std::vector<unsigned int> m_SlotGeneration;
+	std::vector<unsigned int> m_FreeSlots;
+
+	size_t m_KindCount[EEK_COUNT];
+};
@@ -5,6 +5,16 @@
 #define FILTER_2PI double (2.0 * FILTER_PI)
 #define FILTER_4PI double (4.0 * FILTER_PI)
 
+// Identifies a filter kind, together with GetWidth / GetParams this is
+// enough to tell whether two filters produce the same weights
+enum EFilterType
+{
+	EFT_BOX,
+	EFT_BILINEAR,
+	EFT_BICUBIC,
+	EFT_LANCZOS3,
+	EFT_BSPLINE
+};
 
 class CGenericFilter
 {
@@ -20,6 +30,10 @@ public:
 	void   SetWidth (double dWidth)		{ m_dWidth = dWidth; }
 
 	virtual double Filter (double dVal) = 0;
+	virtual EFilterType GetType() = 0;
+
+	// Shape parameters besides the width (only the bicubic filter has any)
+	virtual void GetParams(double &dParam0, double &dParam1) { dParam0 = dParam1 = 0; }
 };
 
 class CBoxFilter : public CGenericFilter
@@ -29,6 +43,7 @@ public:
 	virtual ~CBoxFilter() {}
 
 	double Filter (double dVal) { return (fabs(dVal) <= m_dWidth ? 1.0 : 0.0); }
+	EFilterType GetType() { return EFT_BOX; }
 };
 
 class CBilinearFilter : public CGenericFilter
@@ -42,17 +57,21 @@ public:
 		dVal = fabs(dVal);
 		return (dVal < m_dWidth ? m_dWidth - dVal : 0.0);
 	}
+	EFilterType GetType() { return EFT_BILINEAR; }
 };
 
 class CBicubicFilter : public CGenericFilter
 {
 protected:
+	double m_b, m_c;
 	double p0, p2, p3;
 	double q0, q1, q2, q3;
 
 public:
 
 	CBicubicFilter (double b = (1/(double)3), double c = (1/(double)3)) : CGenericFilter(2) {
+		m_b = b;
+		m_c = c;
 		p0 = (6 - 2*b) / 6;
 		p2 = (-18 + 12*b + 6*c) / 6;
 		p3 = (12 - 9*b - 6*c) / 6;
@@ -71,6 +90,8 @@ public:
 			return (q0 + dVal*(q1 + dVal*(q2 + dVal*q3)));
 		return 0;
 	}
+	EFilterType GetType() { return EFT_BICUBIC; }
+	void GetParams(double &dParam0, double &dParam1) { dParam0 = m_b; dParam1 = m_c; }
 };
 
 class CLanczos3Filter : public CGenericFilter
@@ -86,6 +107,7 @@ public:
 		}
 		return 0;
 	}
+	EFilterType GetType() { return EFT_LANCZOS3; }
 
 private:
 	double sinc(double value) {
@@ -113,4 +135,5 @@ public:
 		}
 		return 0;
 	}
+	EFilterType GetType() { return EFT_BSPLINE; }
 };
\ No newline at end of file
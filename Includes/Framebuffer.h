@@ -0,0 +1,123 @@
+#pragma once
+// Framebuffer.h
+// Portable CPU render target: a top-down array of 32-bit pixels (the
+// RGBQUAD / BI_RGB layout, 0x00RRGGBB in a DWORD) with a pitch and a clip
+// rectangle, plus sprites stored as run-length encoded opaque spans so the
+// colour key never has to be tested while drawing.
+#include "PlatformTypes.h"
+#include <vector>
+
+// Colour key used by every sprite bitmap in Data/
+#define SPRITE_COLOR_KEY	RGB(0xff, 0x00, 0xff)
+
+// COLORREF is 0x00BBGGRR, framebuffer pixels are 0x00RRGGBB
+inline DWORD ColorRefToPixel(COLORREF cr)
+{
+	return ((DWORD)GetRValue(cr) << 16) | ((DWORD)GetGValue(cr) << 8) | GetBValue(cr);
+}
+
+inline DWORD QuadToPixel(const RGBQUAD &q)
+{
+	return ((DWORD)q.rgbRed << 16) | ((DWORD)q.rgbGreen << 8) | q.rgbBlue;
+}
+
+class CFramebuffer;
+
+// Sprite image reduced to its opaque pixels, row by row
+class CRleSprite
+{
+public:
+	CRleSprite();
+
+	// pPixels holds lWidth * lHeight pixels, bottom-up when bBottomUp (as
+	// BmpLoadFile / CImageFile keep them). Pixels equal to crKey are dropped.
+	void Build(const RGBQUAD *pPixels, LONG lWidth, LONG lHeight, bool bBottomUp, COLORREF crKey = SPRITE_COLOR_KEY);
+
+	// Same from the whole surface of a framebuffer (e.g. a rendered layer)
+	void Build(const CFramebuffer &source, COLORREF crKey = SPRITE_COLOR_KEY);
+
+	LONG Width() const { return m_lWidth; }
+	LONG Height() const { return m_lHeight; }
+
+	// Number of opaque pixels
+	size_t OpaqueCount() const { return m_Pixels.size(); }
+
+	// Smallest rectangle holding every opaque pixel; false when there are none
+	bool GetOpaqueBounds(RECT &rc) const;
+
+private:
+	friend class CFramebuffer;
+
+	struct SSpan
+	{
+		WORD uX;			// first pixel of the span in its row
+		WORD uLength;
+		DWORD uPixel;		// index of the span's first pixel in m_Pixels
+	};
+
+	void Reset(LONG lWidth, LONG lHeight);
+	void AddRow(const DWORD *pRow, DWORD uKey);
+
+	LONG m_lWidth;
+	LONG m_lHeight;
+	// spans of row y are m_Spans[m_RowStart[y] .. m_RowStart[y + 1])
+	std::vector<DWORD> m_RowStart;
+	std::vector<SSpan> m_Spans;
+	std::vector<DWORD> m_Pixels;
+};
+
+class CFramebuffer
+{
+public:
+	CFramebuffer();
+	~CFramebuffer();
+
+	// Allocates and owns a lWidth x lHeight surface
+	void Create(LONG lWidth, LONG lHeight);
+
+	// Draws into memory owned by somebody else (e.g. a DIB section), top-down
+	// rows of lPitch pixels
+	void Attach(DWORD *pPixels, LONG lWidth, LONG lHeight, LONG lPitch);
+
+	void Release();
+
+	DWORD *Pixels() const { return m_pPixels; }
+	DWORD *Row(LONG y) const { return m_pPixels + y * m_lPitch; }
+	LONG Width() const { return m_lWidth; }
+	LONG Height() const { return m_lHeight; }
+	LONG Pitch() const { return m_lPitch; }
+
+	// Every drawing call is clipped to this rectangle (right / bottom exclusive),
+	// which is itself kept inside the surface
+	void SetClipRect(const RECT &rc);
+	void ResetClipRect();
+	const RECT &GetClipRect() const { return m_rcClip; }
+
+	void Clear(DWORD uPixel);
+	void FillRect(const RECT &rc, DWORD uPixel);
+
+	// Opaque copy of a bottom-up RGBQUAD image (CImageFile layout) with its
+	// top-left corner at x, y
+	void Blit(const RGBQUAD *pPixels, LONG lWidth, LONG lHeight, LONG x, LONG y);
+
+	// Copies the opaque spans of a sprite with its top-left corner at x, y
+	void DrawSprite(const CRleSprite &sprite, LONG x, LONG y);
+
+	// Writes the clip-independent surface as a 24-bit BMP (e.g. for golden images)
+	bool SaveToFile(const char *szFileName) const;
+
+	// Number of pixels that differ from another framebuffer of the same size,
+	// or -1 when the sizes differ
+	long Compare(const CFramebuffer &other) const;
+
+private:
+	CFramebuffer(const CFramebuffer&);
+	CFramebuffer& operator=(const CFramebuffer&);
+
+	DWORD *m_pPixels;
+	bool m_bOwnsPixels;
+	LONG m_lWidth;
+	LONG m_lHeight;
+	LONG m_lPitch;
+	RECT m_rcClip;
+};
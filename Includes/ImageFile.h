@@ -3,6 +3,7 @@
 // by Mihai Popescu
 // March 2009
 #include "main.h"
+#include "MappedFile.h"
 
 
 typedef BYTE (*RGBQUAD_TO_BYTE)(const RGBQUAD &q);
@@ -20,6 +21,12 @@ enum EColorChannel
 	ECC_EXCLUSIVEBLUE
 };
 
+enum ELoadMode
+{
+	ELM_IMMEDIATE,		// read and decode the whole file in LoadBitmapFromFile
+	ELM_MAPPED			// map the file, decode on first pixel access
+};
+
 
 class CImageFile
 {
@@ -28,6 +35,12 @@ protected:
 	RGBQUAD *m_pRGB;
 	HBITMAP m_hBMP;
 
+	// In ELM_MAPPED mode m_pRGB may point straight into the mapped file,
+	// otherwise it is a new[] buffer we own
+	ELoadMode m_eLoadMode;
+	bool m_bOwnsPixels;
+	CMappedFile m_Mapping;
+
 	LONG &height;
 	LONG &width;
 	char m_szFileName[MAX_PATH];
@@ -37,14 +50,34 @@ public:
 	virtual ~CImageFile(void);
 
 	bool LoadBitmapFromFile(const char* szFileName, HDC hdc);
+	bool SaveBitmapToFile(const char* szFileName, WORD uBitCount = 24);
 	virtual void Paint(HDC hdc, int x, int y);
 
 	LONG Height() const { return height; }
 	LONG Width() const { return width; }
 
-	void Clear() { ZeroMemory(m_pRGB, sizeof(RGBQUAD) * width * height); }
+	void SetLoadMode(ELoadMode eMode) { m_eLoadMode = eMode; }
+	ELoadMode GetLoadMode() const { return m_eLoadMode; }
+
+	// False until the pixels of a mapped image have been touched
+	bool IsDecoded() const { return m_pRGB != NULL; }
+
+	void Clear() { if(EnsureDecoded()) ZeroMemory(m_pRGB, sizeof(RGBQUAD) * width * height); }
 	void Reload(HDC hdc);
 
 	BYTE* CopyMonoImage(EColorChannel chn, const RECT* rc = NULL);
 	void PasteMonoImage(const BYTE *img, EColorChannel chn, const RECT* rc = NULL);
+
+protected:
+	// Makes m_pRGB valid, decoding a mapped file if that has not happened yet
+	bool EnsureDecoded();
+
+	// Frees or unmaps the current pixels
+	void ReleasePixels();
+
+	// Replaces the pixels with a new[] buffer of width * height, taking ownership
+	void AdoptPixels(RGBQUAD *pPixels);
+
+private:
+	bool MapBitmapFromFile(const char* szFileName);
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+// InputLog.h
+// Recording and replay of a simulation session. The log holds what is
+// needed to start the session again (seed, config, levels, the saved game
+// it was loaded from) and the buttons of every step, so replaying it reproduces
+// the session exactly. It ends with the step count and GetChecksum() of
+// the final state for checking that the replay did not diverge.
+//
+// File layout, little-endian:
+//	"RSIL", version (u32), seed (u64), config (22 doubles),
+//	level count (u32) + SSimLevel (ints), endless (u8) [+ SSimEndless (ints)],
+//	from save (u8) [+ SSimSave: 4 doubles, 6 ints],
+//	runs: length (LEB128, > 0) + one byte of buttons per player,
+//	end: 0 (LEB128), steps (u64), checksum (u64)
+// Buttons rarely change between steps, so runs keep a log at a few bytes
+// per second of play.
+#include "Simulation.h"
+#include <stdio.h>
+
+#define INPUTLOG_VERSION	2
+
+// How the session started
+struct SInputLogHeader
+{
+	uint64_t uSeed;
+	SSimConfig config;
+	std::vector<SSimLevel> levels;
+	SSimEndless endless;
+	bool bFromSave;			// Load(save) instead of NewGame()
+	SSimSave save;
+};
+
+// Starts a simulation the way a logged session started
+void InputLogStart(CSimulation &sim, const SInputLogHeader &header);
+
+// Passes the buttons of a source through and writes them to a log
+class CInputRecorder : public CSimInput
+{
+public:
+	CInputRecorder();
+	~CInputRecorder();
+
+	// Where the buttons come from, also while no log is open
+	void SetSource(CSimInput *pSource) { m_pSource = pSource; }
+
+	bool Open(const char *szFileName, const SInputLogHeader &header);
+
+	// Ends the log with the state the session reached; false if any write failed
+	bool Close(unsigned long uSteps, uint64_t uChecksum);
+
+	bool IsOpen() const { return m_pFile != NULL; }
+
+	unsigned int GetButtons(int nPlayer);
+
+private:
+	CInputRecorder(const CInputRecorder&);
+	CInputRecorder& operator=(const CInputRecorder&);
+
+	void WriteRun();
+
+	FILE *m_pFile;
+	CSimInput *m_pSource;
+	bool m_bFailed;
+	unsigned char m_Step[SIM_PLAYERS];		// buttons of the step being asked for
+	unsigned char m_Run[SIM_PLAYERS];		// buttons of the run not written yet
+	unsigned long m_uRunLength;
+};
+
+// Supplies the buttons of a log, step by step
+class CInputReplay : public CSimInput
+{
+public:
+	CInputReplay();
+	~CInputReplay();
+
+	bool Open(const char *szFileName, SInputLogHeader &header);
+	void Close();
+
+	// True once every logged step has been supplied (or the log is cut short)
+	bool AtEnd();
+
+	// After AtEnd(): false if the log has no end record (the game crashed
+	// or was killed), otherwise what the recorded session ended with
+	bool GetEnd(unsigned long &uSteps, uint64_t &uChecksum) const;
+
+	unsigned int GetButtons(int nPlayer);
+
+private:
+	CInputReplay(const CInputReplay&);
+	CInputReplay& operator=(const CInputReplay&);
+
+	bool ReadRun();
+
+	FILE *m_pFile;
+	bool m_bEnded;
+	bool m_bHasEnd;
+	unsigned long m_uEndSteps;
+	uint64_t m_uEndChecksum;
+	unsigned char m_Run[SIM_PLAYERS];
+	unsigned long m_uRunLeft;
+};
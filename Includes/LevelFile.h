@@ -0,0 +1,38 @@
+#pragma once
+// LevelFile.h
+// Reads the level definitions (Data/levels.txt) into the tables CSimulation
+// plays. The file is plain text, one setting per line, so levels can be
+// added or tuned without building the game again:
+//
+//	level					starts a level, the settings below are for it
+//	endless					starts the endless levels (the infinite road)
+//	label <bitmap>			HUD text of the level, relative to the file
+//	cars <n>				traffic of the level
+//	speed <px/s>			speed of the first cars
+//	ramp <px/s> <every> <n>	every <every> cars the next ones are faster, <n> times at most
+//	mix <car2> <car6> <police>		how likely each car model is, relative
+//	lanes <x> ...			lane centres, negative ones from the right edge
+//	powerups <near> <far> <name> ...	which power-ups come (life, shield, gun,
+//							doubler) and how far above the road they start,
+//							or "powerups none"
+//	grow <cars> <px/s>		endless only: added every level
+//	limit <cars> <px/s>		endless only: never more than this
+//
+// Every level starts as a copy of the one before (the first as the game's
+// built-in first level), so it only lists what changes. The endless levels
+// start as a copy of the last listed one. # starts a comment.
+#include "Simulation.h"
+#include <string>
+#include <vector>
+
+struct SLevelFile
+{
+	std::vector<SSimLevel> levels;
+	std::vector<std::string> labels;		// of each level, empty if it has none
+	SSimEndless endless;					// bEnabled if the file has them
+	std::string strEndlessLabel;
+};
+
+// False with the line and the problem in strError if the file cannot be read
+// or has a mistake
+bool LevelFileLoad(const char *szFileName, SLevelFile &file, std::string &strError);
@@ -0,0 +1,32 @@
+#pragma once
+// MappedFile.h
+// Read-only file mapped copy-on-write: pages are shared with the OS file
+// cache until somebody writes to them, and writes never reach the file.
+#include "PlatformTypes.h"
+
+class CMappedFile
+{
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	bool Open(const char *szFileName);
+	void Close();
+
+	bool IsOpen() const { return m_pData != NULL; }
+
+	// Mapped bytes, writable (private to this process)
+	BYTE *GetData() const { return m_pData; }
+	size_t GetSize() const { return m_uSize; }
+
+private:
+	CMappedFile(const CMappedFile&);
+	CMappedFile& operator=(const CMappedFile&);
+
+	BYTE *m_pData;
+	size_t m_uSize;
+#ifdef _WIN32
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+#endif
+};
@@ -13,6 +13,7 @@
 //-----------------------------------------------------------------------------
 #include "Sprite.h"
 #include "BackBuffer.h"
+#include <vector>
 
 //-----------------------------------------------------------------------------
 // Main Class Definitions
@@ -32,13 +33,16 @@ private:
 		START,
 		LOAD,
 		SAVE,
-		EXIT
+		EXIT,
+		INFINITE			// start menu only
 	};
 
 	CHOICE				select;
 
 	Sprite*				startText;
-	Sprite*				loadText;
+	Sprite*				infiniteText;
+	Sprite*				loadText1;
+	Sprite*				loadText2;
 	Sprite*				saveText;
 	Sprite*				exitText1;
 	Sprite*				exitText2;
@@ -57,9 +61,11 @@ public:
 	// Public Functions for This Class.
 	//-------------------------------------------------------------------------
 	void	draw(ULONG gameState);
+	void	getSprites(ULONG gameState, std::vector<Sprite*> &sprites);
 	void	opUp(ULONG gameState);
 	void	opDown(ULONG gameState);
 	CHOICE	getChoice();
+	void	reset();
 
 	//-------------------------------------------------------------------------
 	// Public Variables for This Class.
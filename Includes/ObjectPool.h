@@ -0,0 +1,68 @@
+#pragma once
+// ObjectPool.h
+// Fixed set of objects created up front and handed out by index. Acquire()
+// and Release() only move indices on and off a free list, so nothing is
+// constructed or destroyed while the pool is in use. The pool owns the
+// objects and deletes them in Clear() or on destruction.
+#include <vector>
+#include <cstddef>
+
+#define POOL_EMPTY	0xFFFFFFFFu		// Acquire() result when every object is in use
+
+template <class T>
+class CObjectPool
+{
+public:
+	CObjectPool() {}
+	~CObjectPool() { Clear(); }
+
+	// Takes ownership of pObject and makes it available
+	unsigned int Add(T *pObject)
+	{
+		unsigned int uIndex = (unsigned int)m_Objects.size();
+		m_Objects.push_back(pObject);
+		m_Free.push_back(uIndex);
+		return uIndex;
+	}
+
+	// Index of an unused object, POOL_EMPTY if there is none
+	unsigned int Acquire()
+	{
+		if(m_Free.empty())
+			return POOL_EMPTY;
+
+		unsigned int uIndex = m_Free.back();
+		m_Free.pop_back();
+		return uIndex;
+	}
+
+	void Release(unsigned int uIndex) { m_Free.push_back(uIndex); }
+
+	// Makes every object available again, handed out from index 0 up
+	void ReleaseAll()
+	{
+		m_Free.resize(m_Objects.size());
+		for(size_t i = 0; i < m_Free.size(); i++)
+			m_Free[i] = (unsigned int)(m_Free.size() - 1 - i);
+	}
+
+	T *Get(unsigned int uIndex) const { return m_Objects[uIndex]; }
+	size_t GetCapacity() const { return m_Objects.size(); }
+	size_t GetFreeCount() const { return m_Free.size(); }
+
+	void Clear()
+	{
+		for(size_t i = 0; i < m_Objects.size(); i++)
+			delete m_Objects[i];
+		m_Objects.clear();
+		m_Free.clear();
+	}
+
+private:
+	// not copyable, the pool owns its objects
+	CObjectPool(const CObjectPool &rhs);
+	CObjectPool &operator=(const CObjectPool &rhs);
+
+	std::vector<T *> m_Objects;
+	std::vector<unsigned int> m_Free;
+};
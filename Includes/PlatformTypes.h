@@ -0,0 +1,68 @@
+#pragma once
+// PlatformTypes.h
+// Minimal Win32 type definitions for code that also builds off Windows
+// (asset tools, headless runs). On Windows this is just <windows.h>.
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+#else
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t		BYTE;
+typedef uint16_t	WORD;
+typedef uint32_t	DWORD;
+typedef int32_t		LONG;
+typedef unsigned int UINT;
+typedef uint32_t	COLORREF;
+
+typedef struct tagRGBQUAD
+{
+	BYTE rgbBlue;
+	BYTE rgbGreen;
+	BYTE rgbRed;
+	BYTE rgbReserved;
+} RGBQUAD;
+
+typedef struct tagRECT
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+} RECT;
+
+typedef struct tagBITMAPINFOHEADER
+{
+	DWORD biSize;
+	LONG biWidth;
+	LONG biHeight;
+	WORD biPlanes;
+	WORD biBitCount;
+	DWORD biCompression;
+	DWORD biSizeImage;
+	LONG biXPelsPerMeter;
+	LONG biYPelsPerMeter;
+	DWORD biClrUsed;
+	DWORD biClrImportant;
+} BITMAPINFOHEADER;
+
+#define BI_RGB			0L
+#define BI_BITFIELDS	3L
+
+#define RGB(r, g, b)	((COLORREF)(((BYTE)(r) | ((WORD)((BYTE)(g)) << 8)) | (((DWORD)(BYTE)(b)) << 16)))
+#define GetRValue(rgb)	((BYTE)(rgb))
+#define GetGValue(rgb)	((BYTE)(((WORD)(rgb)) >> 8))
+#define GetBValue(rgb)	((BYTE)((rgb) >> 16))
+
+#define ZeroMemory(p, n)	memset((p), 0, (n))
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#endif // _WIN32
@@ -0,0 +1,56 @@
+#pragma once
+// Random.h
+// Small seeded random number generator (PCG32, O'Neill 2014). Each
+// simulation owns one, so a seed fixes every spawn of a session on any
+// platform, unlike rand() whose sequence depends on the C library and is
+// shared by the whole process.
+#include <stdint.h>
+
+class CRandom
+{
+public:
+	CRandom() { Seed(0); }
+	explicit CRandom(uint64_t uSeed, uint64_t uStream = 0) { Seed(uSeed, uStream); }
+
+	// Generators with different streams give unrelated sequences for the
+	// same seed
+	void Seed(uint64_t uSeed, uint64_t uStream = 0)
+	{
+		m_uState = 0;
+		m_uIncrement = (uStream << 1) | 1;
+		Next();
+		m_uState += uSeed;
+		Next();
+	}
+
+	// Uniform over all 32-bit values
+	uint32_t Next()
+	{
+		uint64_t uOld = m_uState;
+		m_uState = uOld * 6364136223846793005ull + m_uIncrement;
+
+		uint32_t uXorShifted = (uint32_t)(((uOld >> 18) ^ uOld) >> 27);
+		uint32_t uRot = (uint32_t)(uOld >> 59);
+		return (uXorShifted >> uRot) | (uXorShifted << ((0u - uRot) & 31));
+	}
+
+	// Uniform in [0, uBound), uBound > 0. Values that would make the low
+	// results more likely are drawn again.
+	uint32_t Below(uint32_t uBound)
+	{
+		uint32_t uThreshold = (0u - uBound) % uBound;
+		for(;;)
+		{
+			uint32_t r = Next();
+			if(r >= uThreshold)
+				return r % uBound;
+		}
+	}
+
+	// Uniform in [0, 1)
+	double NextDouble() { return Next() * (1.0 / 4294967296.0); }
+
+private:
+	uint64_t m_uState;
+	uint64_t m_uIncrement;
+};
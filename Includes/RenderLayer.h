@@ -0,0 +1,58 @@
+// RenderLayer.h
+// Offscreen layer for sprites that rarely change (the HUD). The layer keeps
+// its own back buffer, re-renders only the parts whose sprites changed since
+// the last frame and keeps the result as run-length encoded opaque spans, so
+// putting it on screen is a single span copy instead of one masked blit per
+// sprite.
+#ifndef RENDERLAYER_H
+#define RENDERLAYER_H
+
+#include "main.h"
+#include "BackBuffer.h"
+#include "Sprite.h"
+#include <vector>
+
+class RenderLayer
+{
+public:
+	RenderLayer(HWND hWnd, int width, int height);
+	~RenderLayer();
+
+	// Sprites shown in the layer draw into this back buffer
+	const BackBuffer *getSurface() const { return &mSurface; }
+
+	// Each frame: queue() every sprite the layer shows, in drawing order,
+	// then update(), which re-renders the layer if anything changed and
+	// returns whether it did.
+	void queue(Sprite *pSprite);
+	bool update();
+
+	// Forces the next update() to re-render everything
+	void invalidate() { mSurface.invalidateAll(); }
+
+	// Area covered by opaque layer pixels and a counter bumped on every
+	// re-render, for dirty rectangle tracking in the target
+	const RECT &getBounds() const { return mrcBounds; }
+	ULONG getVersion() const { return mVersion; }
+
+	// Copies the opaque layer pixels into the dirty region of the target
+	void composite(BackBuffer &target) const;
+
+private:
+	RenderLayer(const RenderLayer& rhs);
+	RenderLayer& operator=(const RenderLayer& rhs);
+
+	struct SQueued
+	{
+		Sprite *pSprite;
+		RECT rcBounds;
+	};
+
+	BackBuffer mSurface;
+	std::vector<SQueued> mQueued;
+	CRleSprite mImage;
+	RECT mrcBounds;
+	ULONG mVersion;
+};
+
+#endif // RENDERLAYER_H
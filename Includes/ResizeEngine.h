@@ -1,41 +1,82 @@
 #pragma once
 #include "Filters.h"
 #include "ImageFile.h"
+#include "ThreadPool.h"
+#include <memory>
 
-class CWeightsTable
+// Fixed-point weights carry 14 fractional bits, so a full tap sum (1.0)
+// is 16384 and a pixel * weight product always fits in 32 bits
+#define RESIZE_FIXED_BITS	14
+#define RESIZE_FIXED_ONE	(1 << RESIZE_FIXED_BITS)
+#define RESIZE_FIXED_HALF	(1 << (RESIZE_FIXED_BITS - 1))
+
+enum EResampleMode
 {
-	typedef struct 
-	{
-		double *Weights;			// Normalized weights of neighboring pixels
-		int Left, Right;			// Bounds of source pixels window
-	} sContribution;
+	ERM_DOUBLE,			// reference path, double weights per channel
+	ERM_FIXEDPOINT		// 14-bit integer weights, all channels in one pass
+};
 
+// Contribution weights for resampling one line length to another.
+// All rows live in a single 64-byte aligned block with a fixed stride
+// (the window size rounded up to 8 taps), tables are immutable once built
+// and shared through a process-wide cache.
+class CWeightsTable
+{
 private:
-	// Row (or column) of contribution weights
-	sContribution *m_WeightTable;
+	// Single allocation holding bounds, double and fixed-point weights
+	BYTE *m_pBlock;
+	// Left / right source bounds, interleaved per destination pixel
+	int *m_pBounds;
+	// Normalized weights of neighboring pixels, m_Stride per pixel, kept
+	// in full precision for the ERM_DOUBLE reference path
+	double *m_pWeights;
+	// Same weights in RESIZE_FIXED_BITS fixed-point, zero padded to m_Stride
+	short *m_pFixedWeights;
 	// Filter window size (of affecting source pixels)
 	DWORD m_WindowSize;
+	// Distance between the weights of two consecutive destination pixels
+	DWORD m_Stride;
 	// Length of line (no. of rows / cols)
 	DWORD m_LineLength;
 
+	CWeightsTable(const CWeightsTable&);
+	CWeightsTable& operator=(const CWeightsTable&);
+
 public:
 	
 	CWeightsTable(CGenericFilter *pFilter, DWORD uDstSize, DWORD uSrcSize);
 	~CWeightsTable();
 
+	// Returns a shared table for this filter and mapping, building it only
+	// the first time a given (filter, params, src, dst) combination is seen
+	static std::shared_ptr<const CWeightsTable> Acquire(CGenericFilter *pFilter, DWORD uDstSize, DWORD uSrcSize);
+
+	// Drops every cached table (tables still in use stay alive)
+	static void FlushCache();
+
+	// Maximum number of source pixels contributing to one destination pixel
+	DWORD getWindowSize() const {
+			return m_WindowSize;
+	}
+
 	// Retrieve a filter weight, given source and destination positions
-	double getWeight(int dst_pos, int src_pos) {
-			return m_WeightTable[dst_pos].Weights[src_pos];
+	double getWeight(int dst_pos, int src_pos) const {
+			return m_pWeights[dst_pos * m_Stride + src_pos];
+	}
+
+	// Retrieve the fixed-point weights of a destination position
+	const short *getFixedWeights(int dst_pos) const {
+			return &m_pFixedWeights[dst_pos * m_Stride];
 	}
 
 	// Retrieve left boundary of source line buffer
-	int getLeftBoundary(int dst_pos) {
-			return m_WeightTable[dst_pos].Left;
+	int getLeftBoundary(int dst_pos) const {
+			return m_pBounds[dst_pos * 2];
 	}
 
 	// Retrieve right boundary of source line buffer
-	int getRightBoundary(int dst_pos) {
-			return m_WeightTable[dst_pos].Right;
+	int getRightBoundary(int dst_pos) const {
+			return m_pBounds[dst_pos * 2 + 1];
 	}
 };
 
@@ -44,13 +85,23 @@ class CResizableImage : public CImageFile
 {
 	CGenericFilter *m_pFilter;
 	RGBQUAD *m_pResImg;
-	CWeightsTable *m_pWeights;
+	std::shared_ptr<const CWeightsTable> m_pWeights;
+	EResampleMode m_eMode;
+	std::unique_ptr<CThreadPool> m_pPool;
 
 public:
-	CResizableImage() { m_pFilter = NULL; }
+	CResizableImage() { m_pFilter = NULL; m_eMode = ERM_FIXEDPOINT; }
 	virtual ~CResizableImage() {}
 
 	void SetFilter(CGenericFilter *pFilter) { m_pFilter = pFilter; }
+	void SetMode(EResampleMode eMode) { m_eMode = eMode; }
+	EResampleMode GetMode() const { return m_eMode; }
+
+	// Number of threads Resample splits its passes across (0 picks one per
+	// hardware thread, 1 keeps everything on the calling thread). The result
+	// is identical for every worker count.
+	void SetWorkerCount(unsigned int uWorkers);
+	unsigned int GetWorkerCount() const { return m_pPool ? m_pPool->GetWorkerCount() : 1; }
 
 	// Scale an image to the desired dimensions
 	void Resample(unsigned dst_width, unsigned dst_height);
@@ -59,6 +110,9 @@ private:
 	void ScaleRow(unsigned int dst_width, unsigned int /*dst_height*/, unsigned int row);
 	void ScaleCol(unsigned int dst_width, unsigned int dst_height, unsigned int col);
 
+	// Runs fnBand over [0, uCount) bands, on the pool when there is one
+	void ForEachBand(unsigned int uCount, unsigned int uGrain, const CThreadPool::BAND_FUNC &fnBand);
+
 	// Performs horizontal image filtering
 	void HorizontalFilter(unsigned int dst_width, unsigned int dst_height);
 
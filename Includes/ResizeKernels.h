@@ -0,0 +1,32 @@
+#pragma once
+// ResizeKernels.h
+// Fixed-point filter kernels used by CResizableImage, with scalar,
+// SSE2 and AVX2 variants selected at runtime from the CPU features.
+#include "ImageFile.h"
+
+class CWeightsTable;
+
+enum EResizeKernel
+{
+	ERK_SCALAR,
+	ERK_SSE2,
+	ERK_AVX2
+};
+
+// Filters one source row into dst_width destination pixels
+typedef void (*HORIZONTAL_KERNEL)(const RGBQUAD *pSrc, RGBQUAD *pDst, unsigned int dst_width, const CWeightsTable *pWeights);
+
+// Blends iTaps source rows (one weight each) into a destination row of uWidth pixels
+typedef void (*VERTICAL_KERNEL)(const RGBQUAD * const *ppSrcRows, const short *pWeights, int iTaps, RGBQUAD *pDst, unsigned int uWidth);
+
+// Best kernel level supported by this CPU / OS
+EResizeKernel DetectResizeKernel();
+
+// Currently selected level; defaults to DetectResizeKernel()
+EResizeKernel GetResizeKernel();
+
+// Force a lower kernel level (e.g. for comparisons); clamped to what the CPU supports
+void SetResizeKernel(EResizeKernel eKernel);
+
+HORIZONTAL_KERNEL GetHorizontalKernel();
+VERTICAL_KERNEL GetVerticalKernel();
@@ -15,6 +15,7 @@
 #include "Sprite.h"
 #include "Vec2.h"
 #include "BackBuffer.h"
+#include <vector>
 
 //-----------------------------------------------------------------------------
 // Main Class Definitions
@@ -41,6 +42,7 @@ private:
 	Sprite*				scoreDig1;
 	Sprite*				scoreDig2;
 	Sprite*				scoreDig3;
+	int					shownDig[4];		// number each digit sprite shows
 
 	const BackBuffer*	BF;
 
@@ -56,6 +58,7 @@ public:
 	//-------------------------------------------------------------------------
 	void	updateScore(int increment);
 	void	draw();
+	void	getSprites(std::vector<Sprite*> &sprites);
 	void	move(const Vec2 destination);
 	int		getScore();
 	void	setScore(int newScore);
@@ -0,0 +1,298 @@
+#pragma once
+// Simulation.h
+// The game itself without a window: players, traffic, bullets, power-ups,
+// collisions, scoring and level progression. Nothing in here calls the
+// platform. The host advances it with Step() once every SIM_STEP seconds of
+// its own clock and talks to it through three small interfaces: it supplies
+// the buttons held for each step, plays the sounds the simulation asks for
+// and draws the objects Render() reports.
+#include "EntityStore.h"
+#include "BroadPhase.h"
+#include "TrafficPlan.h"
+#include "TrafficLanes.h"
+#include "Random.h"
+#include <vector>
+#include <cstddef>
+
+// Length of one step in seconds. Counters in the rules (power-up duration,
+// shot rate, score rate) count steps.
+#define SIM_STEP			(1.0 / 120.0)
+
+#define SIM_PLAYERS			2
+#define SIM_MAX_LANES		8
+
+// With the gun a player fires a shot every SIM_SHOT_STEPS steps. Bullets
+// start SIM_BULLET_OFFSET pixels above the player and fly up at
+// SIM_BULLET_SPEED pixels per second until they hit a car or the top edge.
+#define SIM_SHOT_STEPS		20
+#define SIM_BULLET_SPEED	250
+#define SIM_BULLET_OFFSET	75
+
+// Buttons held by a player during a step
+#define SIM_BUTTON_UP		0x01
+#define SIM_BUTTON_DOWN		0x02
+#define SIM_BUTTON_LEFT		0x04
+#define SIM_BUTTON_RIGHT	0x08
+#define SIM_BUTTON_FIRE		0x10
+
+enum ESimState
+{
+	ESIM_RUNNING,
+	ESIM_WON,					// last level cleared
+	ESIM_LOST					// both players out of lives
+};
+
+enum ESimSound
+{
+	ESS_EXPLOSION,
+	ESS_POWERUP,
+	ESS_SHOOT,
+	ESS_TIMER,					// a power-up is about to run out
+	ESS_LEVEL_FINISHED
+};
+
+enum ESimObject
+{
+	ESO_PLAYER,					// variant: player index
+	ESO_CAR,					// variant: ESimCarModel
+	ESO_BULLET,					// variant: player who fired it
+	ESO_POWERUP,				// variant: ESimPowerUp
+	ESO_EXPLOSION				// variant: animation frame
+};
+
+enum ESimCarModel
+{
+	ESC_CAR2,
+	ESC_CAR6,
+	ESC_POLICE,
+	ESC_COUNT
+};
+
+enum ESimPowerUp
+{
+	ESP_LIFE,
+	ESP_SHIELD,
+	ESP_GUN,
+	ESP_DOUBLER,
+	ESP_COUNT
+};
+
+class CSimInput
+{
+public:
+	virtual ~CSimInput() {}
+	// SIM_BUTTON_* held by a player for the coming step. Asked once per
+	// player at the start of every Step(), player 0 first.
+	virtual unsigned int GetButtons(int nPlayer) = 0;
+};
+
+class CSimAudio
+{
+public:
+	virtual ~CSimAudio() {}
+	virtual void PlayEffect(ESimSound eSound) = 0;
+};
+
+class CSimRenderer
+{
+public:
+	virtual ~CSimRenderer() {}
+	// One visible object, centred on x, y
+	virtual void DrawObject(ESimObject eObject, unsigned int uVariant, double x, double y) = 0;
+};
+
+// Playfield and object sizes (full width and height, in pixels). The game
+// takes these from its bitmaps, DefaultConfig() has the shipped values.
+struct SSimConfig
+{
+	double dWidth, dHeight;
+	double dPlayerSize[SIM_PLAYERS][2];
+	double dCarSize[ESC_COUNT][2];
+	double dBulletSize[2];
+	double dPowerUpSize[ESP_COUNT][2];
+};
+
+// Traffic and power-ups of one level. Data/levels.txt describes the
+// shipped ones, see LevelFile.h.
+struct SSimLevel
+{
+	int nCars;
+	int nVelocity;					// speed of the first cars, pixels per second
+	int nRampStep;					// later cars are this much faster
+	int nRampEvery;					// every this many cars
+	int nRampCount;					// this many times at most
+	int nMix[ESC_COUNT];			// how likely each car model is, relative
+	int nPowerUpMask;				// 1 << ESimPowerUp of those the level has
+	int nPowerUpNear;				// how far above the road they start, pixels
+	int nPowerUpFar;
+	int nLanes;
+	int nLane[SIM_MAX_LANES];		// lane centres, negative from the right edge
+};
+
+// Levels past the listed ones, made up as they are reached: the k-th is
+// base with k times the growth added, up to the limits
+struct SSimEndless
+{
+	bool bEnabled;
+	SSimLevel base;
+	int nCarsGrowth;
+	int nCarsLimit;
+	int nVelocityGrowth;
+	int nVelocityLimit;
+};
+
+struct SSimPlayer
+{
+	double x, y;
+	double vx, vy;
+	double prevX, prevY;			// position before the last step
+
+	int nLives;
+	int nScore;
+	bool bDead;						// out of the game
+	bool bExploding;
+	double dExplosionTime;
+
+	bool bInvincible;
+	bool bShield;
+	bool bGun;
+	bool bDoubler;
+	int nInvincibleSteps;			// steps the power-ups have been active
+	int nShieldSteps;
+	int nGunSteps;
+	int nDoublerSteps;
+	int nShotSteps;					// steps since the last shot
+	int nScoreSteps;
+	int nCrashes;					// lives lost to traffic this game
+};
+
+// What a saved game keeps
+struct SSimSave
+{
+	double x[SIM_PLAYERS], y[SIM_PLAYERS];
+	int nLives[SIM_PLAYERS];
+	int nScore[SIM_PLAYERS];
+	int nLevel;
+	int nCars;						// traffic on the road and still to come
+};
+
+class CSimulation
+{
+public:
+	CSimulation();
+
+	static void DefaultConfig(SSimConfig &config);
+
+	void SetConfig(const SSimConfig &config) { m_Config = config; }
+	const SSimConfig &GetConfig() const { return m_Config; }
+
+	// The shipped five levels, as in Data/levels.txt
+	static void DefaultLevels(std::vector<SSimLevel> &levels);
+
+	// Levels of the next game. At least one unless the endless levels are
+	// on, those follow the listed ones and the game is only ever lost.
+	void SetLevels(const std::vector<SSimLevel> &levels) { m_Levels = levels; }
+	const std::vector<SSimLevel> &GetLevels() const { return m_Levels; }
+	void SetEndless(const SSimEndless &endless) { m_Endless = endless; }
+	const SSimEndless &GetEndless() const { return m_Endless; }
+
+	// False if a level cannot be played: no cars, speed, lanes or car
+	// models, or a power-up range the wrong way round
+	static bool CheckLevel(const SSimLevel &level);
+
+	// Any level of the game, listed or endless
+	void MakeLevel(int nLevel, SSimLevel &level) const;
+
+	// Most cars Render() can report at once in this game's levels: every
+	// lane of the widest one full of the shortest cars, a lane gap apart
+	int GetMaxVisibleCars() const;
+
+	void SetInput(CSimInput *pInput) { m_pInput = pInput; }
+	void SetAudio(CSimAudio *pAudio) { m_pAudio = pAudio; }
+
+	// Full lives and no score, from level 0 unless given. The seed decides
+	// all traffic and power-ups, the same seed, config and input give the
+	// same game.
+	void NewGame(uint64_t uSeed, int nLevel = 0);
+	void Load(const SSimSave &save, uint64_t uSeed);
+	void Save(SSimSave &save) const;
+
+	void Step();
+
+	// Reports every visible object, alpha of the way from its position
+	// before the last step to its current one
+	void Render(CSimRenderer &renderer, double alpha) const;
+
+	ESimState GetState() const { return m_eState; }
+	int GetLevel() const { return m_nLevel; }
+	int GetLevelCount() const { return (int)m_Levels.size(); }		// listed ones
+	bool IsEndless() const { return m_Endless.bEnabled; }
+	unsigned long GetStepCount() const { return m_uSteps; }
+	const SSimPlayer &GetPlayer(int nPlayer) const { return m_Players[nPlayer]; }
+	const CEntityStore &GetEntities() const { return m_Entities; }
+	const CTrafficLanes &GetTrafficLanes() const { return m_TrafficLanes; }
+	size_t GetCarCount() const { return m_Entities.CountOf(EEK_CAR); }		// on the road
+	int GetCarsToCome() const { return m_nCarsToCome; }
+
+	// Hash of the whole game state, equal only if two runs stayed identical
+	uint64_t GetChecksum() const;
+
+private:
+	void StartLevel(int nLevel);
+	void UpdateState();
+	int ClampLevel(int nLevel) const;
+	void StartTraffic(int nCars);
+	void StreamTraffic();
+	void SpawnPowerUps();
+	double LaneX(int nLane) const;
+	double RandomLane();
+	void InitPlayers();
+	void ResetPlayers();
+
+	void MovePlayer(int nPlayer, unsigned int uButtons);
+	void UpdatePlayer(int nPlayer);
+	void FireBullet(int nPlayer);
+
+	void BuildBroadPhase();
+	SAabb GetPlayerBox(int nPlayer) const;
+	void CollidePlayer(int nPlayer);
+	void CollidePowerUps(int nPlayer);
+	void CollideBullets();
+	void CollideTraffic();
+	void ExplodeCar(size_t uCar);
+	void AdvanceExplosions();
+	void RemoveDead();
+
+	void Play(ESimSound eSound);
+
+	SSimConfig m_Config;
+	std::vector<SSimLevel> m_Levels;
+	SSimEndless m_Endless;
+	CSimInput *m_pInput;
+	CSimAudio *m_pAudio;
+
+	CRandom m_Random;
+
+	ESimState m_eState;
+	int m_nLevel;
+	SSimLevel m_Level;						// the one being played
+
+	// Traffic comes down the road a car at a time, just above the top edge,
+	// once the road planned for it has passed
+	int m_nCarsSent;						// of the level so far
+	int m_nCarsToCome;
+	double m_dRoad;							// passed since the level started
+	CTrafficPlan m_TrafficPlan;
+	std::vector<STrafficSlot> m_TrafficSlots;	// the batch being sent
+	size_t m_uNextSlot;
+	unsigned long m_uSteps;
+
+	SSimPlayer m_Players[SIM_PLAYERS];
+
+	CEntityStore m_Entities;
+	SEntityHandle m_hPowerUps[ESP_COUNT];
+
+	CTrafficLanes m_TrafficLanes;			// drives the cars on the road
+	CBroadPhase m_BroadPhase;				// car boxes, rebuilt every step
+	std::vector<unsigned int> m_Hits;		// scratch for grid queries
+};
@@ -7,13 +7,17 @@
 #include "main.h"
 #include "Vec2.h"
 #include "BackBuffer.h"
+#include "AssetCache.h"
+
+class CSpriteAtlas;
 
 class Sprite
 {
 public:
 	Sprite(int imageID, int maskID);
 	Sprite(const char *szImageFile, const char *szMaskFile);
-	Sprite(const char *szImageFile, COLORREF crTransparentColor);
+	// ELM_MAPPED defers reading the pixels to the first draw (see CAssetCache)
+	Sprite(const char *szImageFile, COLORREF crTransparentColor, ELoadMode eMode = ELM_IMMEDIATE);
 
 	virtual ~Sprite();
 
@@ -24,6 +28,14 @@ public:
 	void setBackBuffer(const BackBuffer *pBackBuffer);
 	virtual void draw();
 
+	// Where the next draw() puts its pixels and which part of which
+	// bitmap it copies there (for dirty rectangle tracking)
+	virtual void getDrawState(RECT &rcBounds, HBITMAP &hImage, POINT &ptSource);
+
+	// Colour keyed sprites created from a file look the file up in this
+	// atlas first and only load it from disk when it is not packed.
+	static void setAtlas(const CSpriteAtlas *pAtlas) { spAtlas = pAtlas; }
+
 public:
 	// Keep these public because they need to be
 	// modified externally frequently.
@@ -50,9 +62,26 @@ protected:
 	HDC mhSpriteDC;
 	const BackBuffer *mpBackBuffer;
 
+	// Area of mhImage holding this sprite (all of it unless it is an atlas page)
+	RECT mrcSource;
+	// True only for bitmaps this sprite loaded itself (resources); file
+	// bitmaps belong to the asset cache, atlas pages to the atlas
+	bool mbOwnsImage;
+	// Keep the shared file bitmaps alive while we use them
+	BitmapAssetPtr mpImageAsset;
+	BitmapAssetPtr mpMaskAsset;
+	// Shared colour key mask of mpImageAsset, same layout as mhImage
+	HBITMAP mhTransparentMask;
+
 	COLORREF mcTransparentColor;
+	// Fetches the bitmap and mask of a sprite loaded ELM_MAPPED
+	void resolveImage();
 	void drawTransparent();
 	void drawMask();
+
+	void setFullSource();
+
+	static const CSpriteAtlas *spAtlas;
 };
 
 // AnimatedSprite
@@ -71,6 +100,7 @@ public:
 	void SetFrameEnemy(int iIndex);
 
 	virtual void draw();
+	virtual void getDrawState(RECT &rcBounds, HBITMAP &hImage, POINT &ptSource);
 	
 protected:
 	POINT mptFrameStartCrop;// first point of the frame (upper-left corner)
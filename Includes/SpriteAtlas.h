@@ -0,0 +1,36 @@
+// SpriteAtlas.h
+// Runtime side of the packed sprite atlas: loads the index written by
+// Tools/AtlasPacker and its page bitmaps, and resolves the bitmap paths
+// used by Sprite to a sub-rectangle of a shared page.
+#ifndef SPRITEATLAS_H
+#define SPRITEATLAS_H
+
+#include "main.h"
+#include "AtlasIndex.h"
+#include "AssetCache.h"
+
+class CSpriteAtlas
+{
+public:
+	CSpriteAtlas();
+	~CSpriteAtlas();
+
+	// Loads the index and every page it lists; false leaves the atlas empty
+	bool Load(const char *szIndexFile);
+	void Release();
+
+	bool IsLoaded() const { return !m_Pages.empty(); }
+
+	// Looks up a packed bitmap by the path it was packed from
+	bool Find(const char *szImageFile, BitmapAssetPtr &pPage, RECT &rcSource, COLORREF &crTransparent) const;
+
+private:
+	CSpriteAtlas(const CSpriteAtlas&);
+	CSpriteAtlas& operator=(const CSpriteAtlas&);
+
+	CAtlasIndex m_Index;
+	// pages are shared through the asset cache like any other bitmap
+	std::vector<BitmapAssetPtr> m_Pages;
+};
+
+#endif // SPRITEATLAS_H
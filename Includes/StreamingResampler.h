@@ -0,0 +1,62 @@
+#pragma once
+// StreamingResampler.h
+// Row-at-a-time resampler with bounded memory: source rows are pushed in
+// order, filtered horizontally into a small ring buffer, and every
+// destination row is handed to a sink as soon as its vertical support
+// has arrived. Only fixed-point kernels are used, and the rows produced
+// match CResizableImage::Resample when it filters horizontally first.
+#include "ResizeEngine.h"
+#include <functional>
+#include <vector>
+
+class CStreamingResampler
+{
+public:
+	// Receives destination rows in order, pRow is only valid during the call
+	typedef std::function<void(unsigned int uRow, const RGBQUAD *pRow)> ROW_SINK;
+
+	CStreamingResampler();
+	~CStreamingResampler();
+
+	// Prepares a resize of src_width x src_height into dst_width x dst_height.
+	// Any previous run is discarded.
+	bool Begin(CGenericFilter *pFilter, unsigned int src_width, unsigned int src_height,
+		unsigned int dst_width, unsigned int dst_height, const ROW_SINK &fnSink);
+
+	// Feeds the next source row (src_width pixels). Returns false once all
+	// src_height rows have been consumed or Begin was not called.
+	bool PushRow(const RGBQUAD *pSrcRow);
+
+	// True when every destination row has been emitted
+	bool IsComplete() const { return m_uRowsEmitted == m_uDstHeight && m_uDstHeight != 0; }
+
+	unsigned int GetRowsPushed() const { return m_uRowsPushed; }
+	unsigned int GetRowsEmitted() const { return m_uRowsEmitted; }
+
+	// Number of horizontally filtered rows kept in the ring buffer
+	unsigned int GetRingRows() const { return m_uRingRows; }
+
+	// Bytes held by the ring buffer and output row
+	size_t GetBufferBytes() const { return (m_Ring.size() + m_OutRow.size()) * sizeof(RGBQUAD); }
+
+private:
+	CStreamingResampler(const CStreamingResampler&);
+	CStreamingResampler& operator=(const CStreamingResampler&);
+
+	void EmitReadyRows();
+
+	std::shared_ptr<const CWeightsTable> m_pHorzWeights;
+	std::shared_ptr<const CWeightsTable> m_pVertWeights;
+	ROW_SINK m_fnSink;
+
+	unsigned int m_uSrcWidth, m_uSrcHeight;
+	unsigned int m_uDstWidth, m_uDstHeight;
+	unsigned int m_uRowsPushed;
+	unsigned int m_uRowsEmitted;
+
+	// horizontally filtered source rows, source row i lives in slot i % m_uRingRows
+	unsigned int m_uRingRows;
+	std::vector<RGBQUAD> m_Ring;
+	std::vector<RGBQUAD> m_OutRow;
+	std::vector<const RGBQUAD*> m_Taps;
+};
@@ -0,0 +1,63 @@
+#pragma once
+// ThreadPool.h
+// Small fixed-size worker pool used to split image work into bands.
+// Workers are started once and parked between jobs.
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+class CThreadPool
+{
+public:
+	// Called with a half-open [uBegin, uEnd) range of the iteration space
+	typedef std::function<void(unsigned int uBegin, unsigned int uEnd)> BAND_FUNC;
+
+	// uWorkers counts the calling thread too, so 1 means no extra threads
+	explicit CThreadPool(unsigned int uWorkers);
+	~CThreadPool();
+
+	unsigned int GetWorkerCount() const { return m_uWorkers; }
+
+	// Splits [uBegin, uEnd) into contiguous bands of at least uGrain items and
+	// runs them on the pool, the calling thread included. Returns once every
+	// band has finished. Band boundaries depend only on the range, the grain
+	// and the worker count, never on scheduling.
+	void ParallelFor(unsigned int uBegin, unsigned int uEnd, unsigned int uGrain, const BAND_FUNC &fnBand);
+
+	// Number of hardware threads, at least 1
+	static unsigned int HardwareWorkers();
+
+private:
+	CThreadPool(const CThreadPool&);
+	CThreadPool& operator=(const CThreadPool&);
+
+	void WorkerLoop();
+	void RunBands();
+
+	unsigned int m_uWorkers;
+	std::vector<std::thread> m_Threads;
+
+	// serializes ParallelFor callers
+	std::mutex m_JobLock;
+
+	std::mutex m_Lock;
+	std::condition_variable m_WakeWorkers;
+	std::condition_variable m_JobDone;
+	bool m_bQuit;
+	// bumped for every job so parked workers can tell a new one arrived
+	unsigned int m_uGeneration;
+	// workers that have not finished the current job yet
+	unsigned int m_uBusy;
+
+	// current job
+	const BAND_FUNC *m_pfnBand;
+	unsigned int m_uBegin;
+	unsigned int m_uBandSize;
+	unsigned int m_uBandCount;
+	unsigned int m_uEnd;
+	std::atomic<unsigned int> m_uNextBand;
+};
@@ -0,0 +1,69 @@
+#pragma once
+// TrafficLanes.h
+// Drives the traffic cars of CEntityStore. Each lane keeps its cars in a
+// queue ordered from the front (furthest down the road) to the back, so a
+// car only ever looks at its neighbours: it follows the car ahead at a
+// safe distance, and when that one is slower than it wants to go it
+// overtakes by changing to an adjacent lane with room. A car changing
+// lanes is queued in both until it is across, so the cars behind it in
+// either lane keep their distance. Cars of a lane never pass each other,
+// which keeps the queues in order without sorting them again.
+#include "EntityStore.h"
+#include <vector>
+#include <cstddef>
+
+class CTrafficLanes
+{
+public:
+	CTrafficLanes();
+
+	// Empty lanes centred on the given x, in any order
+	void Start(const double *pLaneX, int nLanes);
+
+	// Where a car may come into a lane: dTop, or above it when the lane is
+	// backed up that far. The car's bottom edge goes there.
+	double GetEntry(const CEntityStore &entities, int nLane, double dTop) const;
+
+	// A car created at the entry of a lane, cruising at dCruise
+	void Add(SEntityHandle h, int nLane, double dCruise);
+
+	// Sets the velocity of every car for the next dt seconds. Cars removed
+	// from the store since the last call leave their lanes first.
+	void Drive(CEntityStore &entities, double dt);
+
+	int GetLaneCount() const { return (int)m_Queues.size(); }
+	size_t GetQueued(int nLane) const { return m_Queues[nLane].size(); }
+	unsigned long GetLaneChanges() const { return m_uLaneChanges; }		// since it was made
+
+private:
+	struct SCar
+	{
+		SEntityHandle h;
+		double dCruise;
+		int nLane;
+		int nFromLane;						// lane being left, -1 when in one
+		unsigned int uStamp;				// Drive() call that last drove it
+	};
+
+	// First position in a lane's queue at or behind y
+	size_t Find(const CEntityStore &entities, int nLane, double y) const;
+	void Remove(const CEntityStore &entities, int nLane, SEntityHandle h);
+
+	// Room between the back of the car ahead and the front of this one
+	static double Gap(const CEntityStore &entities, size_t uAhead, size_t uCar);
+
+	void Follow(CEntityStore &entities, size_t uCar, const SCar &car, double dt);
+	void ChangeLanes(CEntityStore &entities, size_t uCar, SCar &car, double dt);
+	bool TryLane(CEntityStore &entities, size_t uCar, SCar &car, int nLane, double dLeaderVelocity);
+
+	std::vector<double> m_LaneX;
+	std::vector<int> m_Left, m_Right;			// adjacent lanes, -1 at the edges
+	std::vector<std::vector<SEntityHandle> > m_Queues;
+	std::vector<SCar> m_Cars;					// by slot
+	unsigned int m_uStamp;
+	unsigned long m_uLaneChanges;
+
+	// scratch for Drive()
+	std::vector<size_t> m_Cursor;
+	std::vector<SEntityHandle> m_Order;
+};
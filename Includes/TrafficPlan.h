@@ -0,0 +1,43 @@
+#pragma once
+// TrafficPlan.h
+// Where the cars of a level come onto the road: a lane and a distance down
+// the road for each, a batch at a time. A batch of n cars covers the next
+// n * spacing pixels of road. Its cars are dealt to lanes directly. Each
+// lane's cars are then spread at random over the room left in the lane by
+// the cars already planned, never closer than the gap (front to front).
+// Planning takes O(n log n) for n cars, draws a fixed number of random
+// values per car and never retries, so any number of cars can be planned.
+#include "Random.h"
+#include <vector>
+#include <cstddef>
+
+struct STrafficSlot
+{
+	double dDistance;				// road that passes before the car comes
+	int nLane;
+};
+
+class CTrafficPlan
+{
+public:
+	CTrafficPlan();
+
+	// Empty road of nLanes lanes, a car every dSpacing pixels on average
+	void Start(int nLanes, double dSpacing, double dGap);
+
+	// Appends the next nCars cars to slots in order of distance, after
+	// every car planned before
+	void Plan(CRandom &random, int nCars, std::vector<STrafficSlot> &slots);
+
+	double GetPlanned() const { return m_dPlanned; }
+
+private:
+	double m_dSpacing;
+	double m_dGap;
+	double m_dPlanned;						// road covered by the batches so far
+	std::vector<double> m_LaneFree;			// where each lane's next car may come
+
+	// scratch, kept between batches
+	std::vector<int> m_LaneCount;
+	std::vector<double> m_Offsets;
+};
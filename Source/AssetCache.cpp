@@ -0,0 +1,168 @@
+// AssetCache.cpp
+#include "AssetCache.h"
+#include "AtlasIndex.h"
+
+extern HINSTANCE g_hInst;
+
+CBitmapAsset::CBitmapAsset(HBITMAP hBitmap)
+{
+	mhBitmap = hBitmap;
+	GetObject(mhBitmap, sizeof(BITMAP), &mInfo);
+}
+
+CBitmapAsset::CBitmapAsset()
+{
+	mhBitmap = 0;
+	ZeroMemory(&mInfo, sizeof(BITMAP));
+}
+
+CBitmapAsset *CBitmapAsset::mapFile(const char *szFileName)
+{
+	CBitmapAsset *pAsset = new CBitmapAsset();
+
+	if(!pAsset->mMapping.Open(szFileName) ||
+		BmpParse(pAsset->mMapping.GetData(), pAsset->mMapping.GetSize(), pAsset->mLayout) != EBR_OK)
+	{
+		delete pAsset;
+		return NULL;
+	}
+
+	// what decode() will make: a 32 bit DIB section of the same size
+	pAsset->mInfo.bmWidth = pAsset->mLayout.lWidth;
+	pAsset->mInfo.bmHeight = pAsset->mLayout.lHeight;
+	pAsset->mInfo.bmWidthBytes = pAsset->mLayout.lWidth * 4;
+	pAsset->mInfo.bmPlanes = 1;
+	pAsset->mInfo.bmBitsPixel = 32;
+	return pAsset;
+}
+
+bool CBitmapAsset::decode()
+{
+	if(mhBitmap)
+		return true;
+
+	if(!mMapping.IsOpen())
+		return false;
+
+	BITMAPINFO bmi;
+	ZeroMemory(&bmi, sizeof(BITMAPINFO));
+	BmpMakeInfoHeader(mLayout.lWidth, mLayout.lHeight, bmi.bmiHeader);
+
+	void *pBits = NULL;
+	HBITMAP hBitmap = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &pBits, NULL, 0);
+	if(hBitmap && BmpDecode(mMapping.GetData(), mMapping.GetSize(), mLayout, (RGBQUAD*)pBits) != EBR_OK)
+	{
+		DeleteObject(hBitmap);
+		hBitmap = 0;
+	}
+
+	// decoded (or unreadable), the file pages are no longer needed
+	mMapping.Close();
+
+	if(!hBitmap)
+		return false;
+
+	mhBitmap = hBitmap;
+	GetObject(mhBitmap, sizeof(BITMAP), &mInfo);
+	return true;
+}
+
+HBITMAP CBitmapAsset::getBitmap()
+{
+	decode();
+	return mhBitmap;
+}
+
+CBitmapAsset::~CBitmapAsset()
+{
+	for(size_t i = 0; i < mMasks.size(); i++)
+		DeleteObject(mMasks[i].second);
+
+	if(mhBitmap)
+		DeleteObject(mhBitmap);
+}
+
+HBITMAP CBitmapAsset::getMask(COLORREF crTransparent)
+{
+	for(size_t i = 0; i < mMasks.size(); i++)
+	{
+		if(mMasks[i].first == crTransparent)
+			return mMasks[i].second;
+	}
+
+	if(!decode())
+		return 0;
+
+	HBITMAP hMask = CreateBitmap(mInfo.bmWidth, mInfo.bmHeight, 1, 1, NULL);
+	if(!hMask)
+		return 0;
+
+	HDC dcImage = CreateCompatibleDC(NULL);
+	HDC dcMask = CreateCompatibleDC(NULL);
+	HGDIOBJ oldImage = SelectObject(dcImage, mhBitmap);
+	HGDIOBJ oldMask = SelectObject(dcMask, hMask);
+
+	// Blitting colour to monochrome turns pixels of the background colour
+	// white and everything else black.
+	SetBkColor(dcImage, crTransparent);
+	BitBlt(dcMask, 0, 0, mInfo.bmWidth, mInfo.bmHeight, dcImage, 0, 0, SRCCOPY);
+
+	SelectObject(dcImage, oldImage);
+	SelectObject(dcMask, oldMask);
+	DeleteDC(dcImage);
+	DeleteDC(dcMask);
+
+	mMasks.push_back(std::make_pair(crTransparent, hMask));
+	return hMask;
+}
+
+CAssetCache &CAssetCache::instance()
+{
+	static CAssetCache cache;
+	return cache;
+}
+
+BitmapAssetPtr CAssetCache::loadBitmap(const char *szFileName, ELoadMode eMode)
+{
+	// "data\\Car1.bmp" and "data/car1.bmp" are the same file
+	std::string strKey = CAtlasIndex::NormalizeName(szFileName);
+
+	std::unordered_map<std::string, BitmapAssetPtr>::iterator it = mBitmaps.find(strKey);
+	if(it != mBitmaps.end())
+		return it->second;
+
+	BitmapAssetPtr pAsset;
+	if(eMode == ELM_MAPPED)
+	{
+		pAsset.reset(CBitmapAsset::mapFile(szFileName));
+	}
+	else
+	{
+		HBITMAP hBitmap = (HBITMAP)LoadImage(g_hInst, szFileName, IMAGE_BITMAP, 0, 0, LR_CREATEDIBSECTION | LR_LOADFROMFILE);
+		if(hBitmap)
+			pAsset.reset(new CBitmapAsset(hBitmap));
+	}
+
+	if(!pAsset)
+		return BitmapAssetPtr();
+
+	mBitmaps[strKey] = pAsset;
+	return pAsset;
+}
+
+void CAssetCache::trim()
+{
+	std::unordered_map<std::string, BitmapAssetPtr>::iterator it = mBitmaps.begin();
+	while(it != mBitmaps.end())
+	{
+		if(it->second.use_count() == 1)
+			it = mBitmaps.erase(it);
+		else
+			++it;
+	}
+}
+
+void CAssetCache::clear()
+{
+	mBitmaps.clear();
+}
@@ -0,0 +1,191 @@
+// AtlasIndex.cpp
+#include "AtlasIndex.h"
+#include <fstream>
+#include <algorithm>
+#include <ctype.h>
+
+namespace
+{
+	bool ReadWord(std::istream &in, WORD &w)
+	{
+		BYTE b[2];
+		if(!in.read((char*)b, 2))
+			return false;
+		w = (WORD)(b[0] | (b[1] << 8));
+		return true;
+	}
+
+	bool ReadDword(std::istream &in, DWORD &d)
+	{
+		BYTE b[4];
+		if(!in.read((char*)b, 4))
+			return false;
+		d = (DWORD)b[0] | ((DWORD)b[1] << 8) | ((DWORD)b[2] << 16) | ((DWORD)b[3] << 24);
+		return true;
+	}
+
+	bool ReadString(std::istream &in, std::string &str)
+	{
+		WORD uLength;
+		if(!ReadWord(in, uLength))
+			return false;
+		str.resize(uLength);
+		return uLength == 0 || (bool)in.read(&str[0], uLength);
+	}
+
+	void WriteWord(std::ostream &out, WORD w)
+	{
+		char b[2] = { (char)w, (char)(w >> 8) };
+		out.write(b, 2);
+	}
+
+	void WriteDword(std::ostream &out, DWORD d)
+	{
+		char b[4] = { (char)d, (char)(d >> 8), (char)(d >> 16), (char)(d >> 24) };
+		out.write(b, 4);
+	}
+
+	void WriteString(std::ostream &out, const std::string &str)
+	{
+		WriteWord(out, (WORD)str.size());
+		out.write(str.data(), str.size());
+	}
+
+	bool EntryLess(const SAtlasEntry &a, const SAtlasEntry &b)
+	{
+		return a.strName < b.strName;
+	}
+}
+
+void CAtlasIndex::Clear()
+{
+	m_Pages.clear();
+	m_Entries.clear();
+}
+
+std::string CAtlasIndex::NormalizeName(const char *szName)
+{
+	std::string strName(szName);
+	for(size_t i = 0; i < strName.size(); i++)
+	{
+		if(strName[i] == '\\')
+			strName[i] = '/';
+		else
+			strName[i] = (char)tolower((unsigned char)strName[i]);
+	}
+
+	while(strName.compare(0, 2, "./") == 0)
+		strName.erase(0, 2);
+
+	return strName;
+}
+
+WORD CAtlasIndex::AddPage(const std::string &strPage)
+{
+	m_Pages.push_back(strPage);
+	return (WORD)(m_Pages.size() - 1);
+}
+
+void CAtlasIndex::AddEntry(const SAtlasEntry &entry)
+{
+	SAtlasEntry e = entry;
+	e.strName = NormalizeName(entry.strName.c_str());
+
+	std::vector<SAtlasEntry>::iterator it = std::lower_bound(m_Entries.begin(), m_Entries.end(), e, EntryLess);
+	if(it != m_Entries.end() && it->strName == e.strName)
+		*it = e;
+	else
+		m_Entries.insert(it, e);
+}
+
+const SAtlasEntry *CAtlasIndex::Find(const char *szName) const
+{
+	SAtlasEntry key;
+	key.strName = NormalizeName(szName);
+
+	std::vector<SAtlasEntry>::const_iterator it = std::lower_bound(m_Entries.begin(), m_Entries.end(), key, EntryLess);
+	if(it == m_Entries.end() || it->strName != key.strName)
+		return NULL;
+
+	return &*it;
+}
+
+bool CAtlasIndex::Load(const char *szFileName)
+{
+	Clear();
+
+	std::ifstream in(szFileName, std::ios::binary);
+	if(!in)
+		return false;
+
+	DWORD uMagic, uVersion, uPages, uEntries;
+	if(!ReadDword(in, uMagic) || !ReadDword(in, uVersion) || !ReadDword(in, uPages) || !ReadDword(in, uEntries) ||
+		uMagic != ATLAS_MAGIC || uVersion != ATLAS_VERSION)
+		return false;
+
+	for(DWORD i = 0; i < uPages; i++)
+	{
+		std::string strPage;
+		if(!ReadString(in, strPage))
+		{
+			Clear();
+			return false;
+		}
+		m_Pages.push_back(strPage);
+	}
+
+	m_Entries.reserve(uEntries);
+	for(DWORD i = 0; i < uEntries; i++)
+	{
+		SAtlasEntry e;
+		WORD uLeft, uTop, uWidth, uHeight;
+		DWORD crKey;
+		if(!ReadString(in, e.strName) || !ReadWord(in, e.uPage) ||
+			!ReadWord(in, uLeft) || !ReadWord(in, uTop) || !ReadWord(in, uWidth) || !ReadWord(in, uHeight) ||
+			!ReadDword(in, crKey) || e.uPage >= m_Pages.size())
+		{
+			Clear();
+			return false;
+		}
+
+		e.rcSource.left = uLeft;
+		e.rcSource.top = uTop;
+		e.rcSource.right = uLeft + uWidth;
+		e.rcSource.bottom = uTop + uHeight;
+		e.crTransparent = crKey;
+		m_Entries.push_back(e);
+	}
+
+	// the packer writes them sorted, but do not rely on it
+	std::sort(m_Entries.begin(), m_Entries.end(), EntryLess);
+	return true;
+}
+
+bool CAtlasIndex::Save(const char *szFileName) const
+{
+	std::ofstream out(szFileName, std::ios::binary);
+	if(!out)
+		return false;
+
+	WriteDword(out, ATLAS_MAGIC);
+	WriteDword(out, ATLAS_VERSION);
+	WriteDword(out, (DWORD)m_Pages.size());
+	WriteDword(out, (DWORD)m_Entries.size());
+
+	for(size_t i = 0; i < m_Pages.size(); i++)
+		WriteString(out, m_Pages[i]);
+
+	for(size_t i = 0; i < m_Entries.size(); i++)
+	{
+		const SAtlasEntry &e = m_Entries[i];
+		WriteString(out, e.strName);
+		WriteWord(out, e.uPage);
+		WriteWord(out, (WORD)e.rcSource.left);
+		WriteWord(out, (WORD)e.rcSource.top);
+		WriteWord(out, (WORD)(e.rcSource.right - e.rcSource.left));
+		WriteWord(out, (WORD)(e.rcSource.bottom - e.rcSource.top));
+		WriteDword(out, e.crTransparent);
+	}
+
+	return (bool)out;
+}
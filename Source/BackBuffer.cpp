@@ -21,14 +21,33 @@ BackBuffer::BackBuffer(HWND hWnd, int width, int height)
 	// with the window one.
 	mhDC = CreateCompatibleDC(hWndDC);
 
-	// Create the backbuffer surface bitmap that is compatible
-	// with the window device context bitmap format. That is
-	// the surface we will render onto.
-	mhSurface = CreateCompatibleBitmap(hWndDC, width, height);
+	// Create the backbuffer surface as a top-down 32-bit DIB section
+	// so that, besides GDI drawing through mhDC, the pixels can be
+	// written directly by the software framebuffer.
+	BITMAPINFO bmi;
+	ZeroMemory(&bmi, sizeof(bmi));
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = width;
+	bmi.bmiHeader.biHeight = -height;
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	void *pBits = NULL;
+	mhSurface = CreateDIBSection(hWndDC, &bmi, DIB_RGB_COLORS, &pBits, NULL, 0);
+	mFramebuffer.Attach((DWORD*)pBits, width, height, width);
 
 	// Done with window DC.
 	ReleaseDC(hWnd, hWndDC);
 
+	// Select the backbuffer bitmap into the DC.
+	mhOldObject = (HBITMAP)SelectObject(mhDC, mhSurface);
+
+	// Nothing has reached the window yet.
+	mClearPixel = 0x00FFFFFF;
+	mTrackFrame = 0;
+	invalidateAll();
+
 	// At this point, the back buffer surface is uninitialized,
 	// so lets clear it to some non-zero value. Note that it
 	// needs to be non-zero. If it is zero then it will mess
@@ -38,37 +57,159 @@ BackBuffer::BackBuffer(HWND hWnd, int width, int height)
 
 void BackBuffer::reset()
 {
-	// Select the backbuffer bitmap into the DC.
-	mhOldObject = (HBITMAP)SelectObject(mhDC, mhSurface);
+	// Make sure GDI is done with the surface before writing it.
+	GdiFlush();
+
+	// Clear the dirty rectangles.
+	mFramebuffer.ResetClipRect();
+	for(size_t i = 0; i < mDirty.size(); i++)
+		mFramebuffer.FillRect(mDirty[i], mClearPixel);
+
+	// Clip the sprites drawn through the DC to the same region.
+	HRGN hRegion = CreateRectRgn(0, 0, 0, 0);
+	for(size_t i = 0; i < mDirty.size(); i++)
+	{
+		HRGN hRect = CreateRectRgnIndirect(&mDirty[i]);
+		CombineRgn(hRegion, hRegion, hRect, RGN_OR);
+		DeleteObject(hRect);
+	}
+
+	SelectClipRgn(mhDC, hRegion);
+	DeleteObject(hRegion);
+}
 
-	// Select a white brush.
-	HBRUSH white = (HBRUSH)GetStockObject(WHITE_BRUSH);
-	HBRUSH oldBrush = (HBRUSH)SelectObject(mhDC, white);
+void BackBuffer::invalidate(const RECT &rc)
+{
+	RECT rcSurface = { 0, 0, mWidth, mHeight };
+	RECT rcDirty;
+	if(!IntersectRect(&rcDirty, &rc, &rcSurface))
+		return;
+
+	// Swallow every rectangle the new one overlaps so the list stays
+	// disjoint; a grown rectangle may overlap earlier ones, so rescan.
+	size_t i = 0;
+	while(i < mDirty.size())
+	{
+		RECT rcCommon;
+		if(IntersectRect(&rcCommon, &rcDirty, &mDirty[i]))
+		{
+			UnionRect(&rcDirty, &rcDirty, &mDirty[i]);
+			mDirty[i] = mDirty.back();
+			mDirty.pop_back();
+			i = 0;
+		}
+		else
+			i++;
+	}
+
+	mDirty.push_back(rcDirty);
+
+	if(mDirty.size() > MAX_DIRTY_RECTS)
+	{
+		for(i = 1; i < mDirty.size(); i++)
+			UnionRect(&mDirty[0], &mDirty[0], &mDirty[i]);
+		mDirty.resize(1);
+	}
+}
 
-	// Clear the backbuffer rectangle.
-	Rectangle(mhDC, 0, 0, mWidth, mHeight);
+void BackBuffer::invalidateAll()
+{
+	RECT rcSurface = { 0, 0, mWidth, mHeight };
+	mDirty.assign(1, rcSurface);
+}
 
-	// Restore the original brush.
-	SelectObject(mhDC, oldBrush);
+bool BackBuffer::isVisible(const RECT &rc) const
+{
+	RECT rcCommon;
+	for(size_t i = 0; i < mDirty.size(); i++)
+	{
+		if(IntersectRect(&rcCommon, &rc, &mDirty[i]))
+			return true;
+	}
+
+	return false;
+}
+
+void BackBuffer::track(const void *pItem, const RECT &rcBounds, const void *pImage, POINT ptSource)
+{
+	std::unordered_map<const void*, SDrawRecord>::iterator it = mDrawn.find(pItem);
+	if(it == mDrawn.end())
+	{
+		// Appeared this frame.
+		invalidate(rcBounds);
+		it = mDrawn.insert(std::make_pair(pItem, SDrawRecord())).first;
+	}
+	else
+	{
+		SDrawRecord &rec = it->second;
+		if(!EqualRect(&rec.rcBounds, &rcBounds) || rec.pImage != pImage ||
+			rec.ptSource.x != ptSource.x || rec.ptSource.y != ptSource.y)
+		{
+			invalidate(rec.rcBounds);
+			invalidate(rcBounds);
+		}
+	}
+
+	SDrawRecord &rec = it->second;
+	rec.rcBounds = rcBounds;
+	rec.pImage = pImage;
+	rec.ptSource = ptSource;
+	rec.uFrame = mTrackFrame;
+}
+
+void BackBuffer::endTracking()
+{
+	// Whatever was not drawn this frame has to be erased.
+	std::unordered_map<const void*, SDrawRecord>::iterator it = mDrawn.begin();
+	while(it != mDrawn.end())
+	{
+		if(it->second.uFrame != mTrackFrame)
+		{
+			invalidate(it->second.rcBounds);
+			it = mDrawn.erase(it);
+		}
+		else
+			++it;
+	}
+
+	mTrackFrame++;
 }
 
 BackBuffer::~BackBuffer()
 {
 	SelectObject(mhDC, mhOldObject);
+	mFramebuffer.Release();
 	DeleteObject(mhSurface);
 	DeleteDC(mhDC);
 }
 
 void BackBuffer::present()
 {
+	if(mDirty.empty())
+		return;
+
 	// Get a handle to the device context associated with
 	// the window.
 	HDC hWndDC = GetDC(mhWnd);
 
-	// Copy the backbuffer contents over to the
+	// Copy the dirty parts of the backbuffer over to the
 	// window client area.
-	BitBlt(hWndDC, 0, 0, mWidth, mHeight, mhDC, 0, 0, SRCCOPY);
+	for(size_t i = 0; i < mDirty.size(); i++)
+	{
+		const RECT &rc = mDirty[i];
+		BitBlt(hWndDC, rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top,
+			mhDC, rc.left, rc.top, SRCCOPY);
+	}
 
 	// Always free window DC when done.
 	ReleaseDC(mhWnd, hWndDC);
+
+	// The window is up to date again.
+	validate();
+}
+
+void BackBuffer::validate()
+{
+	mDirty.clear();
+	SelectClipRgn(mhDC, NULL);
 }
\ No newline at end of file
@@ -0,0 +1,491 @@
+// BmpCodec.cpp
+// Headers are read and written byte by byte (little endian), so the code
+// does not depend on struct packing or on the host byte order.
+#include "BmpCodec.h"
+#include <string.h>
+
+// Largest header + bit masks + palette block we ever need to look at
+#define BMP_MAX_HEADER_BYTES	(BMP_FILEHEADER_SIZE + 124 + 12 + 256 * 4)
+
+static inline WORD ReadWord(const BYTE *p)
+{
+	return (WORD)(p[0] | (p[1] << 8));
+}
+
+static inline DWORD ReadDword(const BYTE *p)
+{
+	return (DWORD)p[0] | ((DWORD)p[1] << 8) | ((DWORD)p[2] << 16) | ((DWORD)p[3] << 24);
+}
+
+static inline void WriteWord(BYTE *p, WORD w)
+{
+	p[0] = (BYTE)w;
+	p[1] = (BYTE)(w >> 8);
+}
+
+static inline void WriteDword(BYTE *p, DWORD d)
+{
+	p[0] = (BYTE)d;
+	p[1] = (BYTE)(d >> 8);
+	p[2] = (BYTE)(d >> 16);
+	p[3] = (BYTE)(d >> 24);
+}
+
+static FILE *OpenFile(const char *szFileName, const char *szMode)
+{
+#ifdef _MSC_VER
+	FILE *pFile = NULL;
+	if (fopen_s(&pFile, szFileName, szMode) != 0)
+		return NULL;
+	return pFile;
+#else
+	return fopen(szFileName, szMode);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Reading
+//-----------------------------------------------------------------------------
+EBmpResult BmpParse(const BYTE *pFile, size_t uSize, SBmpLayout &layout)
+{
+	if (uSize < BMP_FILEHEADER_SIZE + 12 || pFile[0] != 'B' || pFile[1] != 'M')
+		return EBR_BADFORMAT;
+
+	layout.uPixelOffset = ReadDword(pFile + 10);
+
+	const BYTE *pInfo = pFile + BMP_FILEHEADER_SIZE;
+	DWORD uInfoSize = ReadDword(pInfo);
+	DWORD uCompression = BI_RGB;
+	DWORD uClrUsed = 0;
+	DWORD uPaletteEntrySize = 4;
+	LONG lHeight;
+
+	if (uInfoSize == 12)
+	{
+		// OS/2 style BITMAPCOREHEADER, 16-bit sizes and 3-byte palette entries
+		layout.lWidth = ReadWord(pInfo + 4);
+		lHeight = (short)ReadWord(pInfo + 6);
+		layout.uBitCount = ReadWord(pInfo + 10);
+		uPaletteEntrySize = 3;
+	}
+	else if (uInfoSize >= 40)
+	{
+		if (uSize < BMP_FILEHEADER_SIZE + 40)
+			return EBR_BADFORMAT;
+
+		layout.lWidth = (LONG)ReadDword(pInfo + 4);
+		lHeight = (LONG)ReadDword(pInfo + 8);
+		layout.uBitCount = ReadWord(pInfo + 14);
+		uCompression = ReadDword(pInfo + 16);
+		uClrUsed = ReadDword(pInfo + 32);
+	}
+	else
+	{
+		return EBR_BADFORMAT;
+	}
+
+	if (layout.lWidth <= 0 || lHeight == 0 || lHeight == (LONG)0x80000000)
+		return EBR_BADFORMAT;
+
+	layout.bTopDown = lHeight < 0;
+	layout.lHeight = lHeight < 0 ? -lHeight : lHeight;
+
+	// masks follow a plain BITMAPINFOHEADER, larger headers embed them
+	const BYTE *pExtra = pInfo + uInfoSize;
+	if (uCompression == BI_BITFIELDS)
+	{
+		if (layout.uBitCount != 32)
+			return EBR_UNSUPPORTED;
+
+		const BYTE *pMasks = uInfoSize == 40 ? pExtra : pInfo + 40;
+		if (pMasks + 12 > pFile + uSize)
+			return EBR_BADFORMAT;
+
+		// only the layout that matches RGBQUAD
+		if (ReadDword(pMasks) != 0x00FF0000 || ReadDword(pMasks + 4) != 0x0000FF00 || ReadDword(pMasks + 8) != 0x000000FF)
+			return EBR_UNSUPPORTED;
+
+		if (uInfoSize == 40)
+			pExtra += 12;
+	}
+	else if (uCompression != BI_RGB)
+	{
+		return EBR_UNSUPPORTED;
+	}
+
+	switch (layout.uBitCount)
+	{
+	case 1:
+	case 4:
+	case 8:
+		layout.uColors = uClrUsed ? uClrUsed : (1u << layout.uBitCount);
+		if (layout.uColors > (1u << layout.uBitCount))
+			return EBR_BADFORMAT;
+		break;
+
+	case 24:
+	case 32:
+		layout.uColors = 0;
+		break;
+
+	default:
+		return EBR_UNSUPPORTED;
+	}
+
+	// palette entries are stored B, G, R(, reserved)
+	if (pExtra + layout.uColors * uPaletteEntrySize > pFile + uSize)
+		return EBR_BADFORMAT;
+
+	ZeroMemory(layout.Palette, sizeof(layout.Palette));
+	for (DWORD i = 0; i < layout.uColors; i++)
+	{
+		const BYTE *p = pExtra + i * uPaletteEntrySize;
+		layout.Palette[i].rgbBlue = p[0];
+		layout.Palette[i].rgbGreen = p[1];
+		layout.Palette[i].rgbRed = p[2];
+		layout.Palette[i].rgbReserved = 0;
+	}
+
+	// rows are padded to whole DWORDs, reject sizes that overflow 32 bits
+	unsigned long long uStride = (((unsigned long long)layout.lWidth * layout.uBitCount + 31) / 32) * 4;
+	if (uStride * layout.lHeight > 0xFFFFFFFFull || (unsigned long long)layout.lWidth * layout.lHeight * sizeof(RGBQUAD) > 0xFFFFFFFFull)
+		return EBR_UNSUPPORTED;
+
+	layout.uStride = (DWORD)uStride;
+	return EBR_OK;
+}
+
+void BmpConvertRow(const SBmpLayout &layout, const BYTE *pRow, RGBQUAD *pDst)
+{
+	LONG x;
+
+	switch (layout.uBitCount)
+	{
+	case 32:
+		// stored exactly like RGBQUAD
+		memcpy(pDst, pRow, layout.lWidth * sizeof(RGBQUAD));
+		break;
+
+	case 24:
+		for (x = 0; x < layout.lWidth; x++)
+		{
+			pDst[x].rgbBlue = pRow[0];
+			pDst[x].rgbGreen = pRow[1];
+			pDst[x].rgbRed = pRow[2];
+			pDst[x].rgbReserved = 0;
+			pRow += 3;
+		}
+		break;
+
+	case 8:
+		for (x = 0; x < layout.lWidth; x++)
+			pDst[x] = layout.Palette[pRow[x]];
+		break;
+
+	case 4:
+		for (x = 0; x < layout.lWidth; x++)
+			pDst[x] = layout.Palette[(pRow[x >> 1] >> ((x & 1) ? 0 : 4)) & 0x0F];
+		break;
+
+	case 1:
+		for (x = 0; x < layout.lWidth; x++)
+			pDst[x] = layout.Palette[(pRow[x >> 3] >> (7 - (x & 7))) & 0x01];
+		break;
+	}
+}
+
+EBmpResult BmpDecode(const BYTE *pFile, size_t uSize, const SBmpLayout &layout, RGBQUAD *pDst)
+{
+	if ((unsigned long long)layout.uPixelOffset + (unsigned long long)layout.uStride * layout.lHeight > uSize)
+		return EBR_BADFORMAT;
+
+	const BYTE *pPixels = pFile + layout.uPixelOffset;
+	for (LONG y = 0; y < layout.lHeight; y++)
+	{
+		BmpConvertRow(layout, pPixels + BmpStoredRow(layout, y) * layout.uStride, pDst + y * layout.lWidth);
+	}
+
+	return EBR_OK;
+}
+
+void BmpMakeInfoHeader(LONG lWidth, LONG lHeight, BITMAPINFOHEADER &bi)
+{
+	ZeroMemory(&bi, sizeof(BITMAPINFOHEADER));
+	bi.biSize = sizeof(BITMAPINFOHEADER);
+	bi.biWidth = lWidth;
+	bi.biHeight = lHeight;
+	bi.biPlanes = 1;
+	bi.biBitCount = 32;
+	bi.biCompression = BI_RGB;
+	bi.biSizeImage = lWidth * lHeight * sizeof(RGBQUAD);
+}
+
+EBmpResult BmpLoadFile(const char *szFileName, BITMAPINFOHEADER &bi, RGBQUAD *&pPixels)
+{
+	BYTE Header[BMP_MAX_HEADER_BYTES];
+	SBmpLayout layout;
+
+	pPixels = NULL;
+
+	FILE *pFile = OpenFile(szFileName, "rb");
+	if (!pFile)
+		return EBR_IOERROR;
+
+	// headers and palette, whatever precedes the pixels (up to our maximum)
+	size_t uHeaderSize = fread(Header, 1, sizeof(Header), pFile);
+	EBmpResult eResult = BmpParse(Header, uHeaderSize, layout);
+	if (eResult != EBR_OK)
+	{
+		fclose(pFile);
+		return eResult;
+	}
+
+	if (fseek(pFile, layout.uPixelOffset, SEEK_SET) != 0)
+	{
+		fclose(pFile);
+		return EBR_BADFORMAT;
+	}
+
+	pPixels = new RGBQUAD[layout.lWidth * layout.lHeight];
+	bool bRead = true;
+
+	if (BmpIsNativeLayout(layout))
+	{
+		// same layout on disk and in memory, read straight into place
+		bRead = fread(pPixels, layout.uStride, layout.lHeight, pFile) == (size_t)layout.lHeight;
+	}
+	else if (layout.uBitCount == 32)
+	{
+		for (LONG y = layout.lHeight - 1; y >= 0 && bRead; y--)
+			bRead = fread(pPixels + y * layout.lWidth, layout.uStride, 1, pFile) == 1;
+	}
+	else
+	{
+		// stored rows are converted one at a time through a single row buffer
+		BYTE *pRow = new BYTE[layout.uStride];
+		for (LONG i = 0; i < layout.lHeight && bRead; i++)
+		{
+			bRead = fread(pRow, layout.uStride, 1, pFile) == 1;
+			if (!bRead)
+				break;
+
+			LONG y = BmpStoredRow(layout, i);
+			BmpConvertRow(layout, pRow, pPixels + y * layout.lWidth);
+		}
+		delete[] pRow;
+	}
+
+	fclose(pFile);
+
+	if (!bRead)
+	{
+		delete[] pPixels;
+		pPixels = NULL;
+		return EBR_BADFORMAT;
+	}
+
+	BmpMakeInfoHeader(layout.lWidth, layout.lHeight, bi);
+	return EBR_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Row by row reading
+//-----------------------------------------------------------------------------
+CBmpReader::CBmpReader()
+{
+	m_pFile = NULL;
+	m_pRowBuffer = NULL;
+	m_lRowsRead = m_lNextStored = 0;
+	ZeroMemory(&m_Layout, sizeof(m_Layout));
+}
+
+CBmpReader::~CBmpReader()
+{
+	Close();
+}
+
+EBmpResult CBmpReader::Open(const char *szFileName)
+{
+	BYTE Header[BMP_MAX_HEADER_BYTES];
+
+	Close();
+
+	m_pFile = OpenFile(szFileName, "rb");
+	if (!m_pFile)
+		return EBR_IOERROR;
+
+	size_t uHeaderSize = fread(Header, 1, sizeof(Header), m_pFile);
+	EBmpResult eResult = BmpParse(Header, uHeaderSize, m_Layout);
+	if (eResult == EBR_OK && fseek(m_pFile, m_Layout.uPixelOffset, SEEK_SET) != 0)
+		eResult = EBR_BADFORMAT;
+
+	if (eResult != EBR_OK)
+	{
+		Close();
+		return eResult;
+	}
+
+	m_lRowsRead = m_lNextStored = 0;
+	m_pRowBuffer = new BYTE[m_Layout.uStride];
+	return EBR_OK;
+}
+
+EBmpResult CBmpReader::ReadRow(RGBQUAD *pRow)
+{
+	if (!m_pFile || m_lRowsRead >= m_Layout.lHeight)
+		return EBR_IOERROR;
+
+	LONG lStored = BmpStoredRow(m_Layout, m_lRowsRead);
+	if (lStored != m_lNextStored)
+	{
+		long lOffset = (long)(m_Layout.uPixelOffset + (DWORD)lStored * m_Layout.uStride);
+		if (fseek(m_pFile, lOffset, SEEK_SET) != 0)
+			return EBR_BADFORMAT;
+	}
+
+	if (fread(m_pRowBuffer, m_Layout.uStride, 1, m_pFile) != 1)
+		return EBR_BADFORMAT;
+
+	m_lNextStored = lStored + 1;
+	m_lRowsRead++;
+	BmpConvertRow(m_Layout, m_pRowBuffer, pRow);
+	return EBR_OK;
+}
+
+void CBmpReader::Close()
+{
+	if (m_pFile)
+		fclose(m_pFile);
+	m_pFile = NULL;
+
+	delete[] m_pRowBuffer;
+	m_pRowBuffer = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Writing
+//-----------------------------------------------------------------------------
+CBmpWriter::CBmpWriter()
+{
+	m_pFile = NULL;
+	m_pRowBuffer = NULL;
+	m_lWidth = m_lHeight = m_lRowsWritten = 0;
+	m_uBitCount = 0;
+	m_uStride = 0;
+}
+
+CBmpWriter::~CBmpWriter()
+{
+	if (m_pFile)
+		fclose(m_pFile);
+
+	delete[] m_pRowBuffer;
+}
+
+EBmpResult CBmpWriter::Open(const char *szFileName, LONG lWidth, LONG lHeight, WORD uBitCount, bool bTopDown)
+{
+	if (m_pFile)
+		Close();
+
+	if (lWidth <= 0 || lHeight <= 0 || (uBitCount != 24 && uBitCount != 32))
+		return EBR_UNSUPPORTED;
+
+	m_pFile = OpenFile(szFileName, "wb");
+	if (!m_pFile)
+		return EBR_IOERROR;
+
+	m_lWidth = lWidth;
+	m_lHeight = lHeight;
+	m_lRowsWritten = 0;
+	m_uBitCount = uBitCount;
+	m_uStride = ((lWidth * uBitCount + 31) / 32) * 4;
+
+	delete[] m_pRowBuffer;
+	m_pRowBuffer = new BYTE[m_uStride];
+	ZeroMemory(m_pRowBuffer, m_uStride);
+
+	// BITMAPFILEHEADER followed by a plain BITMAPINFOHEADER
+	BYTE Header[BMP_FILEHEADER_SIZE + 40];
+	DWORD uImageSize = m_uStride * lHeight;
+	ZeroMemory(Header, sizeof(Header));
+
+	Header[0] = 'B';
+	Header[1] = 'M';
+	WriteDword(Header + 2, sizeof(Header) + uImageSize);
+	WriteDword(Header + 10, sizeof(Header));
+
+	BYTE *pInfo = Header + BMP_FILEHEADER_SIZE;
+	WriteDword(pInfo, 40);
+	WriteDword(pInfo + 4, lWidth);
+	WriteDword(pInfo + 8, bTopDown ? -lHeight : lHeight);
+	WriteWord(pInfo + 12, 1);
+	WriteWord(pInfo + 14, uBitCount);
+	WriteDword(pInfo + 16, BI_RGB);
+	WriteDword(pInfo + 20, uImageSize);
+	WriteDword(pInfo + 24, 2835);	// 72 dpi
+	WriteDword(pInfo + 28, 2835);
+
+	if (fwrite(Header, sizeof(Header), 1, m_pFile) != 1)
+	{
+		fclose(m_pFile);
+		m_pFile = NULL;
+		return EBR_IOERROR;
+	}
+
+	return EBR_OK;
+}
+
+EBmpResult CBmpWriter::WriteRow(const RGBQUAD *pRow)
+{
+	if (!m_pFile || m_lRowsWritten >= m_lHeight)
+		return EBR_IOERROR;
+
+	const void *pData = pRow;
+	if (m_uBitCount == 24)
+	{
+		// padding bytes at the end of m_pRowBuffer stay zero
+		BYTE *p = m_pRowBuffer;
+		for (LONG x = 0; x < m_lWidth; x++)
+		{
+			*p++ = pRow[x].rgbBlue;
+			*p++ = pRow[x].rgbGreen;
+			*p++ = pRow[x].rgbRed;
+		}
+		pData = m_pRowBuffer;
+	}
+
+	if (fwrite(pData, m_uStride, 1, m_pFile) != 1)
+		return EBR_IOERROR;
+
+	m_lRowsWritten++;
+	return EBR_OK;
+}
+
+EBmpResult CBmpWriter::Close()
+{
+	if (!m_pFile)
+		return EBR_IOERROR;
+
+	bool bComplete = m_lRowsWritten == m_lHeight;
+	bool bClosed = fclose(m_pFile) == 0;
+	m_pFile = NULL;
+
+	delete[] m_pRowBuffer;
+	m_pRowBuffer = NULL;
+
+	return (bComplete && bClosed) ? EBR_OK : EBR_IOERROR;
+}
+
+EBmpResult BmpSaveFile(const char *szFileName, const RGBQUAD *pPixels, LONG lWidth, LONG lHeight, WORD uBitCount)
+{
+	CBmpWriter writer;
+
+	EBmpResult eResult = writer.Open(szFileName, lWidth, lHeight, uBitCount);
+	for (LONG y = 0; y < lHeight && eResult == EBR_OK; y++)
+		eResult = writer.WriteRow(pPixels + y * lWidth);
+
+	if (eResult != EBR_OK)
+		return eResult;
+
+	return writer.Close();
+}
@@ -0,0 +1,170 @@
+// BroadPhase.cpp
+#include "BroadPhase.h"
+#include <algorithm>
+#include <math.h>
+
+// Upper bound on the number of cells along one axis; larger areas get
+// larger cells instead
+#define BROADPHASE_MAX_CELLS	256
+
+CBroadPhase::CBroadPhase()
+{
+	m_dCellSize = 128.0;
+	m_dOriginX = m_dOriginY = 0.0;
+	m_dCell = m_dCellSize;
+	m_nColumns = m_nRows = 0;
+	m_uQuery = 0;
+}
+
+void CBroadPhase::Clear()
+{
+	m_Boxes.clear();
+	m_Ids.clear();
+	m_CellStart.clear();
+	m_CellItems.clear();
+	m_nColumns = m_nRows = 0;
+}
+
+void CBroadPhase::Insert(unsigned int uId, const SAabb &box)
+{
+	m_Boxes.push_back(box);
+	m_Ids.push_back(uId);
+}
+
+void CBroadPhase::Build()
+{
+	m_CellStart.clear();
+	m_CellItems.clear();
+	m_Stamp.assign(m_Boxes.size(), 0);
+	m_uQuery = 0;
+
+	if(m_Boxes.empty())
+	{
+		m_nColumns = m_nRows = 0;
+		return;
+	}
+
+	// the grid spans exactly the inserted boxes
+	SAabb extent = m_Boxes[0];
+	for(size_t i = 1; i < m_Boxes.size(); i++)
+	{
+		extent.left = std::min(extent.left, m_Boxes[i].left);
+		extent.top = std::min(extent.top, m_Boxes[i].top);
+		extent.right = std::max(extent.right, m_Boxes[i].right);
+		extent.bottom = std::max(extent.bottom, m_Boxes[i].bottom);
+	}
+
+	double dWidth = extent.right - extent.left;
+	double dHeight = extent.bottom - extent.top;
+
+	m_dCell = m_dCellSize;
+	if(dWidth / m_dCell > BROADPHASE_MAX_CELLS)
+		m_dCell = dWidth / BROADPHASE_MAX_CELLS;
+	if(dHeight / m_dCell > BROADPHASE_MAX_CELLS)
+		m_dCell = dHeight / BROADPHASE_MAX_CELLS;
+
+	m_dOriginX = extent.left;
+	m_dOriginY = extent.top;
+	m_nColumns = std::max(1, std::min(BROADPHASE_MAX_CELLS, (int)(dWidth / m_dCell) + 1));
+	m_nRows = std::max(1, std::min(BROADPHASE_MAX_CELLS, (int)(dHeight / m_dCell) + 1));
+
+	// counting sort of the boxes into their cells
+	m_CellStart.assign(m_nColumns * m_nRows + 1, 0);
+
+	for(size_t i = 0; i < m_Boxes.size(); i++)
+	{
+		int x0, y0, x1, y1;
+		CellRange(m_Boxes[i], x0, y0, x1, y1);
+		for(int y = y0; y <= y1; y++)
+			for(int x = x0; x <= x1; x++)
+				m_CellStart[y * m_nColumns + x + 1]++;
+	}
+
+	for(size_t c = 1; c < m_CellStart.size(); c++)
+		m_CellStart[c] += m_CellStart[c - 1];
+
+	std::vector<unsigned int> fill(m_CellStart.begin(), m_CellStart.end() - 1);
+	m_CellItems.resize(m_CellStart.back());
+
+	for(size_t i = 0; i < m_Boxes.size(); i++)
+	{
+		int x0, y0, x1, y1;
+		CellRange(m_Boxes[i], x0, y0, x1, y1);
+		for(int y = y0; y <= y1; y++)
+			for(int x = x0; x <= x1; x++)
+				m_CellItems[fill[y * m_nColumns + x]++] = (unsigned int)i;
+	}
+}
+
+void CBroadPhase::CellRange(const SAabb &box, int &x0, int &y0, int &x1, int &y1) const
+{
+	x0 = (int)floor((box.left - m_dOriginX) / m_dCell);
+	y0 = (int)floor((box.top - m_dOriginY) / m_dCell);
+	x1 = (int)floor((box.right - m_dOriginX) / m_dCell);
+	y1 = (int)floor((box.bottom - m_dOriginY) / m_dCell);
+
+	x0 = std::max(0, std::min(m_nColumns - 1, x0));
+	y0 = std::max(0, std::min(m_nRows - 1, y0));
+	x1 = std::max(0, std::min(m_nColumns - 1, x1));
+	y1 = std::max(0, std::min(m_nRows - 1, y1));
+}
+
+void CBroadPhase::Gather(const SAabb &query, bool bPoint, std::vector<unsigned int> &ids) const
+{
+	ids.clear();
+	if(m_CellStart.empty())
+		return;
+
+	// nothing outside the grid can hit
+	if(query.right < m_dOriginX || query.bottom < m_dOriginY ||
+		query.left > m_dOriginX + m_nColumns * m_dCell || query.top > m_dOriginY + m_nRows * m_dCell)
+		return;
+
+	if(++m_uQuery == 0)
+	{
+		// stamps wrapped around, start over
+		std::fill(m_Stamp.begin(), m_Stamp.end(), 0);
+		m_uQuery = 1;
+	}
+
+	int x0, y0, x1, y1;
+	CellRange(query, x0, y0, x1, y1);
+
+	for(int y = y0; y <= y1; y++)
+	{
+		for(int x = x0; x <= x1; x++)
+		{
+			int c = y * m_nColumns + x;
+			for(unsigned int k = m_CellStart[c]; k < m_CellStart[c + 1]; k++)
+			{
+				unsigned int i = m_CellItems[k];
+				if(m_Stamp[i] == m_uQuery)
+					continue;
+				m_Stamp[i] = m_uQuery;
+
+				const SAabb &box = m_Boxes[i];
+				bool bHit = bPoint ?
+					query.left >= box.left && query.left <= box.right &&
+					query.top >= box.top && query.top <= box.bottom :
+					query.right > box.left && query.left < box.right &&
+					query.bottom > box.top && query.top < box.bottom;
+
+				if(bHit)
+					ids.push_back(m_Ids[i]);
+			}
+		}
+	}
+
+	std::sort(ids.begin(), ids.end());
+}
+
+void CBroadPhase::QueryBox(const SAabb &box, std::vector<unsigned int> &ids) const
+{
+	Gather(box, false, ids);
+}
+
+void CBroadPhase::QueryPoint(double x, double y, std::vector<unsigned int> &ids) const
+{
+	SAabb point = { x, y, x, y };
+	Gather(point, true, ids);
+}
@@ -20,15 +20,23 @@ bool		p1Shoot = false;
 bool		p2Shoot = false;
 int			frameCounter = 0;
 bool		okLoad = 0;
-static UINT fTimer;
-int			incrementScore = 0;
-int			incrementScore2 = 0;
-int			powerUp = 0;
-int			powerUpShield = 0;
-int			powerUpGun = 0;
-int			powerUpDouble = 0;
 int			horn = 0;
 
+// The game logic (CSimulation) always advances in steps of SIM_STEP
+// seconds, however fast frames are drawn. After a stall at most this many
+// steps run in one frame, the rest of the lost time is dropped.
+#define MAX_STEPS_PER_FRAME	8
+
+// Sprites the pools start with in BuildObjects(). Every session grows the
+// car and explosion pools to the most traffic its levels can put on screen
+// (see sizePools()), and a frame that still runs short grows its pool
+// before the next one.
+#define POOL_CARS_PER_MODEL	48
+#define POOL_BULLETS		32
+#define POOL_EXPLOSIONS		16
+
+static const char* carImages[] = { "data/car2.bmp", "data/car6.bmp", "data/police.bmp" };
+
 //-----------------------------------------------------------------------------
 // CGameApp Member Functions
 //-----------------------------------------------------------------------------
@@ -43,6 +51,7 @@ CGameApp::CGameApp()
 	m_hIcon			= NULL;
 	m_hMenu			= NULL;
 	m_pBBuffer		= NULL;
+	m_pHudLayer		= NULL;
 	m_pPlayer		= NULL;
 	m_pPlayer2		= NULL;
 	m_scoreP1		= NULL;
@@ -54,18 +63,33 @@ CGameApp::CGameApp()
 	livesText2		= NULL;
 	scoreText2		= NULL;
 	gameMenu		= NULL;
-	m_level1Text	= NULL;
-	m_level2Text	= NULL;
-	m_level3Text	= NULL;
-	m_level4Text	= NULL;
-	m_level5Text	= NULL;
+	m_endlessLabel	= NULL;
+	for (int m = 0; m < ESC_COUNT; m++) m_carDemand[m] = 0;
+	m_bulletDemand	= 0;
+	m_explosionDemand = 0;
 	m_LastFrameRate = 0;
+	m_fAccumulator	= 0;
+	m_nBackgroundY	= 0;
+	m_nBackgroundTime = 0;
 	shootText		= NULL;
 	doubleText		= NULL;
 	shieldText		= NULL;
 	shootTextSel	= NULL;
 	doubleTextSel	= NULL;
 	shieldTextSel	= NULL;
+	doublerPower	= NULL;
+	addLivePower	= NULL;
+	gunPower		= NULL;
+	shieldPower		= NULL;
+
+	for (int i = 0; i < SIM_PLAYERS; i++)
+		m_buttons[i] = 0;
+
+	m_bReplay = false;
+	m_bEndless = false;
+	m_recorder.SetSource(this);
+	m_sim.SetInput(&m_recorder);
+	m_sim.SetAudio(this);
 }
 
 //-----------------------------------------------------------------------------
@@ -98,6 +122,12 @@ bool CGameApp::InitInstance( LPCTSTR lpCmdLine, int iCmdShow )
 	// Set up all required game states
 	SetupGameState();
 
+	// "-replay <file>" plays a recorded session instead of the menu
+	if (_tcsncmp(lpCmdLine, _T("-replay "), 8) == 0)
+		startReplay(lpCmdLine + 8);
+	else
+		startSession(NULL, false);
+
 	// Success!
 	return true;
 }
@@ -194,6 +224,9 @@ int CGameApp::BeginGame()
 //-----------------------------------------------------------------------------
 bool CGameApp::ShutDown()
 {
+	// Finish the input log of the game being played
+	endSession();
+
 	// Release any previously built objects
 	ReleaseObjects ( );
 	
@@ -272,12 +305,25 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
 				// Store new viewport sizes
 				m_nViewWidth  = LOWORD( lParam );
 				m_nViewHeight = HIWORD( lParam );
+
+				// Restored windows need the whole back buffer again
+				if ( m_pBBuffer ) m_pBBuffer->invalidateAll();
 		
 			
 			} // End if !Minimized
 
 			break;
 
+		case WM_PAINT:
+		{
+			// Only the uncovered part has to be presented again
+			PAINTSTRUCT ps;
+			BeginPaint( hWnd, &ps );
+			if ( m_pBBuffer ) m_pBBuffer->invalidate( ps.rcPaint );
+			EndPaint( hWnd, &ps );
+			break;
+		}
+
 		case WM_LBUTTONDOWN:
 			// Capture the mouse
 			SetCapture( m_hWnd );
@@ -307,22 +353,6 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
 			}
 			break;
 
-		case WM_TIMER:
-			switch (wParam)
-			{
-			case 1:
-				if (!m_pPlayer->AdvanceExplosion()) 
-					fTimer = SetTimer(m_hWnd, 1, 70, NULL);
-				if (!m_pPlayer2->AdvanceExplosion())
-					fTimer = SetTimer(m_hWnd, 1, 70, NULL);
-				for (auto enem : m_enemies)
-				{
-					if (!enem->AdvanceExplosion())
-						fTimer = SetTimer(m_hWnd, 1, 70, NULL);
-				}
-			}
-			break;
-
 		case WM_COMMAND:
 			break;
 
@@ -340,7 +370,12 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
 //-----------------------------------------------------------------------------
 bool CGameApp::BuildObjects()
 {
+	// Packed sprites are optional, Sprite falls back to the loose files
+	if(m_spriteAtlas.Load("data/sprites.atlas"))
+		Sprite::setAtlas(&m_spriteAtlas);
+
 	m_pBBuffer = new BackBuffer(m_hWnd, m_nViewWidth, m_nViewHeight);
+	m_pHudLayer = new RenderLayer(m_hWnd, m_nViewWidth, m_nViewHeight);
 	m_pPlayer = new CPlayer(m_pBBuffer, "data/car4.bmp");
 	m_pPlayer2 = new CPlayer(m_pBBuffer, "data/car5.bmp");
 	m_scoreP1 = new ScoreSprite(Vec2(95, 100), m_pBBuffer);
@@ -356,49 +391,55 @@ bool CGameApp::BuildObjects()
 
 	m_wonSprite->setBackBuffer(m_pBBuffer);
 	m_lostSprite->setBackBuffer(m_pBBuffer);
-	addEnemies(20, 2, 70);
-	m_level1Text = new Sprite("data/level1_text.bmp", RGB(0xff, 0x00, 0xff));
-	m_level2Text = new Sprite("data/level2_text.bmp", RGB(0xff, 0x00, 0xff));
-	m_level3Text = new Sprite("data/level3_text.bmp", RGB(0xff, 0x00, 0xff));
-	m_level4Text = new Sprite("data/level4_text.bmp", RGB(0xff, 0x00, 0xff));
-	m_level5Text = new Sprite("data/level5_text.bmp", RGB(0xff, 0x00, 0xff));
-
-	m_level1Text->setBackBuffer(m_pBBuffer);
-	m_level2Text->setBackBuffer(m_pBBuffer);
-	m_level3Text->setBackBuffer(m_pBBuffer);
-	m_level4Text->setBackBuffer(m_pBBuffer);
-	m_level5Text->setBackBuffer(m_pBBuffer);
+	growPools(POOL_CARS_PER_MODEL, POOL_BULLETS, POOL_EXPLOSIONS);
+	if (!loadLevels())
+		return false;
 
 	shootText = new Sprite("data/shoot_text.bmp", RGB(0xff, 0x00, 0xff));
-	shootText->setBackBuffer(m_pBBuffer);
+	shootText->setBackBuffer(m_pHudLayer->getSurface());
 
 	shieldText = new Sprite("data/shield_text.bmp", RGB(0xff, 0x00, 0xff));
-	shieldText->setBackBuffer(m_pBBuffer);
+	shieldText->setBackBuffer(m_pHudLayer->getSurface());
 
 	doubleText = new Sprite("data/doublepoints_text.bmp", RGB(0xff, 0x00, 0xff));
-	doubleText->setBackBuffer(m_pBBuffer);
+	doubleText->setBackBuffer(m_pHudLayer->getSurface());
 
 	shootTextSel = new Sprite("data/shootsel_text.bmp", RGB(0xff, 0x00, 0xff));
-	shootTextSel->setBackBuffer(m_pBBuffer);
+	shootTextSel->setBackBuffer(m_pHudLayer->getSurface());
 
 	shieldTextSel = new Sprite("data/shieldsel_text.bmp", RGB(0xff, 0x00, 0xff));
-	shieldTextSel->setBackBuffer(m_pBBuffer);
+	shieldTextSel->setBackBuffer(m_pHudLayer->getSurface());
 
 	doubleTextSel = new Sprite("data/doublepointssel_text.bmp", RGB(0xff, 0x00, 0xff));
-	doubleTextSel->setBackBuffer(m_pBBuffer);
+	doubleTextSel->setBackBuffer(m_pHudLayer->getSurface());
 	
-	livesText->setBackBuffer(m_pBBuffer);
-	scoreText->setBackBuffer(m_pBBuffer);
+	livesText->setBackBuffer(m_pHudLayer->getSurface());
+	scoreText->setBackBuffer(m_pHudLayer->getSurface());
 
-	livesText2->setBackBuffer(m_pBBuffer);
-	scoreText2->setBackBuffer(m_pBBuffer);
+	livesText2->setBackBuffer(m_pHudLayer->getSurface());
+	scoreText2->setBackBuffer(m_pHudLayer->getSurface());
+
+	doublerPower = new Sprite("data/doubler.bmp", RGB(0xff, 0x00, 0xff));
+	doublerPower->setBackBuffer(m_pBBuffer);
+	addLivePower = new Sprite("data/heart.bmp", RGB(0xff, 0x00, 0xff));
+	addLivePower->setBackBuffer(m_pBBuffer);
+	gunPower = new Sprite("data/gun.bmp", RGB(0xff, 0x00, 0xff));
+	gunPower->setBackBuffer(m_pBBuffer);
+	shieldPower = new Sprite("data/shield.bmp", RGB(0xff, 0x00, 0xff));
+	shieldPower->setBackBuffer(m_pBBuffer);
 
-	addPowerUp(powerUp);
 	setPLives(3, 3);
 
+	// The backgrounds are decoded when first painted (native 32 bit files
+	// are used straight from the mapping)
+	m_imgBackground.SetLoadMode(ELM_MAPPED);
 	if(!m_imgBackground.LoadBitmapFromFile("data/Background.bmp", GetDC(m_hWnd)))
 		return false;
 
+	m_nBackgroundY = m_imgBackground.Height();
+	m_nBackgroundTime = ::GetTickCount();
+
+	m_imgBackgroundMenu.SetLoadMode(ELM_MAPPED);
 	if (!m_imgBackgroundMenu.LoadBitmapFromFile("data/backgroundMenu.bmp", GetDC(m_hWnd)))
 		return false;
 
@@ -412,23 +453,11 @@ bool CGameApp::BuildObjects()
 //-----------------------------------------------------------------------------
 void CGameApp::SetupGameState()
 {
-	m_pPlayer->Position() = Vec2(690, 600);
-	m_pPlayer2->Position() = Vec2(890, 600);
-
-	m_pPlayer->frameCounter() = 250;
-	m_pPlayer2->frameCounter() = 250;
-
 	livesText->mPosition = Vec2(80, 30);
 	scoreText->mPosition = Vec2(80, 125);
 	livesText2->mPosition = Vec2(80, 525);
 	scoreText2->mPosition = Vec2(80, 620);
 
-	m_level1Text->mPosition = Vec2(80, 230);
-	m_level2Text->mPosition = Vec2(80, 230);
-	m_level3Text->mPosition = Vec2(80, 230);
-	m_level4Text->mPosition = Vec2(80, 230);
-	m_level5Text->mPosition = Vec2(80, 230);
-
 	shootText->mPosition = Vec2(75, 370);
 	shieldText->mPosition = Vec2(75, 300);
 	doubleText->mPosition = Vec2(80, 440);
@@ -441,8 +470,6 @@ void CGameApp::SetupGameState()
 	m_lostSprite->mPosition = Vec2(int(m_screenSize.x / 2), int(m_screenSize.y / 2));
 
 	m_gameState = GameState::START;
-	m_levels = Levels::LEVEL1;
-	levelForSave = "level1";
 }
 
 //-----------------------------------------------------------------------------
@@ -504,34 +531,14 @@ void CGameApp::ReleaseObjects( )
 		scoreText2 = NULL;
 	}
 
-	if (m_level1Text != NULL)
-	{
-		delete m_level1Text;
-		m_level1Text = NULL;
-	}
-
-	if (m_level2Text != NULL)
-	{
-		delete m_level2Text;
-		m_level2Text = NULL;
-	}
-
-	if (m_level3Text != NULL)
-	{
-		delete m_level3Text;
-		m_level3Text = NULL;
-	}
+	for (auto label : m_levelLabels)
+		delete label;
+	m_levelLabels.clear();
 
-	if (m_level4Text != NULL)
+	if (m_endlessLabel != NULL)
 	{
-		delete m_level4Text;
-		m_level4Text = NULL;
-	}
-
-	if (m_level5Text != NULL)
-	{
-		delete m_level5Text;
-		m_level5Text = NULL;
+		delete m_endlessLabel;
+		m_endlessLabel = NULL;
 	}
 
 	if (gameMenu != NULL) {
@@ -599,16 +606,28 @@ void CGameApp::ReleaseObjects( )
 		doubleTextSel = NULL;
 	}
 
-	while (!m_enemies.empty()) delete m_enemies.front(), m_enemies.pop_front();
-	while (!bullets.empty()) delete bullets.front(), bullets.pop_front();
+	for (int m = 0; m < ESC_COUNT; m++) m_carPools[m].Clear();
+	m_bulletPool.Clear();
+	m_explosionPool.Clear();
 	while (!m_livesGreen.empty()) delete m_livesGreen.front(), m_livesGreen.pop_front();
 	while (!m_livesRed.empty()) delete m_livesRed.front(), m_livesRed.pop_front();
 
+	if (m_pHudLayer != NULL)
+	{
+		delete m_pHudLayer;
+		m_pHudLayer = NULL;
+	}
+
 	if (m_pBBuffer != NULL)
 	{
 		delete m_pBBuffer;
 		m_pBBuffer = NULL;
 	}
+
+	// No sprite references the atlas pages or cached bitmaps any more
+	Sprite::setAtlas(NULL);
+	m_spriteAtlas.Release();
+	CAssetCache::instance().clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -635,17 +654,39 @@ void CGameApp::FrameAdvance()
 
 	} // End if Frame Rate Altered
 
+	// Run as many fixed steps as the elapsed time holds
+	m_fAccumulator += m_Timer.GetTimeElapsed();
+	if (m_fAccumulator > SIM_STEP * MAX_STEPS_PER_FRAME)
+		m_fAccumulator = SIM_STEP * MAX_STEPS_PER_FRAME;
+
+	while (m_fAccumulator >= SIM_STEP)
+	{
+		StepSimulation();
+		m_fAccumulator -= SIM_STEP;
+	}
+
+	// Drawing the game objects, between their last two states
+	DrawObjects(m_fAccumulator / SIM_STEP);
+
+	// Objects left out for want of a sprite are shown from the next frame
+	size_t cars = 0;
+	for (int m = 0; m < ESC_COUNT; m++) if (m_carDemand[m] > cars) cars = m_carDemand[m];
+	growPools(cars, m_bulletDemand, m_explosionDemand);
+}
+
+//-----------------------------------------------------------------------------
+// Name : StepSimulation () (Private)
+// Desc : Advances the game by one fixed step.
+//-----------------------------------------------------------------------------
+void CGameApp::StepSimulation()
+{
+	gameMenu->frameCounter++;
+
 	// Poll & Process input devices
 	ProcessInput();
 
 	// Animate the game objects
 	AnimateObjects();
-
-	// Remove dead enemies
-	removeDead();
-
-	// Drawing the game objects
-	DrawObjects();
 }
 
 //-----------------------------------------------------------------------------
@@ -655,8 +696,6 @@ void CGameApp::FrameAdvance()
 void CGameApp::ProcessInput( )
 {
 	static UCHAR pKeyBuffer[ 256 ];
-	ULONG		Direction = 0;
-	ULONG		Direction1 = 0;
 	POINT		CursorPos;
 	float		X = 0.0f, Y = 0.0f;
 
@@ -678,7 +717,19 @@ void CGameApp::ProcessInput( )
 		if (pKeyBuffer[VK_RETURN] & 0xF0) {
 			mciSendString("play data/sounds/menu_sel.wav", NULL, 0, NULL);
 			if (gameMenu->getChoice() == 0)
+			{
+				// The last game is over, start a new one
+				if (m_sim.GetState() != ESIM_RUNNING)
+					startSession(NULL, false);
 				m_gameState = GameState::ONGOING;
+			}
+
+			if (gameMenu->getChoice() == 4)
+			{
+				startSession(NULL, true);
+				gameMenu->reset();
+				m_gameState = GameState::ONGOING;
+			}
 
 			if (gameMenu->getChoice() == 1)
 				loadGame();
@@ -697,40 +748,20 @@ void CGameApp::ProcessInput( )
 		}
 	}
 
-	// Check the relevant keys
-	if (!m_pPlayer->isDead)
-	{
-		if (pKeyBuffer[VK_UP] & 0xF0) Direction |= CPlayer::DIR_FORWARD;
-		if (pKeyBuffer[VK_DOWN] & 0xF0) Direction |= CPlayer::DIR_BACKWARD;
-		if (pKeyBuffer[VK_LEFT] & 0xF0) Direction |= CPlayer::DIR_LEFT;
-		if (pKeyBuffer[VK_RIGHT] & 0xF0) Direction |= CPlayer::DIR_RIGHT;
-
-		if (pKeyBuffer[VK_SPACE] & 0xF0 && m_pPlayer->frameCounter() >= 20 && m_pPlayer->gunPowerUp == 1)
-		{
-			fireBullet(m_pPlayer->Position(), Vec2(0, -250));
-			mciSendString("play data/sounds/shoot.wav", NULL, 0, NULL);
-			m_pPlayer->frameCounter() = 0;
-		}
-	}
-
-	if (!m_pPlayer2->isDead)
-	{
-		if (pKeyBuffer['W'] & 0xF0) Direction1 |= CPlayer::DIR_FORWARD;
-		if (pKeyBuffer['S'] & 0xF0) Direction1 |= CPlayer::DIR_BACKWARD;
-		if (pKeyBuffer['A'] & 0xF0) Direction1 |= CPlayer::DIR_LEFT;
-		if (pKeyBuffer['D'] & 0xF0) Direction1 |= CPlayer::DIR_RIGHT;
-
-		if (pKeyBuffer['P'] & 0xF0 && m_pPlayer2->frameCounter() >= 20 && m_pPlayer2->gunPowerUp == 1)
-		{
-			fireBullet(m_pPlayer2->Position(), Vec2(0, -250));
-			mciSendString("play data/sounds/shoot.wav", NULL, 0, NULL);
-			m_pPlayer2->frameCounter() = 0;
-		}
-	}
-	
-	// Move the player
-	m_pPlayer->Move(Direction);
-	m_pPlayer2->Move(Direction1);
+	// Check the relevant keys, the simulation reads them in its next step
+	m_buttons[0] = 0;
+	if (pKeyBuffer[VK_UP] & 0xF0) m_buttons[0] |= SIM_BUTTON_UP;
+	if (pKeyBuffer[VK_DOWN] & 0xF0) m_buttons[0] |= SIM_BUTTON_DOWN;
+	if (pKeyBuffer[VK_LEFT] & 0xF0) m_buttons[0] |= SIM_BUTTON_LEFT;
+	if (pKeyBuffer[VK_RIGHT] & 0xF0) m_buttons[0] |= SIM_BUTTON_RIGHT;
+	if (pKeyBuffer[VK_SPACE] & 0xF0) m_buttons[0] |= SIM_BUTTON_FIRE;
+
+	m_buttons[1] = 0;
+	if (pKeyBuffer['W'] & 0xF0) m_buttons[1] |= SIM_BUTTON_UP;
+	if (pKeyBuffer['S'] & 0xF0) m_buttons[1] |= SIM_BUTTON_DOWN;
+	if (pKeyBuffer['A'] & 0xF0) m_buttons[1] |= SIM_BUTTON_LEFT;
+	if (pKeyBuffer['D'] & 0xF0) m_buttons[1] |= SIM_BUTTON_RIGHT;
+	if (pKeyBuffer['P'] & 0xF0) m_buttons[1] |= SIM_BUTTON_FIRE;
 
 	// Now process the mouse (if the button is pressed)
 	if ( GetCapture() == m_hWnd )
@@ -753,9 +784,6 @@ void CGameApp::ProcessInput( )
 //-----------------------------------------------------------------------------
 void CGameApp::AnimateObjects()
 {
-	updateGameState();
-	//updateLevelState();
-
 	switch (m_gameState)
 	{
 	case GameState::START:
@@ -763,243 +791,21 @@ void CGameApp::AnimateObjects()
 		break;
 	case GameState::ONGOING:
 		mciSendString("stop data/sounds/song.wav", NULL, 0, NULL);
-		if (!m_pPlayer->isDead)
-		{
-			if (!m_pPlayer->hasExploded())
-			{
-				if (m_pPlayer->doublerPowerUp)
-				{
-					powerUpDouble++;
-					incrementScore ++;
-					if (incrementScore % 2 == 0)
-						m_scoreP1->updateScore(1);
-
-					if(powerUpDouble == 300)
-						mciSendString("play data/sounds/timer.wav", NULL, 0, NULL);
-					if (powerUpDouble == 500)
-					{
-						m_pPlayer->doublerPowerUp = 0;
-						powerUpDouble = 0;
-					}
-						
-				}
-				else
-				{
-					incrementScore++;
-					if (incrementScore % 4 == 0)
-						m_scoreP1->updateScore(1);
-				}
-
-				if (m_pPlayer->invincibility == 1)
-				{
-					powerUp++;
-					if (powerUp == 400)
-					{
-						powerUp = 0;
-						m_pPlayer->invincibility = 0;
-					}
-				}
-
-				if (m_pPlayer->gunPowerUp == 1)
-				{
-					powerUpGun++;
-					if (powerUpGun == 300)
-					{
-						mciSendString("play data/sounds/timer.wav", NULL, 0, NULL);
-					}
-					if (powerUpGun == 500)
-					{
-						powerUpGun = 0;
-						m_pPlayer->gunPowerUp = 0;
-					}
-				}
-
-				if (m_pPlayer->shield == 1)
-				{
-					powerUpShield++;
-					if (powerUpShield == 300)
-					{
-						mciSendString("play data/sounds/timer.wav", NULL, 0, NULL);
-					}
-					if (powerUpShield == 500)
-					{
-						powerUpShield = 0;
-						m_pPlayer->shield = 0;
-						m_pPlayer->invincibility = 0;
-					}
-				}
-			}
-			
-			m_pPlayer->Update(m_Timer.GetTimeElapsed());
-			m_pPlayer->frameCounter()++;
-		}
-
-		if (!m_pPlayer2->isDead)
-		{
-			if (!m_pPlayer2->hasExploded())
-			{
-				if (m_pPlayer2->doublerPowerUp)
-				{
-					powerUpDouble++;
-					incrementScore2++;
-					if (incrementScore2 % 2 == 0)
-						m_scoreP2->updateScore(1);
-
-					if (powerUpDouble == 300)
-						mciSendString("play data/sounds/timer.wav", NULL, 0, NULL);
-					if (powerUpDouble == 500)
-					{
-						m_pPlayer2->doublerPowerUp = 0;
-						powerUpDouble = 0;
-					}
-
-				}
-				else
-				{
-					incrementScore2++;
-					if (incrementScore2 % 4 == 0)
-						m_scoreP2->updateScore(1);
-				}
-
-				if (m_pPlayer2->invincibility == 1)
-				{
-					powerUp++;
-					if (powerUp == 400)
-					{
-						powerUp = 0;
-						m_pPlayer2->invincibility = 0;
-					}
-				}
-
-				if (m_pPlayer2->gunPowerUp == 1)
-				{
-					powerUpGun++;
-					if (powerUpGun == 300)
-					{
-						mciSendString("play data/sounds/timer.wav", NULL, 0, NULL);
-					}
-					if (powerUpGun == 500)
-					{
-						powerUpGun = 0;
-						m_pPlayer2->gunPowerUp = 0;
-					}
-				}
-
-				if (m_pPlayer2->shield == 1)
-				{
-					powerUpShield++;
-					if (powerUpShield == 300)
-					{
-						mciSendString("play data/sounds/timer.wav", NULL, 0, NULL);
-					}
-					if (powerUpShield == 500)
-					{
-						powerUpShield = 0;
-						m_pPlayer2->shield = 0;
-						m_pPlayer2->invincibility = 0;
-					}
-				}
-			}
-
-			m_pPlayer2->Update(m_Timer.GetTimeElapsed());
-			m_pPlayer2->frameCounter()++;
-		}
-
-		for (auto enem : m_enemies)
-		{
-			enem->Update(m_Timer.GetTimeElapsed());
-
-			if (enem->Position().y + (enem->getSize().y / 2) >= GetSystemMetrics(SM_CYSCREEN) + 125)
-			{
-				enem->isDead = 1;
-			}
-		}
-
-		if (CollisionPlayer1())
-		{
-			m_scoreP1->updateScore(-100);
-			m_pPlayer->invincibility = 1;
-		}
-
-		if (CollisionPlayer2())
-		{
-			m_scoreP2->updateScore(-100);
-			m_pPlayer2->invincibility = 1;
-		}
-
-		addLivePower->update(m_Timer.GetTimeElapsed());
-		shieldPower->update(m_Timer.GetTimeElapsed());
-		gunPower->update(m_Timer.GetTimeElapsed());
-		doublerPower->update(m_Timer.GetTimeElapsed());
-
-		if (powerUpCollision(addLivePower, m_pPlayer))
-		{
-			
-			if (m_pPlayer->getLives() < 3)
-			{
-				setPLives(m_pPlayer->getLives() + 1, m_pPlayer2->getLives());
-			}
-		}
-
-		if (powerUpCollision(doublerPower, m_pPlayer))
-		{
-			m_pPlayer->doublerPowerUp = 1;
-		}
-
-		if (powerUpCollision(shieldPower, m_pPlayer))
-		{
-			m_pPlayer->shield = 1;
-			m_pPlayer->invincibility = 1;
-		}
-
-		if (powerUpCollision(gunPower, m_pPlayer))
-		{
-			m_pPlayer->gunPowerUp = 1;
-		}
-
-		if (powerUpCollision(addLivePower, m_pPlayer2))
-		{
-
-			if (m_pPlayer2->getLives() < 3)
-			{
-				setPLives(m_pPlayer->getLives(), m_pPlayer2->getLives() + 1);
-			}
-		}
-
-		if (powerUpCollision(doublerPower, m_pPlayer2))
-		{
-			m_pPlayer2->doublerPowerUp = 1;
-		}
 
-		if (powerUpCollision(shieldPower, m_pPlayer2))
+		// A replay that ran out hands the game to the players
+		if (m_bReplay && m_replay.AtEnd())
 		{
-			m_pPlayer2->shield = 1;
-			m_pPlayer2->invincibility = 1;
-		}
-
-		if (powerUpCollision(gunPower, m_pPlayer2))
-		{
-			m_pPlayer2->gunPowerUp = 1;
+			m_replay.Close();
+			m_bReplay = false;
+			m_sim.SetInput(&m_recorder);
+			m_gameState = GameState::PAUSE;
+			break;
 		}
 
-		for (auto bul : bullets)
-		{
-			bul->update(m_Timer.GetTimeElapsed());
-
-			if (detectBulletCollision(bul) || bul->mPosition.y >= m_screenSize.y || bul->mPosition.y <= 0)
-			{
-				bullets.remove(bul);
-				break;
-			}
-		}
+		m_sim.Step();
+		updateGameState();
 
 		mciSendString("play data/sounds/car4_relanti.wav", NULL, 0, NULL);
-
-		for (auto enem : m_enemies)
-		{
-			CollisionEnemy(enem);
-		}
-
 		break;
 	
 	case GameState::PAUSE:
@@ -1008,13 +814,8 @@ void CGameApp::AnimateObjects()
 		break;
 
 	case GameState::WON:
-		switch (m_levels)
-		{
-		case Levels::LEVEL5:
-			m_scoreP1->move(Vec2(m_screenSize.x / 2 - 150, m_screenSize.y / 2 + 200));
-			m_scoreP2->move(Vec2(m_screenSize.x / 2 + 150, m_screenSize.y / 2 + 200));
-			break;
-		}
+		m_scoreP1->move(Vec2(m_screenSize.x / 2 - 150, m_screenSize.y / 2 + 200));
+		m_scoreP2->move(Vec2(m_screenSize.x / 2 + 150, m_screenSize.y / 2 + 200));
 		break;
 	
 	case GameState::LOST:
@@ -1028,420 +829,458 @@ void CGameApp::AnimateObjects()
 // Name : DrawObjects () (Private)
 // Desc : Draws the game objects
 //-----------------------------------------------------------------------------
-void CGameApp::DrawObjects()
+void CGameApp::DrawObjects(double alpha)
 {
 	int speedBackground = 25;
-	m_pBBuffer->reset();
-	m_imgBackgroundMenu.Paint(m_pBBuffer->getDC(), 0, 0);
-	gameMenu->draw(m_gameState);
+	bool showScores = false;
+	vector<Sprite*> menuSprites;
+
+	// Collect what this frame shows. The back buffer compares it with the
+	// previous frame, only the rectangles that changed get repainted.
+	m_drawList.clear();
+	queueImage(&m_imgBackgroundMenu, 0);
+	gameMenu->getSprites(m_gameState, menuSprites);
+	for (auto spr : menuSprites) queueSprite(spr);
 	switch (m_gameState)
 	{
 	case GameState::START:
-		m_pPlayer->Velocity() = Vec2(0, 0);
-		m_pPlayer2->Velocity() = Vec2(0, 0);
 		break;
 	case GameState::ONGOING:
 		scrollingBackground(speedBackground);
-		livesText->draw();
-		scoreText->draw();
-		livesText2->draw();
-		scoreText2->draw();
-		m_scoreP1->draw();
-		m_scoreP2->draw();
-		if (!m_pPlayer->isDead) m_pPlayer->Draw();
-		if (!m_pPlayer2->isDead) m_pPlayer2->Draw();
-
-		for (auto lg : m_livesGreen) lg->draw();
-		for (auto lr : m_livesRed) lr->draw();
-
-		for (auto bul : bullets)
-		{
-			bul->draw();
-		}
-
-		for (auto enem : m_enemies)
-		{
-			enem->Draw();
-		}
-
-		if(!addLivePower->deleted) addLivePower->draw();
-		if(!shieldPower->deleted) shieldPower->draw();
-		if(!gunPower->deleted) gunPower->draw();
-		if(!doublerPower->deleted) doublerPower->draw();
-
-		if (!m_pPlayer->gunPowerUp && !m_pPlayer2->gunPowerUp) shootText->draw();
-		else shootTextSel->draw();
+		m_pHudLayer->queue(livesText);
+		m_pHudLayer->queue(scoreText);
+		m_pHudLayer->queue(livesText2);
+		m_pHudLayer->queue(scoreText2);
+		showScores = true;
+
+		queueLives(m_livesGreen, m_sim.GetPlayer(0).nLives);
+		queueLives(m_livesRed, m_sim.GetPlayer(1).nLives);
+
+		// Every sprite is free again, DrawObject() hands them out
+		for (int m = 0; m < ESC_COUNT; m++) m_carPools[m].ReleaseAll();
+		m_bulletPool.ReleaseAll();
+		m_explosionPool.ReleaseAll();
+		for (int m = 0; m < ESC_COUNT; m++) m_carDemand[m] = 0;
+		m_bulletDemand = 0;
+		m_explosionDemand = 0;
+		m_sim.Render(*this, alpha);
+
+		if (!m_sim.GetPlayer(0).bGun && !m_sim.GetPlayer(1).bGun) m_pHudLayer->queue(shootText);
+		else m_pHudLayer->queue(shootTextSel);
 		
-		if (!m_pPlayer->shield && !m_pPlayer2->shield) shieldText->draw();
-		else shieldTextSel->draw();
+		if (!m_sim.GetPlayer(0).bShield && !m_sim.GetPlayer(1).bShield) m_pHudLayer->queue(shieldText);
+		else m_pHudLayer->queue(shieldTextSel);
 		
-		if (!m_pPlayer->doublerPowerUp && !m_pPlayer2->doublerPowerUp) doubleText->draw();
-		else doubleTextSel->draw();
+		if (!m_sim.GetPlayer(0).bDoubler && !m_sim.GetPlayer(1).bDoubler) m_pHudLayer->queue(doubleText);
+		else m_pHudLayer->queue(doubleTextSel);
 
-		switch (m_levels)
-		{
-		case Levels::LEVEL1:
-			m_level1Text->draw();
-			break;
-			
-		case Levels::LEVEL2:
-			m_level2Text->draw();
-			break;
-
-		case Levels::LEVEL3:
-			m_level3Text->draw();
-			break;
-
-		case Levels::LEVEL4:
-			m_level4Text->draw();
-			break;
-
-		case Levels::LEVEL5:
-			m_level5Text->draw();
-			break;
-		}
+		queueLevelLabel();
 		
 		break;
 	case GameState::LOST:
 		scrollingBackground(speedBackground);
-		m_scoreP1->draw();
-		m_scoreP2->draw();
-		m_lostSprite->draw();
+		showScores = true;
+		queueSprite(m_lostSprite);
 		mciSendString("play data/sounds/lose.wav", NULL, 0, NULL);
 		break;
 	case GameState::WON:
 		scrollingBackground(speedBackground);
-		switch (m_levels) 
-		{
-		case Levels::LEVEL5:
-			m_scoreP1->draw();
-			m_scoreP2->draw();
-			m_wonSprite->draw();
-			mciSendString("play data/sounds/win.wav", NULL, 0, NULL);
-			break;
-		}
+		showScores = true;
+		queueSprite(m_wonSprite);
+		mciSendString("play data/sounds/win.wav", NULL, 0, NULL);
 		break;
 	case GameState::PAUSE:
-		m_pPlayer->Velocity() = Vec2(0, 0);
-		m_pPlayer2->Velocity() = Vec2(0, 0);
-		livesText->draw();
-		scoreText->draw();
-		livesText2->draw();
-		scoreText2->draw();
-		m_scoreP1->draw();
-		m_scoreP2->draw();
-		for (auto lg : m_livesGreen) lg->draw();
-		for (auto lr : m_livesRed) lr->draw();
-		switch (m_levels)
-		{
-		case Levels::LEVEL1:
-			m_level1Text->draw();
-			break;
-
-		case Levels::LEVEL2:
-			m_level2Text->draw();
-			break;
-
-		case Levels::LEVEL3:
-			m_level3Text->draw();
-			break;
-
-		case Levels::LEVEL4:
-			m_level4Text->draw();
-			break;
-
-		case Levels::LEVEL5:
-			m_level5Text->draw();
-			break;
-		}
+		m_pHudLayer->queue(livesText);
+		m_pHudLayer->queue(scoreText);
+		m_pHudLayer->queue(livesText2);
+		m_pHudLayer->queue(scoreText2);
+		showScores = true;
+		queueLives(m_livesGreen, m_sim.GetPlayer(0).nLives);
+		queueLives(m_livesRed, m_sim.GetPlayer(1).nLives);
+		queueLevelLabel();
 		break;
 	default:
 		break;
 	}
 	
-	m_pBBuffer->present();
-}
+	// The scores change every few steps, they are drawn straight into the
+	// back buffer (on top of the game) instead of re-rendering the HUD layer
+	if (showScores)
+	{
+		queueScore(m_scoreP1);
+		queueScore(m_scoreP2);
+	}
 
-void CGameApp::addEnemies(int nrEnemies, int timeVelocity, int velocity)
-{	
-	int velocityY, positionX, positionY, auxPositionY[1002] = {}, ok = 0, speedBackground = 10, i, j, okPos = 0, timeVelocityLocal;
-	srand(time(NULL));
+	// The HUD goes on top of everything else, re-rendered only when one
+	// of its sprites changed
+	queueLayer(m_pHudLayer);
 
-	velocityY = velocity;
-	positionY = -100;
-	auxPositionY[0] = positionY;
-	for (i = 0; i < nrEnemies; i++)
+	m_pBBuffer->endTracking();
+
+	// Nothing moved, the window already shows this frame
+	if (!m_pBBuffer->isDirty())
+		return;
+
+	m_pBBuffer->reset();
+	for (auto &item : m_drawList)
 	{
-		if (i % 3 == 0 && i > 2)
-		{
-			m_enemies.push_back(new CPlayer(m_pBBuffer, "data/car6.bmp"));
-		}
-		else if (i % 5 == 0 && i > 2)
-		{
-			m_enemies.push_back(new CPlayer(m_pBBuffer, "data/police.bmp"));
-		}
-		else
-		{
-			m_enemies.push_back(new CPlayer(m_pBBuffer, "data/car2.bmp"));
-		}
-		
-		positionX = 10;
-		ok = 0;
-		while (ok == 0)
-		{
-			positionX = rand() % GetSystemMetrics(SM_CXSCREEN);
-			
-			//banda 1
-			if (positionX == 290 && ok == 0)
-				ok = 1;
-			
-			//banda 2
-			if (positionX == 490 && ok == 0)
-				ok = 1;
+		if (!m_pBBuffer->isVisible(item.rcBounds))
+			continue;
+
+		if (item.pImage) item.pImage->Paint(m_pBBuffer->getDC(), 0, item.nImageY);
+		else if (item.pLayer) item.pLayer->composite(*m_pBBuffer);
+		else item.pSprite->draw();
+	}
 
-			//banda 3
-			if (positionX == 690 && ok == 0)
-				ok = 1;
+	m_pBBuffer->present();
+}
 
-			//banda 4
-			if (positionX == 890 && ok == 0)
-				ok = 1;
+//-----------------------------------------------------------------------------
+// Name : queueSprite () (Private)
+// Desc : Adds a sprite to the frame's draw list and reports its bounds.
+//-----------------------------------------------------------------------------
+void CGameApp::queueSprite(Sprite* pSprite)
+{
+	DrawItem item;
+	HBITMAP hImage;
+	POINT ptSource;
+
+	pSprite->getDrawState(item.rcBounds, hImage, ptSource);
+	item.pSprite = pSprite;
+	item.pImage = NULL;
+	item.pLayer = NULL;
+	item.nImageY = 0;
+
+	m_pBBuffer->track(pSprite, item.rcBounds, hImage, ptSource);
+	m_drawList.push_back(item);
+}
 
+//-----------------------------------------------------------------------------
+// Name : queueScore () (Private)
+// Desc : Adds the digits of a score counter to the frame's draw list.
+//-----------------------------------------------------------------------------
+void CGameApp::queueScore(ScoreSprite* pScore)
+{
+	vector<Sprite*> digits;
 
-			//banda 5
-			if (positionX == 1110 && ok == 0)
-				ok = 1;
+	pScore->getSprites(digits);
+	for (auto dig : digits) queueSprite(dig);
+}
 
-			//banda 6
-			if (positionX == (GetSystemMetrics(SM_CXSCREEN) - 230) && ok == 0)
-				ok = 1;
-		}
+//-----------------------------------------------------------------------------
+// Name : queueImage () (Private)
+// Desc : Adds a background image scrolled to y to the frame's draw list.
+//-----------------------------------------------------------------------------
+void CGameApp::queueImage(CImageFile* pImage, int y)
+{
+	DrawItem item;
+	POINT ptSource = { 0, y };
 
-		m_enemies.back()->Position() = Vec2(positionX, positionY);
-		m_enemies.back()->Velocity() = Vec2(0, velocityY);
+	SetRect(&item.rcBounds, 0, 0, pImage->Width(), pImage->Height());
+	item.pSprite = NULL;
+	item.pImage = pImage;
+	item.pLayer = NULL;
+	item.nImageY = y;
 
-		auxPositionY[i + 1] = rand() % (nrEnemies * 200) + 100;
-		positionY = auxPositionY[i + 1] - (2 * auxPositionY[i + 1]);
-		auxPositionY[i + 1] = positionY;
-		for (j = 0; j < i + 1; j++)
-		{
-			okPos = 0;
-			while (okPos == 0)
-			{
-				if (auxPositionY[j] > auxPositionY[i + 1])
-				{
-					if (auxPositionY[j] - auxPositionY[i + 1] > 240)
-					{
-						okPos = 1;
-					}	
-				}
-				
-				if (auxPositionY[j] < auxPositionY[i + 1])
-				{
-					if (auxPositionY[j] - auxPositionY[i + 1] < -240)
-					{
-						okPos = 1;
-					}
-				}
-
-				if (okPos == 0)
-				{
-					auxPositionY[i + 1] = rand() % (nrEnemies * 200) + 100;
-					positionY = auxPositionY[i + 1] - (2 * auxPositionY[i + 1]);
-					auxPositionY[i + 1] = positionY;
-				}
-			}
-		}
+	m_pBBuffer->track(pImage, item.rcBounds, pImage, ptSource);
+	m_drawList.push_back(item);
+}
 
-		if (i > 2)
-		{
-			int iMod = i / 2;
-			if (iMod % nrEnemies == 0)
-			{
-				if (timeVelocityLocal <= timeVelocity)
-				{
-					timeVelocityLocal++;
-					velocityY += 5;
-				}
-			}
-		}
-	}
-	
+//-----------------------------------------------------------------------------
+// Name : queueLayer () (Private)
+// Desc : Brings a layer up to date and adds it to the frame's draw list.
+//-----------------------------------------------------------------------------
+void CGameApp::queueLayer(RenderLayer* pLayer)
+{
+	DrawItem item;
+	POINT ptSource;
+
+	pLayer->update();
+
+	item.rcBounds = pLayer->getBounds();
+	item.pSprite = NULL;
+	item.pImage = NULL;
+	item.pLayer = pLayer;
+	item.nImageY = 0;
+
+	// A new version of the layer repaints its old and new area
+	ptSource.x = (LONG)pLayer->getVersion();
+	ptSource.y = 0;
+	m_pBBuffer->track(pLayer, item.rcBounds, pLayer, ptSource);
+	m_drawList.push_back(item);
 }
 
-void CGameApp::removeDead()
+//-----------------------------------------------------------------------------
+// Name : configureSimulation () (Private)
+// Desc : Gives the simulation the screen size and the sizes of the bitmaps
+//		its objects are drawn with.
+//-----------------------------------------------------------------------------
+void CGameApp::configureSimulation()
 {
+	SSimConfig config;
+	CSimulation::DefaultConfig(config);
 
-	if (!m_pPlayer->getLives() && !m_pPlayer->hasExploded())
-	{
-		fTimer = SetTimer(m_hWnd, 1, 70, NULL);
-		m_pPlayer->Explode();
-	}
+	config.dWidth = GetSystemMetrics(SM_CXSCREEN);
+	config.dHeight = GetSystemMetrics(SM_CYSCREEN);
+
+	config.dPlayerSize[0][0] = m_pPlayer->getSize().x;
+	config.dPlayerSize[0][1] = m_pPlayer->getSize().y;
+	config.dPlayerSize[1][0] = m_pPlayer2->getSize().x;
+	config.dPlayerSize[1][1] = m_pPlayer2->getSize().y;
 
-	if (!m_pPlayer2->getLives() && !m_pPlayer2->hasExploded())
+	for (int m = 0; m < ESC_COUNT; m++)
 	{
-		fTimer = SetTimer(m_hWnd, 1, 70, NULL);
-		m_pPlayer2->Explode();
+		config.dCarSize[m][0] = m_carPools[m].Get(0)->width();
+		config.dCarSize[m][1] = m_carPools[m].Get(0)->height();
 	}
 
-	for (auto enem : m_enemies)
+	config.dBulletSize[0] = m_bulletPool.Get(0)->width();
+	config.dBulletSize[1] = m_bulletPool.Get(0)->height();
+
+	for (int i = 0; i < ESP_COUNT; i++)
 	{
-		if (enem->isDead)
-		{
-			m_enemies.remove(enem);
-			break;
-		}
+		config.dPowerUpSize[i][0] = getPowerUpSprite(i)->width();
+		config.dPowerUpSize[i][1] = getPowerUpSprite(i)->height();
 	}
+
+	m_sim.SetConfig(config);
 }
 
-bool CGameApp::CollisionPlayer1()
+//-----------------------------------------------------------------------------
+// Name : startSession () (Private)
+// Desc : Starts a new game, or the saved one, with a fresh seed and logs its
+//		input to savegame/last.input so the session can be replayed. The
+//		infinite road plays the endless levels of the level file alone.
+//-----------------------------------------------------------------------------
+void CGameApp::startSession(const SSimSave* pSave, bool bEndless)
 {
-	for (auto enem : m_enemies)
-	{
-		if (!m_pPlayer->invincibility)
-		{
-			if (m_pPlayer->Position().x + (m_pPlayer->getSize().x / 2) > enem->Position().x - (enem->getSize().x / 2))
-				if (m_pPlayer->Position().x - (m_pPlayer->getSize().x / 2) < enem->Position().x + (enem->getSize().x / 2))
-					if (m_pPlayer->Position().y + (m_pPlayer->getSize().y / 2) > enem->Position().y - (enem->getSize().y / 2))
-						if (m_pPlayer->Position().y - (m_pPlayer->getSize().y / 2) < enem->Position().y + (enem->getSize().y / 2))
-						{
-							if (!m_pPlayer->hasExploded() && m_livesGreen.size() > 0)
-							{
-								fTimer = SetTimer(m_hWnd, 1, 70, NULL);
-								m_pPlayer->takeDamage();
-								delete m_livesGreen.back();
-								m_livesGreen.pop_back();
-								m_pPlayer->Position() = Vec2(690, 600);
-								m_pPlayer->Velocity() = Vec2(0, 0);
-								enem->Explode();
-								mciSendString("play data/sounds/explosion.wav", NULL, 0, NULL);
-								return true;
-							}
-						}
-		}
+	SInputLogHeader header;
 
-	}
+	endSession();
+	configureSimulation();
+
+	// A file with only endless levels has nothing else to play
+	m_bEndless = m_levelFile.endless.bEnabled && (bEndless || m_levelFile.levels.empty());
 
-	return false;
+	header.uSeed = ((uint64_t)time(NULL) << 32) | ::GetTickCount();
+	header.config = m_sim.GetConfig();
+	header.levels = m_levelFile.levels;
+	header.endless = m_levelFile.endless;
+	if (m_bEndless) header.levels.clear();
+	else header.endless.bEnabled = false;
+	header.bFromSave = pSave != NULL;
+	if (pSave) header.save = *pSave;
+
+	InputLogStart(m_sim, header);
+	sizePools();
+
+	// The game runs on without a log if it cannot be written
+	m_recorder.Open("savegame/last.input", header);
 }
 
-bool CGameApp::CollisionPlayer2()
+//-----------------------------------------------------------------------------
+// Name : startReplay () (Private)
+// Desc : Plays back a session recorded by startSession().
+//-----------------------------------------------------------------------------
+void CGameApp::startReplay(LPCTSTR szFileName)
 {
-	for (auto enem : m_enemies)
-	{
-		if (!m_pPlayer2->invincibility)
-		{
-			if (m_pPlayer2->Position().x + (m_pPlayer2->getSize().x / 2) > enem->Position().x - (enem->getSize().x / 2))
-				if (m_pPlayer2->Position().x - (m_pPlayer2->getSize().x / 2) < enem->Position().x + (enem->getSize().x / 2))
-					if (m_pPlayer2->Position().y + (m_pPlayer2->getSize().y / 2) > enem->Position().y - (enem->getSize().y / 2))
-						if (m_pPlayer2->Position().y - (m_pPlayer2->getSize().y / 2) < enem->Position().y + (enem->getSize().y / 2))
-						{
-							if (!m_pPlayer2->hasExploded() && m_livesRed.size() > 0)
-							{
-								fTimer = SetTimer(m_hWnd, 1, 70, NULL);
-								m_pPlayer2->takeDamage();
-								delete m_livesRed.back();
-								m_livesRed.pop_back();
-								m_pPlayer2->Position() = Vec2(850, 600);
-								m_pPlayer2->Velocity() = Vec2(0, 0);
-								enem->Explode();
-								mciSendString("play data/sounds/explosion.wav", NULL, 0, NULL);
-								return true;
-							}
-						}
-		}
+	SInputLogHeader header;
 
+	if (!m_replay.Open(szFileName, header))
+	{
+		MessageBox(m_hWnd, _T("The replay file could not be read."), _T("Replay"), MB_OK | MB_ICONEXCLAMATION);
+		startSession(NULL, false);
+		return;
 	}
 
-	return false;
+	endSession();
+	InputLogStart(m_sim, header);
+	sizePools();
+	m_bEndless = header.endless.bEnabled;
+	m_sim.SetInput(&m_replay);
+	m_bReplay = true;
+
+	m_gameState = GameState::ONGOING;
+	updateGameState();
 }
 
-bool CGameApp::CollisionEnemy(CPlayer* enemy)
+//-----------------------------------------------------------------------------
+// Name : endSession () (Private)
+// Desc : Closes the input log of the current game with its final state.
+//-----------------------------------------------------------------------------
+void CGameApp::endSession()
 {
-	for (auto enem : m_enemies)
+	if (m_recorder.IsOpen())
+		m_recorder.Close(m_sim.GetStepCount(), m_sim.GetChecksum());
+
+	if (m_bReplay)
 	{
-		if (enem != enemy)
-		{
-			if (enemy->Position().x + (enemy->getSize().x / 2) > enem->Position().x - (enem->getSize().x / 2))
-				if (enemy->Position().x - (enemy->getSize().x / 2) < enem->Position().x + (enem->getSize().x / 2))
-					if (enemy->Position().y + (enemy->getSize().y / 2) > enem->Position().y - (enem->getSize().y / 2))
-						if (enemy->Position().y - (enemy->getSize().y / 2) < enem->Position().y + (enem->getSize().y / 2))
-						{
-							if (!enemy->isDead)
-							{
-								enem->isDead = 1;
-								return true;
-							}
-						}
-		}
+		m_replay.Close();
+		m_bReplay = false;
+		m_sim.SetInput(&m_recorder);
 	}
-
-	return false;
 }
 
-bool CGameApp::detectBulletCollision(const Sprite* bullet)
+//-----------------------------------------------------------------------------
+// Name : growPools () (Private)
+// Desc : Creates sprites for traffic, bullets and explosions until each pool
+//		holds at least the given number (per model for the cars), so
+//		drawing itself never allocates or loads a bitmap.
+//-----------------------------------------------------------------------------
+void CGameApp::growPools(size_t cars, size_t bullets, size_t explosions)
 {
-	for (auto enem : m_enemies)
+	// Animation frame crop rectangle
+	RECT r;
+	r.left = 0;
+	r.top = 0;
+	r.right = 128;
+	r.bottom = 128;
+
+	for (int m = 0; m < ESC_COUNT; m++)
 	{
-		if (bulletCollision(*bullet, *enem) && m_pPlayer->gunPowerUp)
+		while (m_carPools[m].GetCapacity() < cars)
 		{
-			m_scoreP1->updateScore(100);
-			fTimer = SetTimer(m_hWnd, 1, 70, NULL);
-			enem->Explode();
-			mciSendString("play data/sounds/explosion.wav", NULL, 0, NULL);
-			return true;
+			Sprite* car = new Sprite(carImages[m], RGB(0xff, 0x00, 0xff));
+			car->setBackBuffer(m_pBBuffer);
+			m_carPools[m].Add(car);
 		}
+	}
 
-		if (bulletCollision(*bullet, *enem) && m_pPlayer2->gunPowerUp)
-		{
-			m_scoreP2->updateScore(100);
-			fTimer = SetTimer(m_hWnd, 1, 70, NULL);
-			enem->Explode();
-			mciSendString("play data/sounds/explosion.wav", NULL, 0, NULL);
-			return true;
-		}
+	while (m_bulletPool.GetCapacity() < bullets)
+	{
+		Sprite* bullet = new Sprite("data/bullet.bmp", RGB(0xff, 0x00, 0xff));
+		bullet->setBackBuffer(m_pBBuffer);
+		m_bulletPool.Add(bullet);
 	}
 
-	return false;
+	while (m_explosionPool.GetCapacity() < explosions)
+	{
+		AnimatedSprite* explosion = new AnimatedSprite("data/explosion.bmp", "data/explosionmask.bmp", r, 16);
+		explosion->setBackBuffer(m_pBBuffer);
+		m_explosionPool.Add(explosion);
+	}
 }
 
-bool CGameApp::bulletCollision(const Sprite& bullet, CPlayer& p1)
+//-----------------------------------------------------------------------------
+// Name : sizePools () (Private)
+// Desc : Grows the pools for the session the simulation was just set up
+//		for: a full screen of any one car model, every car of it exploding,
+//		and every player shooting non-stop.
+//-----------------------------------------------------------------------------
+void CGameApp::sizePools()
 {
-	if (bullet.mPosition.x >= p1.Position().x - (p1.getSize().x / 2))
-		if (bullet.mPosition.x <= p1.Position().x + (p1.getSize().x / 2))
-			if (bullet.mPosition.y >= p1.Position().y - (p1.getSize().y / 2))
-				if (bullet.mPosition.y <= p1.Position().y + (p1.getSize().y / 2))
-					return true;
+	size_t cars = (size_t)m_sim.GetMaxVisibleCars();
 
-	return false;
+	// A bullet crosses at most the whole screen, one more is fired every
+	// SIM_SHOT_STEPS steps meanwhile
+	double shotSpacing = SIM_BULLET_SPEED * SIM_SHOT_STEPS * SIM_STEP;
+	size_t bullets = SIM_PLAYERS * ((size_t)(m_sim.GetConfig().dHeight / shotSpacing) + 1);
 
+	growPools(cars, bullets, cars + SIM_PLAYERS);
 }
 
-void CGameApp::fireBullet(const Vec2 position, const Vec2 velocity)
+//-----------------------------------------------------------------------------
+// Name : getPowerUpSprite () (Private)
+// Desc : Sprite drawn for a power-up.
+//-----------------------------------------------------------------------------
+Sprite* CGameApp::getPowerUpSprite(unsigned int id)
 {
+	switch (id)
+	{
+	case ESP_LIFE:		return addLivePower;
+	case ESP_SHIELD:	return shieldPower;
+	case ESP_GUN:		return gunPower;
+	case ESP_DOUBLER:	return doublerPower;
+	}
+	return NULL;
+}
 
-	bullets.push_back(new Sprite("data/bullet.bmp", RGB(0xff, 0x00, 0xff)));
-
-	bullets.back()->setBackBuffer(m_pBBuffer);
-	bullets.back()->mPosition = position;
-	bullets.back()->mVelocity = velocity;
-
+//-----------------------------------------------------------------------------
+// Name : GetButtons ()
+// Desc : Buttons a player holds for the simulation step being run.
+//-----------------------------------------------------------------------------
+unsigned int CGameApp::GetButtons(int nPlayer)
+{
+	return m_buttons[nPlayer];
+}
 
-	if (velocity.y < 0)
+//-----------------------------------------------------------------------------
+// Name : PlayEffect ()
+// Desc : Plays a sound the simulation asked for.
+//-----------------------------------------------------------------------------
+void CGameApp::PlayEffect(ESimSound eSound)
+{
+	switch (eSound)
 	{
-		bullets.back()->mPosition.y -= 75;
+	case ESS_EXPLOSION:
+		mciSendString("play data/sounds/explosion.wav", NULL, 0, NULL);
+		break;
+	case ESS_POWERUP:
+		mciSendString("play data/sounds/power_up.wav", NULL, 0, NULL);
+		break;
+	case ESS_SHOOT:
+		mciSendString("play data/sounds/shoot.wav", NULL, 0, NULL);
+		break;
+	case ESS_TIMER:
+		mciSendString("play data/sounds/timer.wav", NULL, 0, NULL);
+		break;
+	case ESS_LEVEL_FINISHED:
+		mciSendString("play data/sounds/finishLevel.wav", NULL, 0, NULL);
+		break;
 	}
-	else
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawObject ()
+// Desc : Queues a sprite for an object the simulation reports. Cars, bullets
+//		and explosions borrow a sprite from their pool for this frame.
+//-----------------------------------------------------------------------------
+void CGameApp::DrawObject(ESimObject eObject, unsigned int uVariant, double x, double y)
+{
+	Sprite* pSprite = NULL;
+	unsigned int index;
+
+	switch (eObject)
 	{
-		bullets.back()->mPosition.y += 75;
+	case ESO_PLAYER:
+		pSprite = (uVariant == 0 ? m_pPlayer : m_pPlayer2)->GetDrawSprite();
+		break;
+	case ESO_CAR:
+		m_carDemand[uVariant]++;
+		index = m_carPools[uVariant].Acquire();
+		if (index != POOL_EMPTY)
+			pSprite = m_carPools[uVariant].Get(index);
+		break;
+	case ESO_BULLET:
+		m_bulletDemand++;
+		index = m_bulletPool.Acquire();
+		if (index != POOL_EMPTY)
+			pSprite = m_bulletPool.Get(index);
+		break;
+	case ESO_POWERUP:
+		pSprite = getPowerUpSprite(uVariant);
+		break;
+	case ESO_EXPLOSION:
+		m_explosionDemand++;
+		index = m_explosionPool.Acquire();
+		if (index != POOL_EMPTY)
+		{
+			m_explosionPool.Get(index)->SetFrame(uVariant);
+			pSprite = m_explosionPool.Get(index);
+		}
+		break;
 	}
+
+	// Out of sprites, not shown this frame (the pool grows after it)
+	if (pSprite == NULL)
+		return;
+
+	pSprite->mPosition = Vec2(x, y);
+	queueSprite(pSprite);
 }
 
 void CGameApp::setPLives(int livesP1, int livesP2)
 {
-	m_pPlayer->setLives(livesP1);
-	m_pPlayer2->setLives(livesP1);
-
 	Vec2 greenPos(30, 80);
 	Vec2 increment(45, 0);
 
@@ -1453,7 +1292,7 @@ void CGameApp::setPLives(int livesP1, int livesP2)
 
 		lastGreen->mPosition = greenPos;
 		lastGreen->mVelocity = Vec2(0, 0);
-		lastGreen->setBackBuffer(m_pBBuffer);
+		lastGreen->setBackBuffer(m_pHudLayer->getSurface());
 
 		greenPos += increment;
 	}
@@ -1464,101 +1303,111 @@ void CGameApp::setPLives(int livesP1, int livesP2)
 
 		lastRed->mPosition = redPos;
 		lastRed->mVelocity = Vec2(0, 0);
-		lastRed->setBackBuffer(m_pBBuffer);
+		lastRed->setBackBuffer(m_pHudLayer->getSurface());
 
 		redPos += increment;
 	}
 }
 
-void CGameApp::updateGameState()
+//-----------------------------------------------------------------------------
+// Name : queueLives () (Private)
+// Desc : Adds the first lives hearts of a player to the HUD layer.
+//-----------------------------------------------------------------------------
+void CGameApp::queueLives(list<Sprite*>& hearts, int lives)
 {
-	if (m_pPlayer->isDead && m_pPlayer2->isDead && m_gameState == ONGOING) {
-		m_gameState = LOST;
-	}
-	else if (!m_enemies.size() && m_gameState == ONGOING) {
-		m_gameState = WON;
-	}
-	else if (!m_enemies.size() && m_gameState == WON && m_levels == LEVEL1)
-	{
-		addEnemies(25, 3, 70);
-		mciSendString("play data/sounds/finishLevel.wav", NULL, 0, NULL);
-		addPowerUp(powerUp);
-		m_pPlayer->Position() = Vec2(690, 600);
-		m_pPlayer->Velocity() = Vec2(0, 0);
-		m_pPlayer2->Position() = Vec2(850, 600);
-		m_pPlayer2->Velocity() = Vec2(0, 0);
-		m_levels = LEVEL2;
-		levelForSave = "level2";
-		m_gameState = ONGOING;
-	}
-	else if (!m_enemies.size() && m_gameState == WON && m_levels == LEVEL2)
+	for (auto heart : hearts)
 	{
-		addEnemies(28, 3, 75);
-		mciSendString("play data/sounds/finishLevel.wav", NULL, 0, NULL);
-		addPowerUp(powerUp);
-		m_pPlayer->Position() = Vec2(690, 600);
-		m_pPlayer->Velocity() = Vec2(0, 0);
-		m_pPlayer2->Position() = Vec2(850, 600);
-		m_pPlayer2->Velocity() = Vec2(0, 0);
-		m_levels = LEVEL3;
-		levelForSave = "level3";
-		m_gameState = ONGOING;
-	}
-	else if (!m_enemies.size() && m_gameState == WON && m_levels == LEVEL3)
-	{
-		addEnemies(30, 3, 80);
-		mciSendString("play data/sounds/finishLevel.wav", NULL, 0, NULL);
-		addPowerUp(powerUp);
-		m_pPlayer->Position() = Vec2(690, 600);
-		m_pPlayer->Velocity() = Vec2(0, 0);
-		m_pPlayer2->Position() = Vec2(850, 600);
-		m_pPlayer2->Velocity() = Vec2(0, 0);
-		m_levels = LEVEL4;
-		levelForSave = "level4";
-		m_gameState = ONGOING;
+		if (lives-- <= 0)
+			break;
+		m_pHudLayer->queue(heart);
 	}
-	else if (!m_enemies.size() && m_gameState == WON && m_levels == LEVEL4)
+}
+
+//-----------------------------------------------------------------------------
+// Name : loadLevels () (Private)
+// Desc : Reads data/levels.txt and the HUD text of its levels.
+//-----------------------------------------------------------------------------
+bool CGameApp::loadLevels()
+{
+	string strError;
+
+	if (!LevelFileLoad("data/levels.txt", m_levelFile, strError))
 	{
-		addEnemies(35, 4, 85);
-		mciSendString("play data/sounds/finishLevel.wav", NULL, 0, NULL);
-		addPowerUp(powerUp);
-		m_pPlayer->Position() = Vec2(690, 600);
-		m_pPlayer->Velocity() = Vec2(0, 0);
-		m_pPlayer2->Position() = Vec2(850, 600);
-		m_pPlayer2->Velocity() = Vec2(0, 0);
-		m_levels = LEVEL5;
-		levelForSave = "level5";
-		m_gameState = ONGOING;
+		MessageBox(m_hWnd, strError.c_str(), _T("Levels"), MB_OK | MB_ICONSTOP);
+		return false;
 	}
-	else if (!m_enemies.size() && m_gameState == WON && m_levels == LEVEL5)
-	{
+
+	for (auto &label : m_levelFile.labels)
+		m_levelLabels.push_back(loadLabel(label));
+	m_endlessLabel = loadLabel(m_levelFile.strEndlessLabel);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : loadLabel () (Private)
+// Desc : Creates the HUD sprite of a level label, NULL for a level without one.
+//-----------------------------------------------------------------------------
+Sprite* CGameApp::loadLabel(const string& strBitmap)
+{
+	if (strBitmap.empty())
+		return NULL;
+
+	// Only the label of the level being played is ever drawn
+	Sprite* label = new Sprite(("data/" + strBitmap).c_str(), RGB(0xff, 0x00, 0xff), ELM_MAPPED);
+	label->setBackBuffer(m_pHudLayer->getSurface());
+	label->mPosition = Vec2(80, 230);
+	return label;
+}
+
+//-----------------------------------------------------------------------------
+// Name : queueLevelLabel () (Private)
+// Desc : Adds the label of the level being played to the HUD layer.
+//-----------------------------------------------------------------------------
+void CGameApp::queueLevelLabel()
+{
+	Sprite* label = NULL;
+	size_t level = (size_t)m_sim.GetLevel();
+
+	if (level < (size_t)m_sim.GetLevelCount())
+		label = level < m_levelLabels.size() ? m_levelLabels[level] : NULL;
+	else
+		label = m_endlessLabel;
+
+	if (label != NULL)
+		m_pHudLayer->queue(label);
+}
+
+//-----------------------------------------------------------------------------
+// Name : updateGameState () (Private)
+// Desc : Follows the simulation after a step: game over, level and scores.
+//-----------------------------------------------------------------------------
+void CGameApp::updateGameState()
+{
+	if (m_sim.GetState() == ESIM_LOST)
+		m_gameState = LOST;
+	else if (m_sim.GetState() == ESIM_WON)
 		m_gameState = WON;
-	}
-	else if (m_gameState == ONGOING) {
-		m_gameState = ONGOING;
-	}
+
+	if (m_scoreP1->getScore() != m_sim.GetPlayer(0).nScore)
+		m_scoreP1->setScore(m_sim.GetPlayer(0).nScore);
+	if (m_scoreP2->getScore() != m_sim.GetPlayer(1).nScore)
+		m_scoreP2->setScore(m_sim.GetPlayer(1).nScore);
 }
 
 void CGameApp::scrollingBackground(int speed)
 {
-	int x, y, i;
-	int currentSpeed = speed;
-	static int currentY = m_imgBackground.Height();
-	static size_t lastTime = ::GetTickCount();
-	size_t currentTime = ::GetTickCount();
+	DWORD currentTime = ::GetTickCount();
 
-	if (currentTime - lastTime > 100)
+	if (currentTime - m_nBackgroundTime > 100)
 	{
-		lastTime = currentTime;
-		currentY -= speed;
-		if (currentY < 0)
-			currentY = m_imgBackground.Height();
-
-		
+		m_nBackgroundTime = currentTime;
+		m_nBackgroundY -= speed;
+		if (m_nBackgroundY < 0)
+			m_nBackgroundY = m_imgBackground.Height();
 	}
 
-	m_imgBackground.Paint(m_pBBuffer->getDC(), 0, currentY);
-	
+	queueImage(&m_imgBackground, m_nBackgroundY);
 }
 
 //-----------------------------------------------------------------------------
@@ -1568,14 +1417,17 @@ void CGameApp::scrollingBackground(int speed)
 void CGameApp::saveGame()
 {
 	std::ofstream save("savegame/savegame.save");
+	SSimSave state;
 
-	save << m_pPlayer->Position().x << " " << m_pPlayer->Position().y << " " << m_pPlayer->getLives() << " ";
-	save << m_pPlayer2->Position().x << " " << m_pPlayer2->Position().y << " " << m_pPlayer2->getLives() << " ";
-	save << m_scoreP1->getScore() << "\n";
-	save << m_scoreP2->getScore() << "\n";
-	save << levelForSave << "\n";
+	m_sim.Save(state);
 
-	save << m_enemies.size() << "\n";
+	save << state.x[0] << " " << state.y[0] << " " << state.nLives[0] << " ";
+	save << state.x[1] << " " << state.y[1] << " " << state.nLives[1] << " ";
+	save << state.nScore[0] << "\n";
+	save << state.nScore[1] << "\n";
+	save << (m_bEndless ? "infinite" : "level") << state.nLevel + 1 << "\n";
+
+	save << state.nCars << "\n";
 
 	save.close();
 }
@@ -1587,147 +1439,27 @@ void CGameApp::saveGame()
 void CGameApp::loadGame()
 {
 	std::ifstream save("savegame/savegame.save");
-	while (m_enemies.size()) delete m_enemies.back(), m_enemies.pop_back();
-	while (bullets.size()) delete bullets.back(), bullets.pop_back();
-	while (m_livesGreen.size()) delete m_livesGreen.back(), m_livesGreen.pop_back();
-	while (m_livesRed.size()) delete m_livesRed.back(), m_livesRed.pop_back();
-
-	double cdx, cdy, cdx1, cdy1;
-	int livesP1, livesP2, score1, score2, noEnem;
+	SSimSave state = {};
 	string levelLoc;
 
-	save >> cdx >> cdy >> livesP1 >> cdx1 >> cdy1 >> livesP2 >> score1 >> score2 >> levelLoc;
-	m_pPlayer->Position() = Vec2(cdx, cdy);
-	m_pPlayer2->Position() = Vec2(cdx1, cdy1);
-	m_scoreP1->setScore(score1);
-	m_scoreP2->setScore(score2);
-
-	setPLives(livesP1, livesP2);
-
-	save >> noEnem;
-	addEnemies(noEnem, 2, 50);
+	save >> state.x[0] >> state.y[0] >> state.nLives[0] >> state.x[1] >> state.y[1] >> state.nLives[1];
+	save >> state.nScore[0] >> state.nScore[1] >> levelLoc >> state.nCars;
 
+	// No save yet, or a cut short one: stay in the menu (no message box,
+	// the menu polls Enter every step while it is held)
+	if (!save)
+		return;
 	save.close();
-	m_gameState = GameState::ONGOING;
-
-	if (levelLoc == "level1")
-	{
-		m_levels = Levels::LEVEL1;
-	}
-	else if (levelLoc == "level2")
-	{
-		m_levels = Levels::LEVEL2;
-	}
-	else if (levelLoc == "level3")
-	{
-		m_levels = Levels::LEVEL3;
-	}
-	else if (levelLoc == "level4")
-	{
-		m_levels = Levels::LEVEL4;
-	}
-	else if (levelLoc == "level5")
-	{
-		m_levels = Levels::LEVEL5;
-	}
-}
-
-void CGameApp::addPowerUp(int powerUp)
-{
-	int positionX, ok, iProv = 0, auxPositionY1 = 0, auxPositionY2 = 0, positionY = 0;
-	srand(time(NULL));
-
-	doublerPower = new Sprite("data/doubler.bmp", RGB(0xff, 0x00, 0xff));
-	doublerPower->setBackBuffer(m_pBBuffer);
-	addLivePower = new Sprite("data/heart.bmp", RGB(0xff, 0x00, 0xff));
-	addLivePower->setBackBuffer(m_pBBuffer);
-	gunPower = new Sprite("data/gun.bmp", RGB(0xff, 0x00, 0xff));
-	gunPower->setBackBuffer(m_pBBuffer);
-	shieldPower = new Sprite("data/shield.bmp", RGB(0xff, 0x00, 0xff));
-	shieldPower->setBackBuffer(m_pBBuffer);
-
-	positionX = 10;
-	ok = 0;
-	while (ok == 0)
-	{
-		positionX = rand() % GetSystemMetrics(SM_CXSCREEN);
-		//banda 1
-		if (positionX == 290 && ok == 0)
-			ok = 1;
-
-		//banda 2
-		if (positionX == 490 && ok == 0)
-			ok = 1;
 
-		//banda 3
-		if (positionX == 690 && ok == 0)
-			ok = 1;
+	// "level<n>", or "infinite<n>" on the infinite road
+	bool bEndless = levelLoc.compare(0, 8, "infinite") == 0 && m_levelFile.endless.bEnabled;
+	state.nLevel = 0;
+	if (bEndless)
+		state.nLevel = atoi(levelLoc.c_str() + 8) - 1;
+	else if (levelLoc.compare(0, 5, "level") == 0)
+		state.nLevel = atoi(levelLoc.c_str() + 5) - 1;
 
-		//banda 4
-		if (positionX == 890 && ok == 0)
-			ok = 1;
-
-
-		//banda 5
-		if (positionX == 1110 && ok == 0)
-			ok = 1;
-
-		//banda 6
-		if (positionX == (GetSystemMetrics(SM_CXSCREEN) - 230) && ok == 0)
-			ok = 1;
-			
-	}
-
-	//add live power up
-	auxPositionY1 = rand() % 10000 + 100;
-	positionY = auxPositionY1 - (2 * auxPositionY1);
-
-	addLivePower->mPosition = Vec2(positionX, positionY);
-	addLivePower->mVelocity = Vec2(0, 40);
-	
-	//shield power up - invincibility
-	auxPositionY2 = rand() % 10000 + 100;
-	while (auxPositionY2 == auxPositionY1)
-		auxPositionY2 = rand() % 10000 + 100;
-	positionY = auxPositionY2 - (2 * auxPositionY2);
-	auxPositionY1 = auxPositionY2;
-
-	shieldPower->mPosition = Vec2(positionX, positionY);
-	shieldPower->mVelocity = Vec2(0, 40);
-
-	//gun power up - you can shoot
-	auxPositionY2 = rand() % 10000 + 100;
-	while (auxPositionY2 == auxPositionY1)
-		auxPositionY2 = rand() % 10000 + 100;
-	positionY = auxPositionY2 - (2 * auxPositionY2);
-	auxPositionY1 = auxPositionY2;
-
-	gunPower->mPosition = Vec2(positionX, positionY);
-	gunPower->mVelocity = Vec2(0, 40);
-
-	//doubler power up - double your points
-	auxPositionY2 = rand() % 10000 + 100;
-	while (auxPositionY2 == auxPositionY1)
-		auxPositionY2 = rand() % 10000 + 100;
-	positionY = auxPositionY2 - (2 * auxPositionY2);
-
-	doublerPower->mPosition = Vec2(positionX, positionY);
-	doublerPower->mVelocity = Vec2(0, 40);
+	startSession(&state, bEndless);
+	m_gameState = GameState::ONGOING;
+	updateGameState();
 }
-
-bool CGameApp::powerUpCollision(Sprite* powerUp, CPlayer* p1)
-{
-	if (powerUp->mPosition.x >= p1->Position().x - (p1->getSize().x / 2))
-		if (powerUp->mPosition.x <= p1->Position().x + (p1->getSize().x / 2))
-			if (powerUp->mPosition.y >= p1->Position().y - (p1->getSize().y / 2))
-				if (powerUp->mPosition.y <= p1->Position().y + (p1->getSize().y / 2))
-				{
-					mciSendString("play data/sounds/power_up.wav", NULL, 0, NULL);
-					powerUp->deleted = 1;
-					return true;
-				}
-					
-
-	return false;
-
-}
\ No newline at end of file
@@ -118,6 +118,15 @@ void CPlayer::Draw()
 		
 }
 
+Sprite* CPlayer::GetDrawSprite()
+{
+	// The sprite Draw() shows: the car, or its explosion
+	if(m_bExplosion)
+		return m_pExplosionSprite;
+
+	return m_pSprite;
+}
+
 void CPlayer::Move(ULONG ulDirection)
 {
 	if (m_pSprite->mPosition.x - m_pSprite->width()/2 <= 220)
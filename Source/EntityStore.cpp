@@ -0,0 +1,226 @@
+// EntityStore.cpp
+#include "EntityStore.h"
+
+CEntityStore::CEntityStore()
+{
+	for(int k = 0; k < EEK_COUNT; k++)
+		m_KindCount[k] = 0;
+}
+
+SEntityHandle CEntityStore::InvalidHandle()
+{
+	SEntityHandle h = { 0, 0 };
+	return h;
+}
+
+SEntityHandle CEntityStore::Create(EEntityKind eKind, double x, double y, double vx, double vy,
+	double dHalfWidth, double dHalfHeight, unsigned int uVariant)
+{
+	unsigned int uSlot;
+	if(!m_FreeSlots.empty())
+	{
+		uSlot = m_FreeSlots.back();
+		m_FreeSlots.pop_back();
+	}
+	else
+	{
+		uSlot = (unsigned int)m_SlotIndex.size();
+		m_SlotIndex.push_back(0);
+		m_SlotGeneration.push_back(0);
+	}
+
+	// generation 0 marks the invalid handle, skip it on wrap around
+	if(++m_SlotGeneration[uSlot] == 0)
+		m_SlotGeneration[uSlot] = 1;
+	m_SlotIndex[uSlot] = (unsigned int)m_Kind.size();
+
+	m_PosX.push_back(x);
+	m_PosY.push_back(y);
+	m_PrevX.push_back(x);
+	m_PrevY.push_back(y);
+	m_VelX.push_back(vx);
+	m_VelY.push_back(vy);
+	m_HalfW.push_back(dHalfWidth);
+	m_HalfH.push_back(dHalfHeight);
+	m_Flags.push_back(0);
+	m_Timer.push_back(0);
+	m_Kind.push_back((unsigned char)eKind);
+	m_Variant.push_back(uVariant);
+	m_Slot.push_back(uSlot);
+	m_KindCount[eKind]++;
+
+	SEntityHandle h = { uSlot, m_SlotGeneration[uSlot] };
+	return h;
+}
+
+void CEntityStore::Destroy(SEntityHandle h)
+{
+	if(IsValid(h))
+		DestroyAt(m_SlotIndex[h.uSlot]);
+}
+
+void CEntityStore::DestroyAt(size_t uIndex)
+{
+	size_t uLast = m_Kind.size() - 1;
+	unsigned int uSlot = m_Slot[uIndex];
+
+	m_KindCount[m_Kind[uIndex]]--;
+
+	// move the last entity into the hole
+	if(uIndex != uLast)
+	{
+		m_PosX[uIndex] = m_PosX[uLast];
+		m_PosY[uIndex] = m_PosY[uLast];
+		m_PrevX[uIndex] = m_PrevX[uLast];
+		m_PrevY[uIndex] = m_PrevY[uLast];
+		m_VelX[uIndex] = m_VelX[uLast];
+		m_VelY[uIndex] = m_VelY[uLast];
+		m_HalfW[uIndex] = m_HalfW[uLast];
+		m_HalfH[uIndex] = m_HalfH[uLast];
+		m_Flags[uIndex] = m_Flags[uLast];
+		m_Timer[uIndex] = m_Timer[uLast];
+		m_Kind[uIndex] = m_Kind[uLast];
+		m_Variant[uIndex] = m_Variant[uLast];
+		m_Slot[uIndex] = m_Slot[uLast];
+		m_SlotIndex[m_Slot[uIndex]] = (unsigned int)uIndex;
+	}
+
+	m_PosX.pop_back();
+	m_PosY.pop_back();
+	m_PrevX.pop_back();
+	m_PrevY.pop_back();
+	m_VelX.pop_back();
+	m_VelY.pop_back();
+	m_HalfW.pop_back();
+	m_HalfH.pop_back();
+	m_Flags.pop_back();
+	m_Timer.pop_back();
+	m_Kind.pop_back();
+	m_Variant.pop_back();
+	m_Slot.pop_back();
+
+	// outstanding handles die with the generation bump on reuse
+	m_FreeSlots.push_back(uSlot);
+}
+
+void CEntityStore::Clear()
+{
+	while(!m_Kind.empty())
+		DestroyAt(m_Kind.size() - 1);
+}
+
+size_t CEntityStore::RemoveFlagged(unsigned int uFlag)
+{
+	size_t uCount = m_Kind.size();
+	size_t w = 0;
+
+	for(size_t i = 0; i < uCount; i++)
+	{
+		if(m_Flags[i] & uFlag)
+		{
+			m_KindCount[m_Kind[i]]--;
+			m_FreeSlots.push_back(m_Slot[i]);
+			continue;
+		}
+
+		if(w != i)
+		{
+			m_PosX[w] = m_PosX[i];
+			m_PosY[w] = m_PosY[i];
+			m_PrevX[w] = m_PrevX[i];
+			m_PrevY[w] = m_PrevY[i];
+			m_VelX[w] = m_VelX[i];
+			m_VelY[w] = m_VelY[i];
+			m_HalfW[w] = m_HalfW[i];
+			m_HalfH[w] = m_HalfH[i];
+			m_Flags[w] = m_Flags[i];
+			m_Timer[w] = m_Timer[i];
+			m_Kind[w] = m_Kind[i];
+			m_Variant[w] = m_Variant[i];
+			m_Slot[w] = m_Slot[i];
+			m_SlotIndex[m_Slot[w]] = (unsigned int)w;
+		}
+		w++;
+	}
+
+	m_PosX.resize(w);
+	m_PosY.resize(w);
+	m_PrevX.resize(w);
+	m_PrevY.resize(w);
+	m_VelX.resize(w);
+	m_VelY.resize(w);
+	m_HalfW.resize(w);
+	m_HalfH.resize(w);
+	m_Flags.resize(w);
+	m_Timer.resize(w);
+	m_Kind.resize(w);
+	m_Variant.resize(w);
+	m_Slot.resize(w);
+
+	return uCount - w;
+}
+
+bool CEntityStore::IsValid(SEntityHandle h) const
+{
+	if(h.uGeneration == 0 || h.uSlot >= m_SlotGeneration.size() || m_SlotGeneration[h.uSlot] != h.uGeneration)
+		return false;
+
+	// a freed slot keeps its generation until reused
+	unsigned int uIndex = m_SlotIndex[h.uSlot];
+	return uIndex < m_Slot.size() && m_Slot[uIndex] == h.uSlot;
+}
+
+SEntityHandle CEntityStore::HandleAt(size_t uIndex) const
+{
+	SEntityHandle h = { m_Slot[uIndex], m_SlotGeneration[m_Slot[uIndex]] };
+	return h;
+}
+
+SAabb CEntityStore::GetBox(size_t i) const
+{
+	SAabb box;
+	box.left = m_PosX[i] - m_HalfW[i];
+	box.top = m_PosY[i] - m_HalfH[i];
+	box.right = m_PosX[i] + m_HalfW[i];
+	box.bottom = m_PosY[i] + m_HalfH[i];
+	return box;
+}
+
+void CEntityStore::SaveState()
+{
+	m_PrevX = m_PosX;
+	m_PrevY = m_PosY;
+}
+
+void CEntityStore::Integrate(double dt)
+{
+	size_t uCount = m_Kind.size();
+	double *px = uCount ? &m_PosX[0] : NULL;
+	double *py = uCount ? &m_PosY[0] : NULL;
+	const double *vx = uCount ? &m_VelX[0] : NULL;
+	const double *vy = uCount ? &m_VelY[0] : NULL;
+
+	for(size_t i = 0; i < uCount; i++)
+	{
+		px[i] += vx[i] * dt;
+		py[i] += vy[i] * dt;
+	}
+}
+
+void CEntityStore::FlagBelow(EEntityKind eKind, double dLimitY, unsigned int uFlag)
+{
+	for(size_t i = 0; i < m_Kind.size(); i++)
+	{
+		if(m_Kind[i] == eKind && m_PosY[i] + m_HalfH[i] >= dLimitY)
+			m_Flags[i] |= uFlag;
+	}
+}
+
+void CEntityStore::FillBroadPhase(EEntityKind eKind, CBroadPhase &broadPhase) const
+{
+	for(size_t i = 0; i < m_Kind.size(); i++)
+	{
+		if(m_Kind[i] == eKind && !(m_Flags[i] & EEF_DEAD))
+			broadPhase.Insert(m_Slot[i], GetBox(i));
+	}
+}
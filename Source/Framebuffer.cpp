@@ -0,0 +1,296 @@
+// Framebuffer.cpp
+#include "Framebuffer.h"
+#include "BmpCodec.h"
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+// CRleSprite
+//-----------------------------------------------------------------------------
+CRleSprite::CRleSprite()
+{
+	m_lWidth = m_lHeight = 0;
+}
+
+void CRleSprite::Build(const RGBQUAD *pPixels, LONG lWidth, LONG lHeight, bool bBottomUp, COLORREF crKey)
+{
+	std::vector<DWORD> row(lWidth);
+
+	Reset(lWidth, lHeight);
+	for(LONG y = 0; y < lHeight; y++)
+	{
+		const RGBQUAD *pRow = pPixels + (bBottomUp ? lHeight - 1 - y : y) * lWidth;
+		for(LONG x = 0; x < lWidth; x++)
+			row[x] = QuadToPixel(pRow[x]);
+
+		AddRow(row.empty() ? NULL : &row[0], ColorRefToPixel(crKey));
+	}
+}
+
+void CRleSprite::Build(const CFramebuffer &source, COLORREF crKey)
+{
+	Reset(source.Width(), source.Height());
+	for(LONG y = 0; y < source.Height(); y++)
+		AddRow(source.Row(y), ColorRefToPixel(crKey));
+}
+
+bool CRleSprite::GetOpaqueBounds(RECT &rc) const
+{
+	bool bFound = false;
+
+	for(LONG y = 0; y < m_lHeight; y++)
+	{
+		if(m_RowStart[y] == m_RowStart[y + 1])
+			continue;
+
+		// spans are in x order within a row
+		const SSpan &first = m_Spans[m_RowStart[y]];
+		const SSpan &last = m_Spans[m_RowStart[y + 1] - 1];
+		LONG left = first.uX;
+		LONG right = last.uX + last.uLength;
+
+		if(!bFound)
+		{
+			rc.left = left;
+			rc.right = right;
+			rc.top = y;
+			bFound = true;
+		}
+		else
+		{
+			if(left < rc.left)
+				rc.left = left;
+			if(right > rc.right)
+				rc.right = right;
+		}
+
+		rc.bottom = y + 1;
+	}
+
+	return bFound;
+}
+
+void CRleSprite::Reset(LONG lWidth, LONG lHeight)
+{
+	m_lWidth = lWidth;
+	m_lHeight = lHeight;
+	m_RowStart.assign(1, 0);
+	m_Spans.clear();
+	m_Pixels.clear();
+}
+
+void CRleSprite::AddRow(const DWORD *pRow, DWORD uKey)
+{
+	LONG x = 0;
+
+	while(x < m_lWidth)
+	{
+		// skip the transparent run (the top byte is not part of the colour)
+		while(x < m_lWidth && (pRow[x] & 0x00FFFFFF) == uKey)
+			x++;
+
+		if(x == m_lWidth)
+			break;
+
+		// collect the opaque run
+		SSpan span;
+		span.uX = (WORD)x;
+		span.uPixel = (DWORD)m_Pixels.size();
+		while(x < m_lWidth && (pRow[x] & 0x00FFFFFF) != uKey)
+		{
+			m_Pixels.push_back(pRow[x]);
+			x++;
+		}
+
+		span.uLength = (WORD)(x - span.uX);
+		m_Spans.push_back(span);
+	}
+
+	m_RowStart.push_back((DWORD)m_Spans.size());
+}
+
+//-----------------------------------------------------------------------------
+// CFramebuffer
+//-----------------------------------------------------------------------------
+CFramebuffer::CFramebuffer()
+{
+	m_pPixels = NULL;
+	m_bOwnsPixels = false;
+	m_lWidth = m_lHeight = m_lPitch = 0;
+	ResetClipRect();
+}
+
+CFramebuffer::~CFramebuffer()
+{
+	Release();
+}
+
+void CFramebuffer::Create(LONG lWidth, LONG lHeight)
+{
+	Release();
+
+	m_pPixels = new DWORD[lWidth * lHeight];
+	m_bOwnsPixels = true;
+	m_lWidth = lWidth;
+	m_lHeight = lHeight;
+	m_lPitch = lWidth;
+	ResetClipRect();
+}
+
+void CFramebuffer::Attach(DWORD *pPixels, LONG lWidth, LONG lHeight, LONG lPitch)
+{
+	Release();
+
+	m_pPixels = pPixels;
+	m_bOwnsPixels = false;
+	m_lWidth = lWidth;
+	m_lHeight = lHeight;
+	m_lPitch = lPitch;
+	ResetClipRect();
+}
+
+void CFramebuffer::Release()
+{
+	if(m_bOwnsPixels)
+		delete[] m_pPixels;
+
+	m_pPixels = NULL;
+	m_bOwnsPixels = false;
+	m_lWidth = m_lHeight = m_lPitch = 0;
+	ResetClipRect();
+}
+
+void CFramebuffer::SetClipRect(const RECT &rc)
+{
+	m_rcClip.left = rc.left < 0 ? 0 : rc.left;
+	m_rcClip.top = rc.top < 0 ? 0 : rc.top;
+	m_rcClip.right = rc.right > m_lWidth ? m_lWidth : rc.right;
+	m_rcClip.bottom = rc.bottom > m_lHeight ? m_lHeight : rc.bottom;
+
+	// keep empty rectangles well formed
+	if(m_rcClip.right < m_rcClip.left)
+		m_rcClip.right = m_rcClip.left;
+	if(m_rcClip.bottom < m_rcClip.top)
+		m_rcClip.bottom = m_rcClip.top;
+}
+
+void CFramebuffer::ResetClipRect()
+{
+	m_rcClip.left = m_rcClip.top = 0;
+	m_rcClip.right = m_lWidth;
+	m_rcClip.bottom = m_lHeight;
+}
+
+void CFramebuffer::Clear(DWORD uPixel)
+{
+	FillRect(m_rcClip, uPixel);
+}
+
+void CFramebuffer::FillRect(const RECT &rc, DWORD uPixel)
+{
+	LONG left = rc.left > m_rcClip.left ? rc.left : m_rcClip.left;
+	LONG top = rc.top > m_rcClip.top ? rc.top : m_rcClip.top;
+	LONG right = rc.right < m_rcClip.right ? rc.right : m_rcClip.right;
+	LONG bottom = rc.bottom < m_rcClip.bottom ? rc.bottom : m_rcClip.bottom;
+
+	for(LONG y = top; y < bottom; y++)
+	{
+		DWORD *p = Row(y);
+		for(LONG x = left; x < right; x++)
+			p[x] = uPixel;
+	}
+}
+
+void CFramebuffer::Blit(const RGBQUAD *pPixels, LONG lWidth, LONG lHeight, LONG x, LONG y)
+{
+	LONG left = x > m_rcClip.left ? x : m_rcClip.left;
+	LONG top = y > m_rcClip.top ? y : m_rcClip.top;
+	LONG right = x + lWidth < m_rcClip.right ? x + lWidth : m_rcClip.right;
+	LONG bottom = y + lHeight < m_rcClip.bottom ? y + lHeight : m_rcClip.bottom;
+
+	for(LONG ty = top; ty < bottom; ty++)
+	{
+		// source rows are bottom-up
+		const RGBQUAD *pSrc = pPixels + (lHeight - 1 - (ty - y)) * lWidth;
+		DWORD *pDst = Row(ty);
+		for(LONG tx = left; tx < right; tx++)
+			pDst[tx] = QuadToPixel(pSrc[tx - x]);
+	}
+}
+
+void CFramebuffer::DrawSprite(const CRleSprite &sprite, LONG x, LONG y)
+{
+	LONG top = y > m_rcClip.top ? y : m_rcClip.top;
+	LONG bottom = y + sprite.m_lHeight < m_rcClip.bottom ? y + sprite.m_lHeight : m_rcClip.bottom;
+
+	for(LONG ty = top; ty < bottom; ty++)
+	{
+		LONG sy = ty - y;
+		DWORD *pDst = Row(ty);
+
+		for(DWORD s = sprite.m_RowStart[sy]; s < sprite.m_RowStart[sy + 1]; s++)
+		{
+			const CRleSprite::SSpan &span = sprite.m_Spans[s];
+			LONG left = x + span.uX;
+			LONG right = left + span.uLength;
+			const DWORD *pSrc = &sprite.m_Pixels[span.uPixel];
+
+			// clip the span horizontally
+			if(left < m_rcClip.left)
+			{
+				pSrc += m_rcClip.left - left;
+				left = m_rcClip.left;
+			}
+			if(right > m_rcClip.right)
+				right = m_rcClip.right;
+
+			if(left < right)
+				memcpy(pDst + left, pSrc, (right - left) * sizeof(DWORD));
+		}
+	}
+}
+
+bool CFramebuffer::SaveToFile(const char *szFileName) const
+{
+	CBmpWriter writer;
+	if(writer.Open(szFileName, m_lWidth, m_lHeight, 24, true) != EBR_OK)
+		return false;
+
+	std::vector<RGBQUAD> row(m_lWidth);
+	for(LONG y = 0; y < m_lHeight; y++)
+	{
+		const DWORD *pRow = Row(y);
+		for(LONG x = 0; x < m_lWidth; x++)
+		{
+			row[x].rgbRed = (BYTE)(pRow[x] >> 16);
+			row[x].rgbGreen = (BYTE)(pRow[x] >> 8);
+			row[x].rgbBlue = (BYTE)pRow[x];
+			row[x].rgbReserved = 0;
+		}
+
+		if(writer.WriteRow(&row[0]) != EBR_OK)
+			return false;
+	}
+
+	return writer.Close() == EBR_OK;
+}
+
+long CFramebuffer::Compare(const CFramebuffer &other) const
+{
+	if(m_lWidth != other.m_lWidth || m_lHeight != other.m_lHeight)
+		return -1;
+
+	long lDiff = 0;
+	for(LONG y = 0; y < m_lHeight; y++)
+	{
+		const DWORD *a = Row(y);
+		const DWORD *b = other.Row(y);
+		for(LONG x = 0; x < m_lWidth; x++)
+		{
+			// ignore the unused top byte
+			if((a[x] ^ b[x]) & 0x00FFFFFF)
+				lDiff++;
+		}
+	}
+
+	return lDiff;
+}
@@ -2,30 +2,24 @@
 // by Mihai Popescu
 // March 2009
 #include "ImageFile.h"
-
-extern HINSTANCE g_hInst;
+#include "BmpCodec.h"
 
 
 CImageFile::CImageFile() : height(m_biInfo.biHeight), width(m_biInfo.biWidth)
 {
 	m_hBMP = 0;
 	m_pRGB = NULL;
+	m_eLoadMode = ELM_IMMEDIATE;
+	m_bOwnsPixels = true;
 	ZeroMemory(&m_biInfo, sizeof(BITMAPINFOHEADER));
 }
 
-bool CImageFile::LoadBitmapFromFile(const char *szFileName, HDC hdc)
+bool CImageFile::LoadBitmapFromFile(const char *szFileName, HDC /*hdc*/)
 {
-	BYTE *pData;
-	HDC mdc = CreateCompatibleDC(hdc);
-
 	strcpy_s(m_szFileName, MAX_PATH, szFileName);
 
 	// release previously loaded file data
-	if(m_pRGB)
-	{
-		delete[] m_pRGB;
-		m_pRGB = NULL;
-	}
+	ReleasePixels();
 
 	if(m_hBMP)
 	{
@@ -33,57 +27,108 @@ bool CImageFile::LoadBitmapFromFile(const char *szFileName, HDC hdc)
 		m_hBMP = 0;
 	}
 
-	// Loads the image.
-	m_hBMP = (HBITMAP)LoadImage(g_hInst, szFileName, IMAGE_BITMAP, 0, 0, LR_CREATEDIBSECTION | LR_LOADFROMFILE);	
+	if(m_eLoadMode == ELM_MAPPED)
+		return MapBitmapFromFile(szFileName);
 
-	if(!m_hBMP)
+	// Decode straight into a 32 bit bottom-up buffer, the layout Paint hands to SetDIBits.
+	// NOTE: We keep the bitmap bits in order to modify them
+	// applying different filters or other image processing algorithms in real time 
+	// such as blur effect (denoising) or other convolutions.
+	if(BmpLoadFile(szFileName, m_biInfo, m_pRGB) != EBR_OK)
+	{
+		ZeroMemory(&m_biInfo, sizeof(BITMAPINFOHEADER));
 		return false;
+	}
 
-	ZeroMemory(&m_biInfo, sizeof(BITMAPINFO));
-	m_biInfo.biSize=sizeof(BITMAPINFOHEADER);
+	return true;
+}
 
-	// send NULL to bits to get the bitmap info
-	GetDIBits(mdc, m_hBMP, 0, 0, NULL, (BITMAPINFO*)&m_biInfo, DIB_RGB_COLORS);
+bool CImageFile::MapBitmapFromFile(const char *szFileName)
+{
+	SBmpLayout layout;
 
-	pData = new BYTE[m_biInfo.biSizeImage];
+	if(!m_Mapping.Open(szFileName))
+		return false;
 
-	// read the bitmap data
-	// NOTE: We use this method to access the bitmap bits in order to modify them
-	// applying different filters or other image processing algorithms in real time 
-	// such as blur effect (denoising) or other convolutions.
-	GetDIBits(mdc, m_hBMP, 0, height, pData, (BITMAPINFO*)&m_biInfo, DIB_RGB_COLORS);
+	// only the headers are read now, the pixels stay on disk until needed
+	BYTE *pFile = m_Mapping.GetData();
+	size_t uSize = m_Mapping.GetSize();
+	if(BmpParse(pFile, uSize, layout) != EBR_OK ||
+		(unsigned long long)layout.uPixelOffset + (unsigned long long)layout.uStride * layout.lHeight > uSize)
+	{
+		m_Mapping.Close();
+		ZeroMemory(&m_biInfo, sizeof(BITMAPINFOHEADER));
+		return false;
+	}
 
-	m_pRGB = new RGBQUAD[width * height];
+	BmpMakeInfoHeader(layout.lWidth, layout.lHeight, m_biInfo);
 
-	// Fill RGB image on 32 bit in order to display it
-	if(m_biInfo.biBitCount == 24)
+	if(BmpIsNativeLayout(layout))
 	{
-		int size = width * height;
-		unsigned char *data = pData;
-		RGBQUAD *c = m_pRGB;
-
-		for(int i=0;i<size;i++)
-		{
-			c->rgbBlue = *data++;
-			c->rgbGreen = *data++;
-			c->rgbRed = *data++;
-			c->rgbReserved = 0;
-			c++;
-		}
+		// the file already holds our rows: use the (copy-on-write) pages as they are
+		m_pRGB = (RGBQUAD*)(pFile + layout.uPixelOffset);
+		m_bOwnsPixels = false;
 	}
 
-	m_biInfo.biBitCount = 32;
+	return true;
+}
 
-	DeleteObject(m_hBMP);
-	m_hBMP = 0;
+bool CImageFile::EnsureDecoded()
+{
+	if(m_pRGB)
+		return true;
 
-	DeleteDC(mdc);
+	if(!m_Mapping.IsOpen())
+		return false;
 
-	delete[] pData;
+	SBmpLayout layout;
+	if(BmpParse(m_Mapping.GetData(), m_Mapping.GetSize(), layout) != EBR_OK)
+	{
+		m_Mapping.Close();
+		return false;
+	}
+
+	RGBQUAD *pPixels = new RGBQUAD[width * height];
+	EBmpResult eResult = BmpDecode(m_Mapping.GetData(), m_Mapping.GetSize(), layout, pPixels);
+
+	// converted (or unreadable), the file pages are no longer needed
+	m_Mapping.Close();
+
+	if(eResult != EBR_OK)
+	{
+		delete[] pPixels;
+		return false;
+	}
 
+	m_pRGB = pPixels;
+	m_bOwnsPixels = true;
 	return true;
 }
 
+void CImageFile::ReleasePixels()
+{
+	if(m_bOwnsPixels)
+		delete[] m_pRGB;
+
+	m_pRGB = NULL;
+	m_bOwnsPixels = true;
+	m_Mapping.Close();
+}
+
+void CImageFile::AdoptPixels(RGBQUAD *pPixels)
+{
+	ReleasePixels();
+	m_pRGB = pPixels;
+}
+
+bool CImageFile::SaveBitmapToFile(const char *szFileName, WORD uBitCount)
+{
+	if(!EnsureDecoded())
+		return false;
+
+	return BmpSaveFile(szFileName, m_pRGB, width, height, uBitCount) == EBR_OK;
+}
+
 void CImageFile::Reload(HDC hdc)
 {
 	LoadBitmapFromFile(m_szFileName, hdc);
@@ -91,7 +136,7 @@ void CImageFile::Reload(HDC hdc)
 
 void CImageFile::Paint(HDC hdc, int x, int y)
 {
-	if(!m_pRGB)
+	if(!EnsureDecoded())
 		return;
 
 	if(!m_hBMP)
@@ -112,8 +157,7 @@ void CImageFile::Paint(HDC hdc, int x, int y)
 
 CImageFile::~CImageFile(void)
 {
-	if(m_pRGB)
-		delete[] m_pRGB;
+	ReleasePixels();
 
 	DeleteObject(m_hBMP);
 }
@@ -125,6 +169,9 @@ BYTE* CImageFile::CopyMonoImage(EColorChannel chn, const RECT* rc)
 	int x = rc? rc->left : 0;
 	int y = rc? rc->top : 0;
 
+	if(!EnsureDecoded())
+		return NULL;
+
 	BYTE *img = new BYTE[imgHeight * imgWidth];
 
 	switch(chn)
@@ -267,6 +314,9 @@ void CImageFile::PasteMonoImage(const BYTE *img, EColorChannel chn, const RECT*
 	int x = rc? rc->left : 0;
 	int y = rc? rc->top : 0;
 
+	if(!EnsureDecoded())
+		return;
+
 	if(chn >= ECC_EXCLUSIVERED)
 		Clear();
 
@@ -0,0 +1,479 @@
+// InputLog.cpp
+#include "InputLog.h"
+#include <string.h>
+
+static const char s_Magic[4] = { 'R', 'S', 'I', 'L' };
+
+static void WriteU64(FILE *pFile, uint64_t u)
+{
+	unsigned char bytes[8];
+	for(int i = 0; i < 8; i++)
+		bytes[i] = (unsigned char)(u >> (8 * i));
+	fwrite(bytes, 1, 8, pFile);
+}
+
+static void WriteU32(FILE *pFile, uint32_t u)
+{
+	unsigned char bytes[4];
+	for(int i = 0; i < 4; i++)
+		bytes[i] = (unsigned char)(u >> (8 * i));
+	fwrite(bytes, 1, 4, pFile);
+}
+
+static void WriteDouble(FILE *pFile, double d)
+{
+	uint64_t u;
+	memcpy(&u, &d, sizeof(u));
+	WriteU64(pFile, u);
+}
+
+static void WriteVarint(FILE *pFile, unsigned long u)
+{
+	do
+	{
+		unsigned char b = (unsigned char)(u & 0x7F);
+		u >>= 7;
+		if(u)
+			b |= 0x80;
+		fputc(b, pFile);
+	} while(u);
+}
+
+static bool ReadU64(FILE *pFile, uint64_t &u)
+{
+	unsigned char bytes[8];
+	if(fread(bytes, 1, 8, pFile) != 8)
+		return false;
+
+	u = 0;
+	for(int i = 0; i < 8; i++)
+		u |= (uint64_t)bytes[i] << (8 * i);
+	return true;
+}
+
+static bool ReadU32(FILE *pFile, uint32_t &u)
+{
+	unsigned char bytes[4];
+	if(fread(bytes, 1, 4, pFile) != 4)
+		return false;
+
+	u = 0;
+	for(int i = 0; i < 4; i++)
+		u |= (uint32_t)bytes[i] << (8 * i);
+	return true;
+}
+
+static bool ReadDouble(FILE *pFile, double &d)
+{
+	uint64_t u;
+	if(!ReadU64(pFile, u))
+		return false;
+
+	memcpy(&d, &u, sizeof(d));
+	return true;
+}
+
+static bool ReadVarint(FILE *pFile, unsigned long &u)
+{
+	u = 0;
+	for(int nShift = 0; nShift < (int)sizeof(u) * 8; nShift += 7)
+	{
+		int c = fgetc(pFile);
+		if(c == EOF)
+			return false;
+
+		u |= (unsigned long)(c & 0x7F) << nShift;
+		if(!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// Every double of the config, in file order
+static int ConfigValues(SSimConfig &config, double *pValues[])
+{
+	int n = 0;
+	pValues[n++] = &config.dWidth;
+	pValues[n++] = &config.dHeight;
+	for(int p = 0; p < SIM_PLAYERS; p++)
+	{
+		pValues[n++] = &config.dPlayerSize[p][0];
+		pValues[n++] = &config.dPlayerSize[p][1];
+	}
+	for(int m = 0; m < ESC_COUNT; m++)
+	{
+		pValues[n++] = &config.dCarSize[m][0];
+		pValues[n++] = &config.dCarSize[m][1];
+	}
+	pValues[n++] = &config.dBulletSize[0];
+	pValues[n++] = &config.dBulletSize[1];
+	for(int i = 0; i < ESP_COUNT; i++)
+	{
+		pValues[n++] = &config.dPowerUpSize[i][0];
+		pValues[n++] = &config.dPowerUpSize[i][1];
+	}
+	return n;
+}
+
+#define CONFIG_VALUES	(2 + SIM_PLAYERS * 2 + ESC_COUNT * 2 + 2 + ESP_COUNT * 2)
+
+// Every int of a level, in file order
+static int LevelValues(SSimLevel &level, int *pValues[])
+{
+	int n = 0;
+	pValues[n++] = &level.nCars;
+	pValues[n++] = &level.nVelocity;
+	pValues[n++] = &level.nRampStep;
+	pValues[n++] = &level.nRampEvery;
+	pValues[n++] = &level.nRampCount;
+	for(int m = 0; m < ESC_COUNT; m++)
+		pValues[n++] = &level.nMix[m];
+	pValues[n++] = &level.nPowerUpMask;
+	pValues[n++] = &level.nPowerUpNear;
+	pValues[n++] = &level.nPowerUpFar;
+	pValues[n++] = &level.nLanes;
+	for(int i = 0; i < SIM_MAX_LANES; i++)
+		pValues[n++] = &level.nLane[i];
+	return n;
+}
+
+#define LEVEL_VALUES	(5 + ESC_COUNT + 4 + SIM_MAX_LANES)
+
+// More levels than this is a damaged log
+#define MAX_LOG_LEVELS	100000
+
+static void WriteLevel(FILE *pFile, const SSimLevel &level)
+{
+	SSimLevel copy = level;
+	int *pValues[LEVEL_VALUES];
+	int nValues = LevelValues(copy, pValues);
+	for(int i = 0; i < nValues; i++)
+		WriteU32(pFile, (uint32_t)*pValues[i]);
+}
+
+static bool ReadLevel(FILE *pFile, SSimLevel &level)
+{
+	int *pValues[LEVEL_VALUES];
+	int nValues = LevelValues(level, pValues);
+	for(int i = 0; i < nValues; i++)
+	{
+		uint32_t u;
+		if(!ReadU32(pFile, u))
+			return false;
+		*pValues[i] = (int)u;
+	}
+	return CSimulation::CheckLevel(level);
+}
+
+void InputLogStart(CSimulation &sim, const SInputLogHeader &header)
+{
+	sim.SetConfig(header.config);
+	sim.SetLevels(header.levels);
+	sim.SetEndless(header.endless);
+
+	if(header.bFromSave)
+		sim.Load(header.save, header.uSeed);
+	else
+		sim.NewGame(header.uSeed);
+}
+
+//-----------------------------------------------------------------------------
+// CInputRecorder
+//-----------------------------------------------------------------------------
+CInputRecorder::CInputRecorder()
+{
+	m_pFile = NULL;
+	m_pSource = NULL;
+	m_bFailed = false;
+	m_uRunLength = 0;
+	memset(m_Step, 0, sizeof(m_Step));
+	memset(m_Run, 0, sizeof(m_Run));
+}
+
+CInputRecorder::~CInputRecorder()
+{
+	// No end record: replays treat the log as cut short
+	if(m_pFile)
+		fclose(m_pFile);
+}
+
+bool CInputRecorder::Open(const char *szFileName, const SInputLogHeader &header)
+{
+	if(m_pFile)
+		fclose(m_pFile);
+
+	m_pFile = fopen(szFileName, "wb");
+	if(!m_pFile)
+		return false;
+
+	m_bFailed = false;
+	m_uRunLength = 0;
+
+	fwrite(s_Magic, 1, sizeof(s_Magic), m_pFile);
+	WriteU32(m_pFile, INPUTLOG_VERSION);
+	WriteU64(m_pFile, header.uSeed);
+
+	SSimConfig config = header.config;
+	double *pValues[CONFIG_VALUES];
+	int nValues = ConfigValues(config, pValues);
+	for(int i = 0; i < nValues; i++)
+		WriteDouble(m_pFile, *pValues[i]);
+
+	WriteU32(m_pFile, (uint32_t)header.levels.size());
+	for(size_t l = 0; l < header.levels.size(); l++)
+		WriteLevel(m_pFile, header.levels[l]);
+
+	fputc(header.endless.bEnabled ? 1 : 0, m_pFile);
+	if(header.endless.bEnabled)
+	{
+		const SSimEndless &endless = header.endless;
+		WriteLevel(m_pFile, endless.base);
+		WriteU32(m_pFile, (uint32_t)endless.nCarsGrowth);
+		WriteU32(m_pFile, (uint32_t)endless.nCarsLimit);
+		WriteU32(m_pFile, (uint32_t)endless.nVelocityGrowth);
+		WriteU32(m_pFile, (uint32_t)endless.nVelocityLimit);
+	}
+
+	fputc(header.bFromSave ? 1 : 0, m_pFile);
+	if(header.bFromSave)
+	{
+		const SSimSave &save = header.save;
+		for(int n = 0; n < SIM_PLAYERS; n++)
+		{
+			WriteDouble(m_pFile, save.x[n]);
+			WriteDouble(m_pFile, save.y[n]);
+		}
+		for(int n = 0; n < SIM_PLAYERS; n++)
+		{
+			WriteU32(m_pFile, (uint32_t)save.nLives[n]);
+			WriteU32(m_pFile, (uint32_t)save.nScore[n]);
+		}
+		WriteU32(m_pFile, (uint32_t)save.nLevel);
+		WriteU32(m_pFile, (uint32_t)save.nCars);
+	}
+
+	if(ferror(m_pFile))
+	{
+		fclose(m_pFile);
+		m_pFile = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool CInputRecorder::Close(unsigned long uSteps, uint64_t uChecksum)
+{
+	if(!m_pFile)
+		return false;
+
+	WriteRun();
+	WriteVarint(m_pFile, 0);
+	WriteU64(m_pFile, uSteps);
+	WriteU64(m_pFile, uChecksum);
+
+	bool bOk = !m_bFailed && !ferror(m_pFile);
+	if(fclose(m_pFile) != 0)
+		bOk = false;
+	m_pFile = NULL;
+	return bOk;
+}
+
+unsigned int CInputRecorder::GetButtons(int nPlayer)
+{
+	unsigned int uButtons = m_pSource ? m_pSource->GetButtons(nPlayer) : 0;
+
+	if(!m_pFile)
+		return uButtons;
+
+	m_Step[nPlayer] = (unsigned char)uButtons;
+
+	// The last player completes the step
+	if(nPlayer == SIM_PLAYERS - 1)
+	{
+		if(m_uRunLength && memcmp(m_Step, m_Run, sizeof(m_Run)) != 0)
+			WriteRun();
+
+		memcpy(m_Run, m_Step, sizeof(m_Run));
+		m_uRunLength++;
+	}
+
+	return uButtons;
+}
+
+void CInputRecorder::WriteRun()
+{
+	if(!m_uRunLength)
+		return;
+
+	WriteVarint(m_pFile, m_uRunLength);
+	fwrite(m_Run, 1, sizeof(m_Run), m_pFile);
+	m_uRunLength = 0;
+
+	// Keep what was played so far if the game goes down
+	if(fflush(m_pFile) != 0)
+		m_bFailed = true;
+}
+
+//-----------------------------------------------------------------------------
+// CInputReplay
+//-----------------------------------------------------------------------------
+CInputReplay::CInputReplay()
+{
+	m_pFile = NULL;
+	m_bEnded = true;
+	m_bHasEnd = false;
+	m_uEndSteps = 0;
+	m_uEndChecksum = 0;
+	m_uRunLeft = 0;
+	memset(m_Run, 0, sizeof(m_Run));
+}
+
+CInputReplay::~CInputReplay()
+{
+	Close();
+}
+
+bool CInputReplay::Open(const char *szFileName, SInputLogHeader &header)
+{
+	Close();
+
+	m_pFile = fopen(szFileName, "rb");
+	if(!m_pFile)
+		return false;
+
+	char magic[4];
+	uint32_t uVersion;
+	bool bOk = fread(magic, 1, sizeof(magic), m_pFile) == sizeof(magic) && !memcmp(magic, s_Magic, sizeof(magic)) &&
+		ReadU32(m_pFile, uVersion) && uVersion == INPUTLOG_VERSION && ReadU64(m_pFile, header.uSeed);
+
+	double *pValues[CONFIG_VALUES];
+	int nValues = ConfigValues(header.config, pValues);
+	for(int i = 0; bOk && i < nValues; i++)
+		bOk = ReadDouble(m_pFile, *pValues[i]);
+
+	uint32_t uLevels = 0;
+	bOk = bOk && ReadU32(m_pFile, uLevels) && uLevels <= MAX_LOG_LEVELS;
+	header.levels.resize(bOk ? uLevels : 0);
+	for(uint32_t l = 0; bOk && l < uLevels; l++)
+		bOk = ReadLevel(m_pFile, header.levels[l]);
+
+	int nEndless = bOk ? fgetc(m_pFile) : EOF;
+	bOk = nEndless == 0 || nEndless == 1;
+	header.endless.bEnabled = nEndless == 1;
+
+	if(bOk && header.endless.bEnabled)
+	{
+		SSimEndless &endless = header.endless;
+		uint32_t values[4] = { 0 };
+
+		bOk = ReadLevel(m_pFile, endless.base);
+		for(int i = 0; bOk && i < 4; i++)
+			bOk = ReadU32(m_pFile, values[i]);
+
+		endless.nCarsGrowth = (int)values[0];
+		endless.nCarsLimit = (int)values[1];
+		endless.nVelocityGrowth = (int)values[2];
+		endless.nVelocityLimit = (int)values[3];
+		bOk = bOk && endless.nCarsGrowth >= 0 && endless.nCarsLimit > 0 &&
+			endless.nVelocityGrowth >= 0 && endless.nVelocityLimit > 0;
+	}
+
+	int nFromSave = bOk ? fgetc(m_pFile) : EOF;
+	bOk = nFromSave == 0 || nFromSave == 1;
+	header.bFromSave = nFromSave == 1;
+
+	if(bOk && header.bFromSave)
+	{
+		SSimSave &save = header.save;
+		uint32_t values[2 * SIM_PLAYERS + 2];
+
+		for(int n = 0; bOk && n < SIM_PLAYERS; n++)
+			bOk = ReadDouble(m_pFile, save.x[n]) && ReadDouble(m_pFile, save.y[n]);
+		for(int i = 0; bOk && i < 2 * SIM_PLAYERS + 2; i++)
+			bOk = ReadU32(m_pFile, values[i]);
+
+		if(bOk)
+		{
+			for(int n = 0; n < SIM_PLAYERS; n++)
+			{
+				save.nLives[n] = (int)values[2 * n];
+				save.nScore[n] = (int)values[2 * n + 1];
+			}
+			save.nLevel = (int)values[2 * SIM_PLAYERS];
+			save.nCars = (int)values[2 * SIM_PLAYERS + 1];
+		}
+	}
+
+	if(!bOk)
+	{
+		Close();
+		return false;
+	}
+
+	m_bEnded = false;
+	m_bHasEnd = false;
+	m_uRunLeft = 0;
+	return true;
+}
+
+void CInputReplay::Close()
+{
+	if(m_pFile)
+		fclose(m_pFile);
+
+	m_pFile = NULL;
+	m_bEnded = true;
+	m_uRunLeft = 0;
+}
+
+bool CInputReplay::ReadRun()
+{
+	unsigned long uLength;
+
+	if(!ReadVarint(m_pFile, uLength))
+		return false;
+
+	if(uLength == 0)
+	{
+		uint64_t uSteps = 0;
+		m_bHasEnd = ReadU64(m_pFile, uSteps) && ReadU64(m_pFile, m_uEndChecksum);
+		m_uEndSteps = (unsigned long)uSteps;
+		return false;
+	}
+
+	if(fread(m_Run, 1, sizeof(m_Run), m_pFile) != sizeof(m_Run))
+		return false;
+
+	m_uRunLeft = uLength;
+	return true;
+}
+
+bool CInputReplay::AtEnd()
+{
+	if(!m_bEnded && !m_uRunLeft && !ReadRun())
+		m_bEnded = true;
+
+	return m_bEnded;
+}
+
+bool CInputReplay::GetEnd(unsigned long &uSteps, uint64_t &uChecksum) const
+{
+	uSteps = m_uEndSteps;
+	uChecksum = m_uEndChecksum;
+	return m_bHasEnd;
+}
+
+unsigned int CInputReplay::GetButtons(int nPlayer)
+{
+	if(AtEnd())
+		return 0;
+
+	unsigned int uButtons = m_Run[nPlayer];
+
+	// The last player completes the step
+	if(nPlayer == SIM_PLAYERS - 1)
+		m_uRunLeft--;
+
+	return uButtons;
+}
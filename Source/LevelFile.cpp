@@ -0,0 +1,221 @@
+// LevelFile.cpp
+#include "LevelFile.h"
+#include <fstream>
+#include <sstream>
+#include <limits.h>
+
+static const char *s_PowerUpNames[ESP_COUNT] = { "life", "shield", "gun", "doubler" };
+
+// Whole numbers only, "12abc" is a mistake
+static bool ParseInt(const std::string &strValue, int &n)
+{
+	std::istringstream value(strValue);
+	return (value >> n) && value.eof();
+}
+
+static bool ReadInt(std::istringstream &in, int &n)
+{
+	std::string strValue;
+	return (in >> strValue) && ParseInt(strValue, n);
+}
+
+// Reads one setting of a level; false with the problem in strError
+static bool ReadSetting(const std::string &strKey, std::istringstream &in, SSimLevel &level,
+	SSimEndless *pEndless, std::string &strError)
+{
+	if(strKey == "cars")
+	{
+		if(!ReadInt(in, level.nCars) || level.nCars <= 0)
+			strError = "cars: expected a number above 0";
+	}
+	else if(strKey == "speed")
+	{
+		if(!ReadInt(in, level.nVelocity) || level.nVelocity <= 0)
+			strError = "speed: expected a number above 0";
+	}
+	else if(strKey == "ramp")
+	{
+		if(!ReadInt(in, level.nRampStep) || !ReadInt(in, level.nRampEvery) || !ReadInt(in, level.nRampCount) ||
+			level.nRampStep < 0 || level.nRampEvery <= 0 || level.nRampCount < 0)
+			strError = "ramp: expected speed step, cars between steps (above 0) and step count";
+	}
+	else if(strKey == "mix")
+	{
+		for(int m = 0; m < ESC_COUNT && strError.empty(); m++)
+		{
+			if(!ReadInt(in, level.nMix[m]))
+				strError = "mix: expected a weight for car2, car6 and police";
+		}
+		if(strError.empty() && !CSimulation::CheckLevel(level))
+			strError = "mix: weights from 0 to 1000000, not all 0";
+	}
+	else if(strKey == "lanes")
+	{
+		std::vector<std::string> values;
+		std::string strValue;
+		while(in >> strValue)
+			values.push_back(strValue);
+
+		level.nLanes = (int)values.size();
+		for(int i = 0; i < level.nLanes && i < SIM_MAX_LANES && strError.empty(); i++)
+		{
+			if(!ParseInt(values[i], level.nLane[i]))
+				strError = "lanes: '" + values[i] + "' is not a number";
+		}
+		if(strError.empty() && (level.nLanes < 1 || level.nLanes > SIM_MAX_LANES))
+			strError = "lanes: expected 1 to 8 lane centres";
+	}
+	else if(strKey == "powerups")
+	{
+		std::vector<std::string> values;
+		std::string strValue;
+		while(in >> strValue)
+			values.push_back(strValue);
+
+		level.nPowerUpMask = 0;
+		if(values.size() == 1 && values[0] == "none")
+			return true;
+
+		if(values.size() < 3 || !ParseInt(values[0], level.nPowerUpNear) || !ParseInt(values[1], level.nPowerUpFar) ||
+			level.nPowerUpNear < 0 || level.nPowerUpFar <= level.nPowerUpNear)
+		{
+			strError = "powerups: expected near and far distance (far above near) and names, or none";
+			return false;
+		}
+
+		for(size_t v = 2; v < values.size(); v++)
+		{
+			int i = 0;
+			while(i < ESP_COUNT && values[v] != s_PowerUpNames[i])
+				i++;
+			if(i == ESP_COUNT)
+			{
+				strError = "powerups: unknown power-up '" + values[v] + "'";
+				return false;
+			}
+			level.nPowerUpMask |= 1 << i;
+		}
+	}
+	else if(pEndless && strKey == "grow")
+	{
+		if(!ReadInt(in, pEndless->nCarsGrowth) || !ReadInt(in, pEndless->nVelocityGrowth) ||
+			pEndless->nCarsGrowth < 0 || pEndless->nVelocityGrowth < 0)
+			strError = "grow: expected cars and speed added every level";
+	}
+	else if(pEndless && strKey == "limit")
+	{
+		if(!ReadInt(in, pEndless->nCarsLimit) || !ReadInt(in, pEndless->nVelocityLimit) ||
+			pEndless->nCarsLimit <= 0 || pEndless->nVelocityLimit <= 0)
+			strError = "limit: expected most cars and highest speed, above 0";
+	}
+	else
+	{
+		strError = "unknown setting '" + strKey + "'";
+		return false;
+	}
+
+	std::string strRest;
+	if(strError.empty() && (in >> strRest))
+		strError = strKey + ": too many values";
+
+	return strError.empty();
+}
+
+bool LevelFileLoad(const char *szFileName, SLevelFile &file, std::string &strError)
+{
+	std::ifstream in(szFileName);
+	if(!in)
+	{
+		strError = std::string(szFileName) + ": cannot be read";
+		return false;
+	}
+
+	std::vector<SSimLevel> builtIn;
+	CSimulation::DefaultLevels(builtIn);
+
+	file.levels.clear();
+	file.labels.clear();
+	file.endless.bEnabled = false;
+	file.endless.nCarsGrowth = file.endless.nVelocityGrowth = 0;
+	file.endless.nCarsLimit = file.endless.nVelocityLimit = INT_MAX;
+	file.strEndlessLabel.clear();
+
+	SSimLevel *pLevel = NULL;
+	std::string *pLabel = NULL;
+	std::string strLine;
+	int nLine = 0;
+
+	while(std::getline(in, strLine))
+	{
+		nLine++;
+		strLine = strLine.substr(0, strLine.find('#'));
+
+		std::istringstream line(strLine);
+		std::string strKey;
+		if(!(line >> strKey))
+			continue;
+
+		std::ostringstream where;
+		where << szFileName << ":" << nLine << ": ";
+
+		if(strKey == "level" || strKey == "endless")
+		{
+			std::string strRest;
+			if(line >> strRest)
+			{
+				strError = where.str() + strKey + " takes no values";
+				return false;
+			}
+			if(file.endless.bEnabled)
+			{
+				strError = where.str() + "the endless levels come after the listed ones";
+				return false;
+			}
+
+			// A copy of the one before
+			SSimLevel level = file.levels.empty() ? builtIn[0] : file.levels.back();
+
+			if(strKey == "level")
+			{
+				file.levels.push_back(level);
+				file.labels.push_back(std::string());
+				pLevel = &file.levels.back();
+				pLabel = &file.labels.back();
+			}
+			else
+			{
+				file.endless.bEnabled = true;
+				file.endless.base = level;
+				pLevel = &file.endless.base;
+				pLabel = &file.strEndlessLabel;
+			}
+		}
+		else if(!pLevel)
+		{
+			strError = where.str() + "expected level or endless first";
+			return false;
+		}
+		else if(strKey == "label")
+		{
+			std::string strRest;
+			if(!(line >> *pLabel) || (line >> strRest))
+			{
+				strError = where.str() + "label: expected one bitmap";
+				return false;
+			}
+		}
+		else if(!ReadSetting(strKey, line, *pLevel, file.endless.bEnabled ? &file.endless : NULL, strError))
+		{
+			strError = where.str() + strError;
+			return false;
+		}
+	}
+
+	if(file.levels.empty() && !file.endless.bEnabled)
+	{
+		strError = std::string(szFileName) + ": no levels";
+		return false;
+	}
+
+	return true;
+}
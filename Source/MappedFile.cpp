@@ -0,0 +1,117 @@
+// MappedFile.cpp
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::CMappedFile()
+{
+	m_pData = NULL;
+	m_uSize = 0;
+#ifdef _WIN32
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = NULL;
+#endif
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool CMappedFile::Open(const char *szFileName)
+{
+	Close();
+
+	m_hFile = CreateFile(szFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(m_hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(m_hFile, &size) || size.QuadPart == 0 || (unsigned long long)size.QuadPart > (size_t)-1)
+	{
+		Close();
+		return false;
+	}
+
+	// PAGE_WRITECOPY + FILE_MAP_COPY: writable view, writes stay private
+	m_hMapping = CreateFileMapping(m_hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if(!m_hMapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = (BYTE*)MapViewOfFile(m_hMapping, FILE_MAP_COPY, 0, 0, 0);
+	if(!m_pData)
+	{
+		Close();
+		return false;
+	}
+
+	m_uSize = (size_t)size.QuadPart;
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if(m_pData)
+		UnmapViewOfFile(m_pData);
+
+	if(m_hMapping)
+		CloseHandle(m_hMapping);
+
+	if(m_hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(m_hFile);
+
+	m_pData = NULL;
+	m_uSize = 0;
+	m_hMapping = NULL;
+	m_hFile = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool CMappedFile::Open(const char *szFileName)
+{
+	Close();
+
+	int fd = open(szFileName, O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// MAP_PRIVATE gives the same copy-on-write semantics as FILE_MAP_COPY
+	void *p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(p == MAP_FAILED)
+		return false;
+
+	m_pData = (BYTE*)p;
+	m_uSize = (size_t)st.st_size;
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if(m_pData)
+		munmap(m_pData, m_uSize);
+
+	m_pData = NULL;
+	m_uSize = 0;
+}
+
+#endif
@@ -17,6 +17,7 @@ MenuSprite::MenuSprite(const Vec2 position, const BackBuffer* BF)
 	this->BF = BF;
 	frameCounter = 0;
 
+	// The start menu has the infinite road second, the pause menu saving third
 	auto posLoad = Vec2(position.x, position.y + 125);
 	auto posSave = Vec2(position.x, position.y + 250);
 	auto posExit = Vec2(position.x, position.y + 375);
@@ -31,10 +32,20 @@ MenuSprite::MenuSprite(const Vec2 position, const BackBuffer* BF)
 	startText->mVelocity = Vec2(0, 0);
 	startText->setBackBuffer(BF);
 	
-	loadText = new Sprite("data/loadgame_text.bmp", RGB(0xff, 0x00, 0xff));
-	loadText->mPosition = posLoad;
-	loadText->mVelocity = Vec2(0, 0);
-	loadText->setBackBuffer(BF);
+	infiniteText = new Sprite("data/infiniteroad_text.bmp", RGB(0xff, 0x00, 0xff));
+	infiniteText->mPosition = posLoad;
+	infiniteText->mVelocity = Vec2(0, 0);
+	infiniteText->setBackBuffer(BF);
+
+	loadText1 = new Sprite("data/loadgame_text.bmp", RGB(0xff, 0x00, 0xff));
+	loadText1->mPosition = posSave;
+	loadText1->mVelocity = Vec2(0, 0);
+	loadText1->setBackBuffer(BF);
+
+	loadText2 = new Sprite("data/loadgame_text.bmp", RGB(0xff, 0x00, 0xff));
+	loadText2->mPosition = posLoad;
+	loadText2->mVelocity = Vec2(0, 0);
+	loadText2->setBackBuffer(BF);
 	
 	saveText = new Sprite("data/savegame_text.bmp", RGB(0xff, 0x00, 0xff));
 	saveText->mPosition = posSave;
@@ -42,7 +53,7 @@ MenuSprite::MenuSprite(const Vec2 position, const BackBuffer* BF)
 	saveText->setBackBuffer(BF);
 
 	exitText1 = new Sprite("data/exit_text.bmp", RGB(0xff, 0x00, 0xff));
-	exitText1->mPosition = posSave;
+	exitText1->mPosition = posExit;
 	exitText1->mVelocity = Vec2(0, 0);
 	exitText1->setBackBuffer(BF);
 
@@ -62,7 +73,9 @@ MenuSprite::MenuSprite(const Vec2 position, const BackBuffer* BF)
 MenuSprite::~MenuSprite()
 {
 	delete startText;
-	delete loadText;
+	delete infiniteText;
+	delete loadText1;
+	delete loadText2;
 	delete saveText;
 	delete exitText1;
 	delete exitText2;
@@ -75,13 +88,26 @@ MenuSprite::~MenuSprite()
 //-----------------------------------------------------------------------------
 void MenuSprite::draw(ULONG gameState)
 {
+	std::vector<Sprite*> sprites;
+
 	frameCounter++;
 
+	getSprites(gameState, sprites);
+	for (auto spr : sprites) spr->draw();
+}
+
+//-----------------------------------------------------------------------------
+// Name : getSprites () (Public)
+// Desc : Appends the option sprites shown in a game state, in drawing order.
+//-----------------------------------------------------------------------------
+void MenuSprite::getSprites(ULONG gameState, std::vector<Sprite*> &sprites)
+{
 	switch (gameState) {
 	case 0: // start menu
-		startText->draw();
-		loadText->draw();
-		exitText1->draw();
+		sprites.push_back(startText);
+		sprites.push_back(infiniteText);
+		sprites.push_back(loadText1);
+		sprites.push_back(exitText1);
 		break;
 
 	case 1: // ongoing game.
@@ -94,10 +120,10 @@ void MenuSprite::draw(ULONG gameState)
 		break;
 
 	case 4: // paused game
-		resumeText->draw();
-		loadText->draw();
-		saveText->draw();
-		exitText2->draw();
+		sprites.push_back(resumeText);
+		sprites.push_back(loadText2);
+		sprites.push_back(saveText);
+		sprites.push_back(exitText2);
 	}
 }
 
@@ -114,10 +140,14 @@ void MenuSprite::opUp(ULONG gameState)
 		select = CHOICE::EXIT;
 		break;
 
-	case CHOICE::LOAD:
+	case CHOICE::INFINITE:
 		select = CHOICE::START;
 		break;
 
+	case CHOICE::LOAD:
+		select = (gameState == 0) ? CHOICE::INFINITE : CHOICE::START;
+		break;
+
 	case CHOICE::SAVE:
 		select = CHOICE::LOAD;
 		break;
@@ -140,6 +170,10 @@ void MenuSprite::opDown(ULONG gameState)
 
 	switch (select) {
 	case CHOICE::START:
+		select = (gameState == 0) ? CHOICE::INFINITE : CHOICE::LOAD;
+		break;
+
+	case CHOICE::INFINITE:
 		select = CHOICE::LOAD;
 		break;
 
@@ -171,7 +205,7 @@ void MenuSprite::updateSelect(CHOICE text, bool sel)
 	case CHOICE::START:
 		oldPos = startText->mPosition;
 		delete startText;
-		startText = (sel) ? new Sprite("data/newgameselected_text.bmp", RGB(0xff, 0x00, 0xff)) :
+		startText = (sel) ? new Sprite("data/newgameselected_text.bmp", RGB(0xff, 0x00, 0xff), ELM_MAPPED) :
 			new Sprite("data/newgame_text.bmp", RGB(0xff, 0x00, 0xff));
 		startText->mPosition = oldPos;
 		startText->mVelocity = Vec2(0, 0);
@@ -179,27 +213,45 @@ void MenuSprite::updateSelect(CHOICE text, bool sel)
 
 		oldPos = resumeText->mPosition;
 		delete resumeText;
-		resumeText = (sel) ? new Sprite("data/resumeselected_text.bmp", RGB(0xff, 0x00, 0xff)) :
+		resumeText = (sel) ? new Sprite("data/resumeselected_text.bmp", RGB(0xff, 0x00, 0xff), ELM_MAPPED) :
 			new Sprite("data/resume_text.bmp", RGB(0xff, 0x00, 0xff));
 		resumeText->mPosition = oldPos;
 		resumeText->mVelocity = Vec2(0, 0);
 		resumeText->setBackBuffer(BF);
 		break;
 
+	case CHOICE::INFINITE:
+		oldPos = infiniteText->mPosition;
+		delete infiniteText;
+		infiniteText = (sel) ? new Sprite("data/infiniteroadselected_text.bmp", RGB(0xff, 0x00, 0xff), ELM_MAPPED) :
+			new Sprite("data/infiniteroad_text.bmp", RGB(0xff, 0x00, 0xff));
+		infiniteText->mPosition = oldPos;
+		infiniteText->mVelocity = Vec2(0, 0);
+		infiniteText->setBackBuffer(BF);
+		break;
+
 	case CHOICE::LOAD:
-		oldPos = loadText->mPosition;
-		delete loadText;
-		loadText = (sel) ? new Sprite("data/loadgameselected_text.bmp", RGB(0xff, 0x00, 0xff)) :
+		oldPos = loadText2->mPosition;
+		delete loadText2;
+		loadText2 = (sel) ? new Sprite("data/loadgameselected_text.bmp", RGB(0xff, 0x00, 0xff), ELM_MAPPED) :
+			new Sprite("data/loadgame_text.bmp", RGB(0xff, 0x00, 0xff));
+		loadText2->mPosition = oldPos;
+		loadText2->mVelocity = Vec2(0, 0);
+		loadText2->setBackBuffer(BF);
+
+		oldPos = loadText1->mPosition;
+		delete loadText1;
+		loadText1 = (sel) ? new Sprite("data/loadgameselected_text.bmp", RGB(0xff, 0x00, 0xff), ELM_MAPPED) :
 			new Sprite("data/loadgame_text.bmp", RGB(0xff, 0x00, 0xff));
-		loadText->mPosition = oldPos;
-		loadText->mVelocity = Vec2(0, 0);
-		loadText->setBackBuffer(BF);
+		loadText1->mPosition = oldPos;
+		loadText1->mVelocity = Vec2(0, 0);
+		loadText1->setBackBuffer(BF);
 		break;
 
 	case CHOICE::EXIT:
 		oldPos = exitText2->mPosition;
 		delete exitText2;
-		exitText2 = (sel) ? new Sprite("data/exitselected_text.bmp", RGB(0xff, 0x00, 0xff)) :
+		exitText2 = (sel) ? new Sprite("data/exitselected_text.bmp", RGB(0xff, 0x00, 0xff), ELM_MAPPED) :
 			new Sprite("data/exit_text.bmp", RGB(0xff, 0x00, 0xff));
 		exitText2->mPosition = oldPos;
 		exitText2->mVelocity = Vec2(0, 0);
@@ -207,7 +259,7 @@ void MenuSprite::updateSelect(CHOICE text, bool sel)
 
 		oldPos = exitText1->mPosition;
 		delete exitText1;
-		exitText1 = (sel) ? new Sprite("data/exitselected_text.bmp", RGB(0xff, 0x00, 0xff)) :
+		exitText1 = (sel) ? new Sprite("data/exitselected_text.bmp", RGB(0xff, 0x00, 0xff), ELM_MAPPED) :
 			new Sprite("data/exit_text.bmp", RGB(0xff, 0x00, 0xff));
 		exitText1->mPosition = oldPos;
 		exitText1->mVelocity = Vec2(0, 0);
@@ -217,7 +269,7 @@ void MenuSprite::updateSelect(CHOICE text, bool sel)
 	case CHOICE::SAVE:
 		oldPos = saveText->mPosition;
 		delete saveText;
-		saveText = (sel) ? new Sprite("data/savegameselected_text.bmp", RGB(0xff, 0x00, 0xff)) :
+		saveText = (sel) ? new Sprite("data/savegameselected_text.bmp", RGB(0xff, 0x00, 0xff), ELM_MAPPED) :
 			new Sprite("data/savegame_text.bmp", RGB(0xff, 0x00, 0xff));
 		saveText->mPosition = oldPos;
 		saveText->mVelocity = Vec2(0, 0);
@@ -233,4 +285,15 @@ void MenuSprite::updateSelect(CHOICE text, bool sel)
 MenuSprite::CHOICE MenuSprite::getChoice()
 {
 	return select;
+}
+
+//-----------------------------------------------------------------------------
+// Name : reset () (Public)
+// Desc : Selects the first option again, the pause menu has no infinite road.
+//-----------------------------------------------------------------------------
+void MenuSprite::reset()
+{
+	updateSelect(select, false);
+	select = START;
+	updateSelect(select, true);
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+// RenderLayer.cpp
+#include "RenderLayer.h"
+
+RenderLayer::RenderLayer(HWND hWnd, int width, int height)
+	: mSurface(hWnd, width, height)
+{
+	// Whatever no sprite covers is left out of the encoded image.
+	mSurface.setClearColor(SPRITE_COLOR_KEY);
+	mSurface.invalidateAll();
+
+	SetRect(&mrcBounds, 0, 0, 0, 0);
+	mVersion = 0;
+}
+
+RenderLayer::~RenderLayer()
+{
+}
+
+void RenderLayer::queue(Sprite *pSprite)
+{
+	SQueued item;
+	HBITMAP hImage;
+	POINT ptSource;
+
+	pSprite->getDrawState(item.rcBounds, hImage, ptSource);
+	item.pSprite = pSprite;
+
+	mSurface.track(pSprite, item.rcBounds, hImage, ptSource);
+	mQueued.push_back(item);
+}
+
+bool RenderLayer::update()
+{
+	mSurface.endTracking();
+
+	if(!mSurface.isDirty())
+	{
+		mQueued.clear();
+		return false;
+	}
+
+	// Redraw the changed parts only, the rest of the surface still holds
+	// the previous render.
+	mSurface.reset();
+	for(size_t i = 0; i < mQueued.size(); i++)
+	{
+		if(mSurface.isVisible(mQueued[i].rcBounds))
+			mQueued[i].pSprite->draw();
+	}
+
+	mSurface.validate();
+	mQueued.clear();
+
+	// Let GDI finish before reading the pixels back.
+	GdiFlush();
+	mImage.Build(mSurface.getFramebuffer());
+	if(!mImage.GetOpaqueBounds(mrcBounds))
+		SetRect(&mrcBounds, 0, 0, 0, 0);
+
+	mVersion++;
+	return true;
+}
+
+void RenderLayer::composite(BackBuffer &target) const
+{
+	CFramebuffer &fb = target.getFramebuffer();
+	const std::vector<RECT> &dirty = target.getDirtyRects();
+
+	// The target may have pending GDI drawing under the layer.
+	GdiFlush();
+
+	for(size_t i = 0; i < dirty.size(); i++)
+	{
+		fb.SetClipRect(dirty[i]);
+		fb.DrawSprite(mImage, 0, 0);
+	}
+
+	fb.ResetClipRect();
+}
@@ -1,4 +1,14 @@
 #include "ResizeEngine.h"
+#include "ResizeKernels.h"
+#include <vector>
+#include <map>
+#include <mutex>
+
+// Rounds a block offset up to a cache line
+static inline size_t AlignBlock(size_t uOffset)
+{
+	return (uOffset + 63) & ~(size_t)63;
+}
 
 CWeightsTable::CWeightsTable(CGenericFilter *pFilter, DWORD uDstSize, DWORD uSrcSize) 
 {
@@ -22,17 +32,25 @@ CWeightsTable::CWeightsTable(CGenericFilter *pFilter, DWORD uDstSize, DWORD uSrc
 		dWidth= dFilterWidth;
 	}
 
-	// allocate a new line contributions structure
-	// window size is the number of sampled pixels
+	// window size is the number of sampled pixels, the stride pads it to
+	// whole SIMD registers so every pixel's weights start aligned
 	m_WindowSize = 2 * (int)ceil(dWidth) + 1;
+	m_Stride = (m_WindowSize + 7) & ~7;
 	m_LineLength = uDstSize;
-	// allocate list of contributions
-	m_WeightTable = new sContribution[m_LineLength];
-	for(u = 0 ; u < m_LineLength ; u++) 
-	{
-		// allocate contributions for every pixel
-		m_WeightTable[u].Weights = new double[m_WindowSize];
-	}
+
+	// carve bounds, double weights and fixed weights out of one block
+	size_t uBoundsSize = AlignBlock(sizeof(int) * 2 * m_LineLength);
+	size_t uWeightsSize = AlignBlock(sizeof(double) * m_Stride * m_LineLength);
+	size_t uFixedSize = AlignBlock(sizeof(short) * m_Stride * m_LineLength);
+
+	m_pBlock = (BYTE*)_aligned_malloc(uBoundsSize + uWeightsSize + uFixedSize, 64);
+	ZeroMemory(m_pBlock, uBoundsSize + uWeightsSize + uFixedSize);
+	m_pBounds = (int*)m_pBlock;
+	m_pWeights = (double*)(m_pBlock + uBoundsSize);
+	m_pFixedWeights = (short*)(m_pBlock + uBoundsSize + uWeightsSize);
+
+	// normalized weights of the current pixel
+	double *pRow = new double[m_WindowSize];
 
 	for(u = 0; u < m_LineLength; u++) 
 	{
@@ -55,43 +73,120 @@ CWeightsTable::CWeightsTable(CGenericFilter *pFilter, DWORD uDstSize, DWORD uSrc
 			}
 		}
 
-		m_WeightTable[u].Left = iLeft;
-		m_WeightTable[u].Right = iRight;
+		m_pBounds[u * 2] = iLeft;
+		m_pBounds[u * 2 + 1] = iRight;
 
 		int iSrc = 0;
+		int iTaps = iRight - iLeft + 1;
 		double dTotalWeight = 0;  // zero sum of weights
-		for(iSrc = iLeft; iSrc <= iRight; iSrc++) 
+		for(iSrc = 0; iSrc < iTaps; iSrc++) 
 		{
 			// calculate weights
-			double weight = dFScale * pFilter->Filter(dFScale * (dCenter - (double)iSrc));
-			m_WeightTable[u].Weights[iSrc-iLeft] = weight;
+			double weight = dFScale * pFilter->Filter(dFScale * (dCenter - (double)(iLeft + iSrc)));
+			pRow[iSrc] = weight;
 			dTotalWeight += weight;
 		}
 
 		if(dTotalWeight > 0) 
 		{
 			// normalize weight of neighbouring points
-			for(iSrc = iLeft; iSrc <= iRight; iSrc++)
+			for(iSrc = 0; iSrc < iTaps; iSrc++)
 			{
 				// normalize point
-				m_WeightTable[u].Weights[iSrc-iLeft] /= dTotalWeight;
+				pRow[iSrc] /= dTotalWeight;
 			}
 		}
+
+		// quantize to fixed-point, then push the rounding error into the
+		// dominant tap so every row of fixed weights sums to exactly 1.0
+		double *pWeights = &m_pWeights[u * m_Stride];
+		short *pFixed = &m_pFixedWeights[u * m_Stride];
+		int iFixedTotal = 0;
+		int iDominant = 0;
+		for(iSrc = 0; iSrc < iTaps; iSrc++) 
+		{
+			pWeights[iSrc] = pRow[iSrc];
+			pFixed[iSrc] = (short)floor(pRow[iSrc] * RESIZE_FIXED_ONE + 0.5);
+			iFixedTotal += pFixed[iSrc];
+
+			if(fabs(pRow[iSrc]) > fabs(pRow[iDominant]))
+				iDominant = iSrc;
+		}
+
+		if(dTotalWeight > 0)
+			pFixed[iDominant] += (short)(RESIZE_FIXED_ONE - iFixedTotal);
 	}
+
+	delete []pRow;
 }
 
 CWeightsTable::~CWeightsTable() 
 {
-		for(DWORD u = 0; u < m_LineLength; u++) 
+		// free the whole table at once
+		_aligned_free(m_pBlock);
+}
+
+//-----------------------------------------------------------------------------
+// Weights table cache
+//-----------------------------------------------------------------------------
+namespace
+{
+	struct SWeightsKey
+	{
+		int iType;
+		double dWidth, dParam0, dParam1;
+		DWORD uDstSize, uSrcSize;
+
+		bool operator<(const SWeightsKey &rhs) const
 		{
-				// free contributions for every pixel
-				delete []m_WeightTable[u].Weights;
+			if(iType != rhs.iType) return iType < rhs.iType;
+			if(dWidth != rhs.dWidth) return dWidth < rhs.dWidth;
+			if(dParam0 != rhs.dParam0) return dParam0 < rhs.dParam0;
+			if(dParam1 != rhs.dParam1) return dParam1 < rhs.dParam1;
+			if(uDstSize != rhs.uDstSize) return uDstSize < rhs.uDstSize;
+			return uSrcSize < rhs.uSrcSize;
 		}
+	};
+
+	// Upper bound on cached tables, the cache is simply emptied when reached
+	const size_t MAX_CACHED_TABLES = 128;
+
+	std::mutex g_WeightsCacheLock;
+	std::map<SWeightsKey, std::shared_ptr<const CWeightsTable> > g_WeightsCache;
+}
+
+std::shared_ptr<const CWeightsTable> CWeightsTable::Acquire(CGenericFilter *pFilter, DWORD uDstSize, DWORD uSrcSize)
+{
+	SWeightsKey key;
+	key.iType = pFilter->GetType();
+	key.dWidth = pFilter->GetWidth();
+	pFilter->GetParams(key.dParam0, key.dParam1);
+	key.uDstSize = uDstSize;
+	key.uSrcSize = uSrcSize;
+
+	{
+		std::lock_guard<std::mutex> lock(g_WeightsCacheLock);
+		auto it = g_WeightsCache.find(key);
+		if(it != g_WeightsCache.end())
+			return it->second;
+	}
+
+	// build outside the lock, a racing thread may build the same table
+	// in which case the first one stored wins
+	std::shared_ptr<const CWeightsTable> pTable(new CWeightsTable(pFilter, uDstSize, uSrcSize));
 
-		// free list of pixels contributions
-		delete []m_WeightTable;
+	std::lock_guard<std::mutex> lock(g_WeightsCacheLock);
+	if(g_WeightsCache.size() >= MAX_CACHED_TABLES)
+		g_WeightsCache.clear();
+
+	return g_WeightsCache.insert(std::make_pair(key, pTable)).first->second;
 }
 
+void CWeightsTable::FlushCache()
+{
+	std::lock_guard<std::mutex> lock(g_WeightsCacheLock);
+	g_WeightsCache.clear();
+}
 
 void CResizableImage::ScaleRow(unsigned int dst_width, unsigned int /*dst_height*/, unsigned int row)
 {
@@ -122,6 +217,25 @@ void CResizableImage::ScaleRow(unsigned int dst_width, unsigned int /*dst_height
 	}
 }
 
+void CResizableImage::SetWorkerCount(unsigned int uWorkers)
+{
+	if (uWorkers == 0)
+		uWorkers = CThreadPool::HardwareWorkers();
+
+	if (uWorkers <= 1)
+		m_pPool.reset();
+	else if (!m_pPool || m_pPool->GetWorkerCount() != uWorkers)
+		m_pPool.reset(new CThreadPool(uWorkers));
+}
+
+void CResizableImage::ForEachBand(unsigned int uCount, unsigned int uGrain, const CThreadPool::BAND_FUNC &fnBand)
+{
+	if (m_pPool)
+		m_pPool->ParallelFor(0, uCount, uGrain, fnBand);
+	else
+		fnBand(0, uCount);
+}
+
 void CResizableImage::HorizontalFilter(unsigned int dst_width, unsigned int dst_height)
 {
 
@@ -129,17 +243,38 @@ void CResizableImage::HorizontalFilter(unsigned int dst_width, unsigned int dst_
 	{
 		// No scaling required, just copy
 		memcpy (m_pResImg, m_pRGB, sizeof(RGBQUAD) * width * height);
+		return;
 	}
 	
-	m_pWeights = new CWeightsTable(m_pFilter, dst_width, width);
+	m_pWeights = CWeightsTable::Acquire(m_pFilter, dst_width, width);
 
-	for (UINT u = 0; u < dst_height; u++)
+	if (m_eMode == ERM_FIXEDPOINT)
+	{
+		// vectorized kernel, picked once for this CPU
+		HORIZONTAL_KERNEL pfnKernel = GetHorizontalKernel();
+		const CWeightsTable *pWeights = m_pWeights.get();
+		ForEachBand(dst_height, 8, [&](UINT uBegin, UINT uEnd)
+		{
+			// rows are independent, each band filters its own
+			for (UINT u = uBegin; u < uEnd; u++)
+			{
+				pfnKernel(&m_pRGB[u * width], &m_pResImg[u * dst_width], dst_width, pWeights);
+			}
+		});
+	}
+	else
 	{
-		// scale each row
-		ScaleRow (dst_width, dst_width, u);	// Scale each row 
+		ForEachBand(dst_height, 8, [&](UINT uBegin, UINT uEnd)
+		{
+			for (UINT u = uBegin; u < uEnd; u++)
+			{
+				// scale each row
+				ScaleRow (dst_width, dst_width, u);	// Scale each row 
+			}
+		});
 	}
 
-	delete m_pWeights;
+	m_pWeights.reset();
 }
 
 void CResizableImage::ScaleCol(unsigned int dst_width, unsigned int dst_height, unsigned int col)
@@ -177,21 +312,54 @@ void CResizableImage::VerticalFilter(unsigned int dst_width, unsigned int dst_he
 	{
 		// No scaling required, just copy
 		memcpy(m_pResImg, m_pRGB, sizeof (RGBQUAD) * width * height);
+		return;
 	}
 	
-	m_pWeights = new CWeightsTable(m_pFilter, dst_height, height);
+	m_pWeights = CWeightsTable::Acquire(m_pFilter, dst_height, height);
+
+	if (m_eMode == ERM_FIXEDPOINT)
+	{
+		// Produce whole output rows at once: every tap reads a contiguous
+		// source row instead of striding down a column
+		VERTICAL_KERNEL pfnKernel = GetVerticalKernel();
+		const CWeightsTable *pWeights = m_pWeights.get();
+		ForEachBand(dst_height, 8, [&](UINT uBegin, UINT uEnd)
+		{
+			// each band owns a run of destination rows and its own row list
+			std::vector<const RGBQUAD*> rows(pWeights->getWindowSize());
+			for (UINT y = uBegin; y < uEnd; y++)
+			{
+				int iLeft = pWeights->getLeftBoundary(y);
+				int iTaps = pWeights->getRightBoundary(y) - iLeft + 1;
+				for (int i = 0; i < iTaps; i++)
+				{
+					rows[i] = &m_pRGB[(iLeft + i) * width];
+				}
 
-	for (UINT u = 0; u < dst_width; u++)
+				pfnKernel(&rows[0], pWeights->getFixedWeights(y), iTaps, &m_pResImg[y * dst_width], dst_width);
+			}
+		});
+	}
+	else
 	{
-		// Step through columns
-		ScaleCol(dst_width, dst_height, u);   // Scale each column
+		ForEachBand(dst_width, 16, [&](UINT uBegin, UINT uEnd)
+		{
+			for (UINT u = uBegin; u < uEnd; u++)
+			{
+				// Step through columns
+				ScaleCol(dst_width, dst_height, u);   // Scale each column
+			}
+		});
 	}
 
-	delete m_pWeights;
+	m_pWeights.reset();
 }
 
 void CResizableImage::Resample(unsigned dst_width, unsigned dst_height)
 {
+	if(!EnsureDecoded())
+		return;
+
 	// decide which filtering order (xy or yx) is faster for this mapping
 	if(dst_width * height <= dst_height * width) 
 	{
@@ -199,8 +367,7 @@ void CResizableImage::Resample(unsigned dst_width, unsigned dst_height)
 
 		HorizontalFilter(dst_width, height);
 		
-		delete m_pRGB;
-		m_pRGB = m_pResImg;
+		AdoptPixels(m_pResImg);
 		width = dst_width;
 		m_pResImg = new RGBQUAD[dst_width * dst_height];
 
@@ -211,16 +378,14 @@ void CResizableImage::Resample(unsigned dst_width, unsigned dst_height)
 		m_pResImg = new RGBQUAD[width * dst_height];
 		VerticalFilter(width, dst_height);
 		
-		delete m_pRGB;
-		m_pRGB = m_pResImg;
+		AdoptPixels(m_pResImg);
 		height = dst_height;
 		m_pResImg = new RGBQUAD[dst_width * dst_height];
 
 		HorizontalFilter(dst_width, dst_height);
 	}
 
-	delete m_pRGB;
-	m_pRGB = m_pResImg;
+	AdoptPixels(m_pResImg);
 	width = dst_width;
 	height = dst_height;
 
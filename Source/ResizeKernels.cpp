@@ -0,0 +1,388 @@
+// ResizeKernels.cpp
+// Fixed-point horizontal / vertical filter kernels.
+//
+// All variants compute exactly the same integer sums, so the output does
+// not depend on which kernel the dispatcher picked.
+#include "ResizeKernels.h"
+#include "ResizeEngine.h"
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define RESIZE_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RESIZE_TARGET_AVX2
+#else
+#define RESIZE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// 32 bits of pixel or weight storage as an int. memcpy keeps the access
+// legal for any type and alignment and compiles to a single move.
+static inline int LoadInt(const void *p)
+{
+	int i;
+	memcpy(&i, p, sizeof(i));
+	return i;
+}
+
+static inline void StoreInt(void *p, int i)
+{
+	memcpy(p, &i, sizeof(i));
+}
+
+// Round a fixed-point accumulator back to a channel value
+static inline BYTE FixedToByte(int iAcc)
+{
+	iAcc = (iAcc + RESIZE_FIXED_HALF) >> RESIZE_FIXED_BITS;
+	if(iAcc < 0)
+		return 0;
+	if(iAcc > 255)
+		return 255;
+	return (BYTE)iAcc;
+}
+
+//-----------------------------------------------------------------------------
+// Scalar kernels
+//-----------------------------------------------------------------------------
+static void HorizontalScalar(const RGBQUAD *pSrc, RGBQUAD *pDst, unsigned int dst_width, const CWeightsTable *pWeights)
+{
+	for(UINT x = 0; x < dst_width; x++)
+	{
+		int r = 0, g = 0, b = 0, a = 0;
+		int iLeft = pWeights->getLeftBoundary(x);
+		int iTaps = pWeights->getRightBoundary(x) - iLeft + 1;
+		const short *pW = pWeights->getFixedWeights(x);
+		const RGBQUAD *p = pSrc + iLeft;
+
+		for(int i = 0; i < iTaps; i++)
+		{
+			int w = pW[i];
+			b += w * p[i].rgbBlue;
+			g += w * p[i].rgbGreen;
+			r += w * p[i].rgbRed;
+			a += w * p[i].rgbReserved;
+		}
+
+		pDst[x].rgbBlue = FixedToByte(b);
+		pDst[x].rgbGreen = FixedToByte(g);
+		pDst[x].rgbRed = FixedToByte(r);
+		pDst[x].rgbReserved = FixedToByte(a);
+	}
+}
+
+static void VerticalScalarRange(const RGBQUAD * const *ppSrcRows, const short *pWeights, int iTaps, RGBQUAD *pDst, unsigned int uStart, unsigned int uEnd)
+{
+	for(UINT x = uStart; x < uEnd; x++)
+	{
+		int r = 0, g = 0, b = 0, a = 0;
+		for(int i = 0; i < iTaps; i++)
+		{
+			int w = pWeights[i];
+			const RGBQUAD &src = ppSrcRows[i][x];
+			b += w * src.rgbBlue;
+			g += w * src.rgbGreen;
+			r += w * src.rgbRed;
+			a += w * src.rgbReserved;
+		}
+
+		pDst[x].rgbBlue = FixedToByte(b);
+		pDst[x].rgbGreen = FixedToByte(g);
+		pDst[x].rgbRed = FixedToByte(r);
+		pDst[x].rgbReserved = FixedToByte(a);
+	}
+}
+
+static void VerticalScalar(const RGBQUAD * const *ppSrcRows, const short *pWeights, int iTaps, RGBQUAD *pDst, unsigned int uWidth)
+{
+	VerticalScalarRange(ppSrcRows, pWeights, iTaps, pDst, 0, uWidth);
+}
+
+#ifdef RESIZE_X86
+// Two 16-bit weights packed the way _mm_madd_epi16 consumes them
+static inline int PackWeights(short w0, short w1)
+{
+	return (int)(unsigned short)w0 | ((int)w1 << 16);
+}
+
+//-----------------------------------------------------------------------------
+// SSE2 kernels
+//
+// Pixels are widened to 16 bits and interleaved tap by tap
+// (b0 b1 g0 g1 r0 r1 a0 a1) so that a single _mm_madd_epi16 applies two
+// taps to all four channels at once.
+//-----------------------------------------------------------------------------
+
+// Applies iTaps taps starting at p, returns b,g,r,a sums in 32-bit lanes
+static inline __m128i HorizontalTapsSSE2(const RGBQUAD *p, const short *pW, int iTaps, __m128i acc)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int i = 0;
+
+	for(; i + 1 < iTaps; i += 2)
+	{
+		__m128i px = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + i)), zero);
+		px = _mm_unpacklo_epi16(px, _mm_unpackhi_epi64(px, px));
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(px, _mm_set1_epi32(LoadInt(pW + i))));
+	}
+
+	if(i < iTaps)
+	{
+		__m128i px = _mm_unpacklo_epi8(_mm_cvtsi32_si128(LoadInt(p + i)), zero);
+		px = _mm_unpacklo_epi16(px, zero);
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(px, _mm_set1_epi32(PackWeights(pW[i], 0))));
+	}
+
+	return acc;
+}
+
+// Rounds, shifts and saturates four 32-bit channel sums into one pixel
+static inline int StorePixelSSE2(__m128i acc)
+{
+	acc = _mm_srai_epi32(_mm_add_epi32(acc, _mm_set1_epi32(RESIZE_FIXED_HALF)), RESIZE_FIXED_BITS);
+	acc = _mm_packs_epi32(acc, acc);
+	return _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+}
+
+static void HorizontalSSE2(const RGBQUAD *pSrc, RGBQUAD *pDst, unsigned int dst_width, const CWeightsTable *pWeights)
+{
+	for(UINT x = 0; x < dst_width; x++)
+	{
+		int iLeft = pWeights->getLeftBoundary(x);
+		int iTaps = pWeights->getRightBoundary(x) - iLeft + 1;
+
+		__m128i acc = HorizontalTapsSSE2(pSrc + iLeft, pWeights->getFixedWeights(x), iTaps, _mm_setzero_si128());
+		StoreInt(pDst + x, StorePixelSSE2(acc));
+	}
+}
+
+// Finalizes four pixels worth of sums into 16 bytes
+static inline __m128i PackPixelsSSE2(__m128i acc0, __m128i acc1, __m128i acc2, __m128i acc3)
+{
+	const __m128i half = _mm_set1_epi32(RESIZE_FIXED_HALF);
+	acc0 = _mm_srai_epi32(_mm_add_epi32(acc0, half), RESIZE_FIXED_BITS);
+	acc1 = _mm_srai_epi32(_mm_add_epi32(acc1, half), RESIZE_FIXED_BITS);
+	acc2 = _mm_srai_epi32(_mm_add_epi32(acc2, half), RESIZE_FIXED_BITS);
+	acc3 = _mm_srai_epi32(_mm_add_epi32(acc3, half), RESIZE_FIXED_BITS);
+	return _mm_packus_epi16(_mm_packs_epi32(acc0, acc1), _mm_packs_epi32(acc2, acc3));
+}
+
+static void VerticalSSE2Range(const RGBQUAD * const *ppSrcRows, const short *pWeights, int iTaps, RGBQUAD *pDst, unsigned int uStart, unsigned int uEnd)
+{
+	const __m128i zero = _mm_setzero_si128();
+	UINT x = uStart;
+
+	// four pixels of a whole output row per step, all taps kept in registers
+	for(; x + 4 <= uEnd; x += 4)
+	{
+		__m128i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+
+		for(int i = 0; i < iTaps; i += 2)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(ppSrcRows[i] + x));
+			__m128i b = zero;
+			__m128i w;
+			if(i + 1 < iTaps)
+			{
+				b = _mm_loadu_si128((const __m128i*)(ppSrcRows[i + 1] + x));
+				w = _mm_set1_epi32(PackWeights(pWeights[i], pWeights[i + 1]));
+			}
+			else
+			{
+				w = _mm_set1_epi32(PackWeights(pWeights[i], 0));
+			}
+
+			__m128i aLo = _mm_unpacklo_epi8(a, zero), aHi = _mm_unpackhi_epi8(a, zero);
+			__m128i bLo = _mm_unpacklo_epi8(b, zero), bHi = _mm_unpackhi_epi8(b, zero);
+
+			acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(aLo, bLo), w));
+			acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(aLo, bLo), w));
+			acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(aHi, bHi), w));
+			acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(aHi, bHi), w));
+		}
+
+		_mm_storeu_si128((__m128i*)(pDst + x), PackPixelsSSE2(acc0, acc1, acc2, acc3));
+	}
+
+	VerticalScalarRange(ppSrcRows, pWeights, iTaps, pDst, x, uEnd);
+}
+
+static void VerticalSSE2(const RGBQUAD * const *ppSrcRows, const short *pWeights, int iTaps, RGBQUAD *pDst, unsigned int uWidth)
+{
+	VerticalSSE2Range(ppSrcRows, pWeights, iTaps, pDst, 0, uWidth);
+}
+
+//-----------------------------------------------------------------------------
+// AVX2 kernels
+//-----------------------------------------------------------------------------
+RESIZE_TARGET_AVX2
+static void HorizontalAVX2(const RGBQUAD *pSrc, RGBQUAD *pDst, unsigned int dst_width, const CWeightsTable *pWeights)
+{
+	// (b0 g0 r0 a0 b1 g1 r1 a1) -> (b0 b1 g0 g1 r0 r1 a0 a1) within each 128-bit lane
+	const __m256i interleave = _mm256_setr_epi8(
+		0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+		0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+	// weight pair (w0,w1) across the low lane, (w2,w3) across the high lane
+	const __m256i spread = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+
+	for(UINT x = 0; x < dst_width; x++)
+	{
+		int iLeft = pWeights->getLeftBoundary(x);
+		int iTaps = pWeights->getRightBoundary(x) - iLeft + 1;
+		const short *pW = pWeights->getFixedWeights(x);
+		const RGBQUAD *p = pSrc + iLeft;
+
+		// four taps per step: taps 0,1 in the low lane, taps 2,3 in the high lane
+		__m256i acc256 = _mm256_setzero_si256();
+		int i = 0;
+		for(; i + 3 < iTaps; i += 4)
+		{
+			__m256i px = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + i)));
+			px = _mm256_shuffle_epi8(px, interleave);
+			__m256i w = _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)(pW + i))), spread);
+			acc256 = _mm256_add_epi32(acc256, _mm256_madd_epi16(px, w));
+		}
+
+		__m128i acc = _mm_add_epi32(_mm256_castsi256_si128(acc256), _mm256_extracti128_si256(acc256, 1));
+		acc = HorizontalTapsSSE2(p + i, pW + i, iTaps - i, acc);
+		StoreInt(pDst + x, StorePixelSSE2(acc));
+	}
+}
+
+RESIZE_TARGET_AVX2
+static void VerticalAVX2(const RGBQUAD * const *ppSrcRows, const short *pWeights, int iTaps, RGBQUAD *pDst, unsigned int uWidth)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i half = _mm256_set1_epi32(RESIZE_FIXED_HALF);
+	UINT x = 0;
+
+	// eight pixels per step; unpacks and packs are both per 128-bit lane,
+	// so the pixel order comes back out unchanged
+	for(; x + 8 <= uWidth; x += 8)
+	{
+		__m256i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+
+		for(int i = 0; i < iTaps; i += 2)
+		{
+			__m256i a = _mm256_loadu_si256((const __m256i*)(ppSrcRows[i] + x));
+			__m256i b = zero;
+			__m256i w;
+			if(i + 1 < iTaps)
+			{
+				b = _mm256_loadu_si256((const __m256i*)(ppSrcRows[i + 1] + x));
+				w = _mm256_set1_epi32(PackWeights(pWeights[i], pWeights[i + 1]));
+			}
+			else
+			{
+				w = _mm256_set1_epi32(PackWeights(pWeights[i], 0));
+			}
+
+			__m256i aLo = _mm256_unpacklo_epi8(a, zero), aHi = _mm256_unpackhi_epi8(a, zero);
+			__m256i bLo = _mm256_unpacklo_epi8(b, zero), bHi = _mm256_unpackhi_epi8(b, zero);
+
+			acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(aLo, bLo), w));
+			acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(aLo, bLo), w));
+			acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi16(aHi, bHi), w));
+			acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi16(aHi, bHi), w));
+		}
+
+		acc0 = _mm256_srai_epi32(_mm256_add_epi32(acc0, half), RESIZE_FIXED_BITS);
+		acc1 = _mm256_srai_epi32(_mm256_add_epi32(acc1, half), RESIZE_FIXED_BITS);
+		acc2 = _mm256_srai_epi32(_mm256_add_epi32(acc2, half), RESIZE_FIXED_BITS);
+		acc3 = _mm256_srai_epi32(_mm256_add_epi32(acc3, half), RESIZE_FIXED_BITS);
+
+		__m256i res = _mm256_packus_epi16(_mm256_packs_epi32(acc0, acc1), _mm256_packs_epi32(acc2, acc3));
+		_mm256_storeu_si256((__m256i*)(pDst + x), res);
+	}
+
+	VerticalSSE2Range(ppSrcRows, pWeights, iTaps, pDst, x, uWidth);
+}
+#endif // RESIZE_X86
+
+//-----------------------------------------------------------------------------
+// Runtime dispatch
+//-----------------------------------------------------------------------------
+EResizeKernel DetectResizeKernel()
+{
+#ifdef RESIZE_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int iMaxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool bSSE2 = (info[3] & (1 << 26)) != 0;
+	bool bOSXSave = (info[2] & (1 << 27)) != 0;
+	bool bAVX = (info[2] & (1 << 28)) != 0;
+	bool bAVX2 = false;
+
+	// AVX2 also needs the OS to save the upper halves of the ymm registers
+	if(iMaxLeaf >= 7 && bOSXSave && bAVX && (_xgetbv(0) & 6) == 6)
+	{
+		__cpuidex(info, 7, 0);
+		bAVX2 = (info[1] & (1 << 5)) != 0;
+	}
+
+	if(bAVX2)
+		return ERK_AVX2;
+	if(bSSE2)
+		return ERK_SSE2;
+#else
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+		return ERK_AVX2;
+	if(__builtin_cpu_supports("sse2"))
+		return ERK_SSE2;
+#endif
+#endif
+	return ERK_SCALAR;
+}
+
+static EResizeKernel &SelectedKernel()
+{
+	static EResizeKernel eKernel = DetectResizeKernel();
+	return eKernel;
+}
+
+EResizeKernel GetResizeKernel()
+{
+	return SelectedKernel();
+}
+
+void SetResizeKernel(EResizeKernel eKernel)
+{
+	EResizeKernel eBest = DetectResizeKernel();
+	SelectedKernel() = eKernel < eBest ? eKernel : eBest;
+}
+
+HORIZONTAL_KERNEL GetHorizontalKernel()
+{
+	switch(SelectedKernel())
+	{
+#ifdef RESIZE_X86
+	case ERK_AVX2:
+		return HorizontalAVX2;
+	case ERK_SSE2:
+		return HorizontalSSE2;
+#endif
+	default:
+		return HorizontalScalar;
+	}
+}
+
+VERTICAL_KERNEL GetVerticalKernel()
+{
+	switch(SelectedKernel())
+	{
+#ifdef RESIZE_X86
+	case ERK_AVX2:
+		return VerticalAVX2;
+	case ERK_SSE2:
+		return VerticalSSE2;
+#endif
+	default:
+		return VerticalScalar;
+	}
+}
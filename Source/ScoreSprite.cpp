@@ -37,6 +37,7 @@ ScoreSprite::ScoreSprite(const Vec2 position, const BackBuffer* BF)
 	scoreDig3->mVelocity = Vec2(0, 0);
 	scoreDig3->setBackBuffer(BF);
 
+	for (int i = 0; i < 4; i++) shownDig[i] = 0;
 	scoreInt = 0;
 }
 
@@ -72,6 +73,10 @@ void ScoreSprite::updateScore(int increment)
 //-----------------------------------------------------------------------------
 void ScoreSprite::updateDigit(int digID, int no)
 {
+	// Unchanged digits keep their sprite, so they are not repainted
+	if (digID < 0 || digID > 3 || shownDig[digID] == no) return;
+	shownDig[digID] = no;
+
 	std::string path = "data/numbers/" + std::to_string(no) + ".bmp";
 	
 	switch (digID) {
@@ -125,6 +130,18 @@ void ScoreSprite::draw()
 	scoreDig3->draw();
 }
 
+//-----------------------------------------------------------------------------
+// Name : getSprites () (Public)
+// Desc : Appends the digit sprites in drawing order.
+//-----------------------------------------------------------------------------
+void ScoreSprite::getSprites(std::vector<Sprite*> &sprites)
+{
+	sprites.push_back(scoreDig0);
+	sprites.push_back(scoreDig1);
+	sprites.push_back(scoreDig2);
+	sprites.push_back(scoreDig3);
+}
+
 //-----------------------------------------------------------------------------
 // Name : move () (Public)
 // Desc : Moves the object to a different position on the screen.
@@ -0,0 +1,920 @@
+// Simulation.cpp
+#include "Simulation.h"
+#include <algorithm>
+
+// Explosions show 16 frames, one every 70 ms
+#define SIM_EXPLOSION_FRAMES		16
+#define SIM_EXPLOSION_FRAME_TIME	0.07
+#define SIM_EXPLOSION_HALF_SIZE		64		// frames are drawn 128 x 128
+
+// Road layout, in playfield pixels. The lanes come with the level.
+#define SIM_ROAD_LEFT				220		// players stay right of this
+#define SIM_ROAD_RIGHT_MARGIN		155		// and this far from the right edge
+#define SIM_ROAD_BOTTOM_MARGIN		75
+#define SIM_OFFSCREEN_MARGIN		125		// cars below height + this are gone
+
+// Traffic density: a car every this many pixels of road on average, and
+// at least this much room between cars one after the other in a lane
+#define SIM_TRAFFIC_SPACING			240
+#define SIM_LANE_GAP				40
+#define SIM_TRAFFIC_BATCH			64		// cars planned at a time
+#define SIM_CRUISE_SPREAD			10		// cars drive up to this much faster, px/s
+
+// Car model weights up to this, so their sum fits an int
+#define SIM_MAX_WEIGHT				1000000
+
+#define SIM_START_LIVES				3
+#define SIM_MAX_LIVES				3
+
+// Traffic per level: cars, starting speed, speed ramp steps. The rest is
+// the same for every level, see DefaultLevels().
+static const int s_Levels[][3] =
+{
+	{ 20, 70, 2 },
+	{ 25, 70, 3 },
+	{ 28, 75, 3 },
+	{ 30, 80, 3 },
+	{ 35, 85, 4 },
+};
+
+static double Lerp(double a, double b, double t)
+{
+	return a + (b - a) * t;
+}
+
+static unsigned int ExplosionFrame(double dTime)
+{
+	int nFrame = (int)(dTime / SIM_EXPLOSION_FRAME_TIME);
+	return nFrame < SIM_EXPLOSION_FRAMES ? nFrame : SIM_EXPLOSION_FRAMES - 1;
+}
+
+CSimulation::CSimulation()
+{
+	DefaultConfig(m_Config);
+	DefaultLevels(m_Levels);
+	m_Endless.bEnabled = false;
+	m_Endless.base = m_Levels.back();
+	m_Endless.nCarsGrowth = m_Endless.nCarsLimit = 0;
+	m_Endless.nVelocityGrowth = m_Endless.nVelocityLimit = 0;
+	m_pInput = NULL;
+	m_pAudio = NULL;
+	m_eState = ESIM_RUNNING;
+	m_nLevel = 0;
+	m_Level = m_Levels[0];
+	m_uSteps = 0;
+	m_nCarsSent = m_nCarsToCome = 0;
+	m_dRoad = 0;
+	m_uNextSlot = 0;
+
+	for(int i = 0; i < ESP_COUNT; i++)
+		m_hPowerUps[i] = CEntityStore::InvalidHandle();
+
+	InitPlayers();
+}
+
+void CSimulation::DefaultConfig(SSimConfig &config)
+{
+	static const double carSizes[ESC_COUNT][2] = { { 100, 202 }, { 100, 213 }, { 100, 201 } };
+	static const double powerUpSizes[ESP_COUNT][2] = { { 37, 31 }, { 50, 65 }, { 92, 62 }, { 50, 49 } };
+
+	config.dWidth = 1920;
+	config.dHeight = 1080;
+
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		config.dPlayerSize[n][0] = 100;
+		config.dPlayerSize[n][1] = 208;
+	}
+
+	for(int m = 0; m < ESC_COUNT; m++)
+	{
+		config.dCarSize[m][0] = carSizes[m][0];
+		config.dCarSize[m][1] = carSizes[m][1];
+	}
+
+	config.dBulletSize[0] = 20;
+	config.dBulletSize[1] = 37;
+
+	for(int i = 0; i < ESP_COUNT; i++)
+	{
+		config.dPowerUpSize[i][0] = powerUpSizes[i][0];
+		config.dPowerUpSize[i][1] = powerUpSizes[i][1];
+	}
+}
+
+void CSimulation::DefaultLevels(std::vector<SSimLevel> &levels)
+{
+	static const int lanes[] = { 290, 490, 690, 890, 1110, -230 };
+	int nLevels = sizeof(s_Levels) / sizeof(s_Levels[0]);
+
+	levels.resize(nLevels);
+	for(int l = 0; l < nLevels; l++)
+	{
+		SSimLevel &level = levels[l];
+		level.nCars = s_Levels[l][0];
+		level.nVelocity = s_Levels[l][1];
+
+		// The ramp steps spread over the whole level
+		level.nRampStep = 5;
+		level.nRampCount = s_Levels[l][2];
+		level.nRampEvery = level.nCars / (level.nRampCount + 1);
+
+		level.nMix[ESC_CAR2] = 60;
+		level.nMix[ESC_CAR6] = 30;
+		level.nMix[ESC_POLICE] = 10;
+
+		level.nPowerUpMask = (1 << ESP_COUNT) - 1;
+		level.nPowerUpNear = 100;
+		level.nPowerUpFar = 10100;
+
+		level.nLanes = sizeof(lanes) / sizeof(lanes[0]);
+		for(int i = 0; i < level.nLanes; i++)
+			level.nLane[i] = lanes[i];
+	}
+}
+
+bool CSimulation::CheckLevel(const SSimLevel &level)
+{
+	int nMixTotal = 0;
+	for(int m = 0; m < ESC_COUNT; m++)
+	{
+		if(level.nMix[m] < 0 || level.nMix[m] > SIM_MAX_WEIGHT)
+			return false;
+		nMixTotal += level.nMix[m];
+	}
+
+	return level.nCars > 0 && level.nVelocity > 0 && level.nRampStep >= 0 && level.nRampEvery > 0 &&
+		level.nRampCount >= 0 && nMixTotal > 0 && level.nPowerUpNear >= 0 && level.nPowerUpFar > level.nPowerUpNear &&
+		level.nLanes > 0 && level.nLanes <= SIM_MAX_LANES;
+}
+
+void CSimulation::MakeLevel(int nLevel, SSimLevel &level) const
+{
+	if(nLevel < GetLevelCount())
+	{
+		level = m_Levels[nLevel];
+		return;
+	}
+
+	int k = nLevel - GetLevelCount();
+	level = m_Endless.base;
+
+	// 64 bits, k grows without bound
+	long long nCars = level.nCars + (long long)k * m_Endless.nCarsGrowth;
+	long long nVelocity = level.nVelocity + (long long)k * m_Endless.nVelocityGrowth;
+	level.nCars = (int)(nCars < m_Endless.nCarsLimit ? nCars : m_Endless.nCarsLimit);
+	level.nVelocity = (int)(nVelocity < m_Endless.nVelocityLimit ? nVelocity : m_Endless.nVelocityLimit);
+}
+
+int CSimulation::GetMaxVisibleCars() const
+{
+	int nLanes = m_Endless.bEnabled ? m_Endless.base.nLanes : 0;
+	for(size_t l = 0; l < m_Levels.size(); l++)
+		nLanes = std::max(nLanes, m_Levels[l].nLanes);
+
+	double dShortest = m_Config.dCarSize[0][1];
+	for(int m = 1; m < ESC_COUNT; m++)
+		dShortest = std::min(dShortest, m_Config.dCarSize[m][1]);
+
+	// Two more per lane for the cars cut by the top and bottom edges
+	return nLanes * ((int)(m_Config.dHeight / (dShortest + SIM_LANE_GAP)) + 2);
+}
+
+int CSimulation::ClampLevel(int nLevel) const
+{
+	if(nLevel < 0)
+		return 0;
+	if(!IsEndless() && nLevel >= GetLevelCount())
+		return GetLevelCount() - 1;
+	return nLevel;
+}
+
+void CSimulation::NewGame(uint64_t uSeed, int nLevel)
+{
+	m_Random.Seed(uSeed);
+	m_Entities.Clear();
+	m_eState = ESIM_RUNNING;
+	m_uSteps = 0;
+
+	InitPlayers();
+	StartLevel(ClampLevel(nLevel));
+}
+
+void CSimulation::InitPlayers()
+{
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		SSimPlayer &p = m_Players[n];
+		p.x = n == 0 ? 690 : 890;
+		p.y = 600;
+		p.vx = p.vy = 0;
+		p.prevX = p.x;
+		p.prevY = p.y;
+		p.nLives = SIM_START_LIVES;
+		p.nScore = 0;
+		p.bDead = false;
+		p.bExploding = false;
+		p.dExplosionTime = 0;
+		p.bInvincible = p.bShield = p.bGun = p.bDoubler = false;
+		p.nInvincibleSteps = p.nShieldSteps = p.nGunSteps = p.nDoublerSteps = 0;
+		p.nShotSteps = 250;		// can shoot straight away
+		p.nScoreSteps = 0;
+		p.nCrashes = 0;
+	}
+}
+
+void CSimulation::Load(const SSimSave &save, uint64_t uSeed)
+{
+	m_Random.Seed(uSeed);
+	m_Entities.Clear();
+	m_eState = ESIM_RUNNING;
+	m_uSteps = 0;
+
+	InitPlayers();
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		SSimPlayer &p = m_Players[n];
+		p.x = p.prevX = save.x[n];
+		p.y = p.prevY = save.y[n];
+		p.nLives = save.nLives[n];
+		p.nScore = save.nScore[n];
+		p.bDead = p.nLives <= 0;
+	}
+
+	// What was left of the level comes again, from the top of the road
+	m_nLevel = ClampLevel(save.nLevel);
+	MakeLevel(m_nLevel, m_Level);
+	StartTraffic(save.nCars);
+	m_nCarsSent = m_Level.nCars > save.nCars ? m_Level.nCars - save.nCars : 0;
+	SpawnPowerUps();
+}
+
+void CSimulation::Save(SSimSave &save) const
+{
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		save.x[n] = m_Players[n].x;
+		save.y[n] = m_Players[n].y;
+		save.nLives[n] = m_Players[n].nLives;
+		save.nScore[n] = m_Players[n].nScore;
+	}
+
+	save.nLevel = m_nLevel;
+	save.nCars = (int)GetCarCount() + m_nCarsToCome;
+}
+
+void CSimulation::StartLevel(int nLevel)
+{
+	m_nLevel = nLevel;
+	MakeLevel(nLevel, m_Level);
+	StartTraffic(m_Level.nCars);
+	SpawnPowerUps();
+}
+
+void CSimulation::ResetPlayers()
+{
+	m_Players[0].x = 690;
+	m_Players[1].x = 850;
+
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		m_Players[n].y = 600;
+		m_Players[n].vx = m_Players[n].vy = 0;
+	}
+}
+
+void CSimulation::Step()
+{
+	// The state drawing interpolates from
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		m_Players[n].prevX = m_Players[n].x;
+		m_Players[n].prevY = m_Players[n].y;
+	}
+	m_Entities.SaveState();
+
+	// Asked every step, so a recording of the input has one entry per step
+	unsigned int uButtons[SIM_PLAYERS];
+	for(int n = 0; n < SIM_PLAYERS; n++)
+		uButtons[n] = m_pInput ? m_pInput->GetButtons(n) : 0;
+
+	m_uSteps++;
+
+	if(m_eState != ESIM_RUNNING)
+		return;
+
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		if(!m_Players[n].bDead)
+			MovePlayer(n, uButtons[n]);
+	}
+
+	UpdateState();
+	if(m_eState != ESIM_RUNNING)
+		return;
+
+	for(int n = 0; n < SIM_PLAYERS; n++)
+		UpdatePlayer(n);
+
+	// Traffic, bullets and power-ups
+	m_TrafficLanes.Drive(m_Entities, SIM_STEP);
+	StreamTraffic();
+	m_Entities.Integrate(SIM_STEP);
+	m_Entities.FlagBelow(EEK_CAR, m_Config.dHeight + SIM_OFFSCREEN_MARGIN, EEF_DEAD);
+
+	// Cars do not move again this step
+	BuildBroadPhase();
+
+	for(int n = 0; n < SIM_PLAYERS; n++)
+		CollidePlayer(n);
+
+	for(int n = 0; n < SIM_PLAYERS; n++)
+		CollidePowerUps(n);
+
+	CollideBullets();
+	CollideTraffic();
+	AdvanceExplosions();
+	RemoveDead();
+}
+
+void CSimulation::UpdateState()
+{
+	if(m_Players[0].bDead && m_Players[1].bDead)
+	{
+		m_eState = ESIM_LOST;
+	}
+	else if(!GetCarCount() && !m_nCarsToCome)
+	{
+		if(m_nLevel + 1 < GetLevelCount() || IsEndless())
+		{
+			Play(ESS_LEVEL_FINISHED);
+			StartLevel(m_nLevel + 1);
+			ResetPlayers();
+		}
+		else
+		{
+			m_eState = ESIM_WON;
+		}
+	}
+}
+
+double CSimulation::LaneX(int nLane) const
+{
+	int x = m_Level.nLane[nLane];
+	return x < 0 ? m_Config.dWidth + x : x;
+}
+
+double CSimulation::RandomLane()
+{
+	return LaneX((int)m_Random.Below(m_Level.nLanes));
+}
+
+void CSimulation::StartTraffic(int nCars)
+{
+	m_nCarsSent = 0;
+	m_nCarsToCome = nCars > 0 ? nCars : 0;
+	m_dRoad = 0;
+
+	// Cars one after the other in a lane are a car and the gap apart
+	double dLongest = 0;
+	for(int m = 0; m < ESC_COUNT; m++)
+	{
+		if(m_Config.dCarSize[m][1] > dLongest)
+			dLongest = m_Config.dCarSize[m][1];
+	}
+
+	m_TrafficPlan.Start(m_Level.nLanes, SIM_TRAFFIC_SPACING, dLongest + SIM_LANE_GAP);
+	m_TrafficSlots.clear();
+	m_uNextSlot = 0;
+
+	double laneX[SIM_MAX_LANES];
+	for(int l = 0; l < m_Level.nLanes; l++)
+		laneX[l] = LaneX(l);
+	m_TrafficLanes.Start(laneX, m_Level.nLanes);
+}
+
+void CSimulation::StreamTraffic()
+{
+	if(!m_nCarsToCome)
+		return;
+
+	// The road moves at the level's speed
+	m_dRoad += m_Level.nVelocity * SIM_STEP;
+
+	int nMixTotal = 0;
+	for(int m = 0; m < ESC_COUNT; m++)
+		nMixTotal += m_Level.nMix[m];
+
+	while(m_nCarsToCome)
+	{
+		// A batch at a time, so a level of any length only plans the cars
+		// close to the road
+		if(m_uNextSlot == m_TrafficSlots.size())
+		{
+			m_TrafficSlots.clear();
+			m_uNextSlot = 0;
+			m_TrafficPlan.Plan(m_Random, m_nCarsToCome < SIM_TRAFFIC_BATCH ? m_nCarsToCome : SIM_TRAFFIC_BATCH,
+				m_TrafficSlots);
+		}
+
+		const STrafficSlot &slot = m_TrafficSlots[m_uNextSlot];
+		if(slot.dDistance > m_dRoad)
+			return;
+		m_uNextSlot++;
+
+		int nPick = (int)m_Random.Below(nMixTotal);
+		int nModel = 0;
+		while(nPick >= m_Level.nMix[nModel])
+			nPick -= m_Level.nMix[nModel++];
+
+		// Cars further into the level come faster, and no two drivers
+		// quite agree on the speed
+		int nRamps = m_nCarsSent / m_Level.nRampEvery;
+		double velocityY = m_Level.nVelocity + m_Level.nRampStep * (nRamps < m_Level.nRampCount ? nRamps : m_Level.nRampCount);
+		velocityY += m_Random.Below(SIM_CRUISE_SPREAD + 1);
+		double halfH = m_Config.dCarSize[nModel][1] / 2;
+
+		// Just above the road, or behind the last car of a backed up lane
+		double y = m_TrafficLanes.GetEntry(m_Entities, slot.nLane, 0) - halfH;
+		SEntityHandle h = m_Entities.Create(EEK_CAR, LaneX(slot.nLane), y, 0, velocityY,
+			m_Config.dCarSize[nModel][0] / 2, halfH, nModel);
+		m_TrafficLanes.Add(h, slot.nLane, velocityY);
+		m_nCarsSent++;
+		m_nCarsToCome--;
+	}
+}
+
+void CSimulation::SpawnPowerUps()
+{
+	for(int i = 0; i < ESP_COUNT; i++)
+	{
+		m_Entities.Destroy(m_hPowerUps[i]);
+		m_hPowerUps[i] = CEntityStore::InvalidHandle();
+	}
+
+	// All of them come down the same lane, at different heights
+	double x = RandomLane();
+	int nRange = m_Level.nPowerUpFar - m_Level.nPowerUpNear;
+	int previous = 0;
+
+	for(int i = 0; i < ESP_COUNT; i++)
+	{
+		if(!(m_Level.nPowerUpMask & (1 << i)))
+			continue;
+
+		int y = (int)m_Random.Below(nRange) + m_Level.nPowerUpNear;
+		while(y == previous && nRange > 1)
+			y = (int)m_Random.Below(nRange) + m_Level.nPowerUpNear;
+		previous = y;
+
+		m_hPowerUps[i] = m_Entities.Create(EEK_POWERUP, x, -y, 0, 40,
+			m_Config.dPowerUpSize[i][0] / 2, m_Config.dPowerUpSize[i][1] / 2, i);
+	}
+}
+
+void CSimulation::MovePlayer(int nPlayer, unsigned int uButtons)
+{
+	SSimPlayer &p = m_Players[nPlayer];
+	double halfW = m_Config.dPlayerSize[nPlayer][0] / 2;
+	double halfH = m_Config.dPlayerSize[nPlayer][1] / 2;
+
+	// Held buttons accelerate, the road edges stop the car and push it back
+	if(p.x - halfW <= SIM_ROAD_LEFT)
+	{
+		p.vx = 0;
+		p.x += 1;
+	}
+	else if(uButtons & SIM_BUTTON_LEFT)
+	{
+		p.vx -= 5;
+	}
+
+	if(p.x + halfW >= m_Config.dWidth - SIM_ROAD_RIGHT_MARGIN)
+	{
+		p.vx = 0;
+		p.x -= 1;
+	}
+	else if(uButtons & SIM_BUTTON_RIGHT)
+	{
+		p.vx += 5;
+	}
+
+	if(p.y - halfH <= 0)
+	{
+		p.vy = 0;
+		p.y += 1;
+	}
+	else if(uButtons & SIM_BUTTON_UP)
+	{
+		p.vy -= 5;
+	}
+
+	if(p.y + halfH >= m_Config.dHeight - SIM_ROAD_BOTTOM_MARGIN)
+	{
+		p.vy = 0;
+		p.y -= 1;
+	}
+	else if(uButtons & SIM_BUTTON_DOWN)
+	{
+		p.vy += 5;
+	}
+
+	if((uButtons & SIM_BUTTON_FIRE) && p.bGun && p.nShotSteps >= SIM_SHOT_STEPS)
+	{
+		FireBullet(nPlayer);
+		p.nShotSteps = 0;
+	}
+}
+
+void CSimulation::FireBullet(int nPlayer)
+{
+	const SSimPlayer &p = m_Players[nPlayer];
+
+	m_Entities.Create(EEK_BULLET, p.x, p.y - SIM_BULLET_OFFSET, 0, -SIM_BULLET_SPEED,
+		m_Config.dBulletSize[0] / 2, m_Config.dBulletSize[1] / 2, nPlayer);
+	Play(ESS_SHOOT);
+}
+
+void CSimulation::UpdatePlayer(int nPlayer)
+{
+	SSimPlayer &p = m_Players[nPlayer];
+
+	if(p.bDead)
+		return;
+
+	if(!p.bExploding)
+	{
+		// Points for staying alive, twice as fast with the doubler
+		p.nScoreSteps++;
+		if(p.bDoubler)
+		{
+			if(p.nScoreSteps % 2 == 0)
+				p.nScore++;
+
+			p.nDoublerSteps++;
+			if(p.nDoublerSteps == 300)
+				Play(ESS_TIMER);
+			if(p.nDoublerSteps == 500)
+			{
+				p.bDoubler = false;
+				p.nDoublerSteps = 0;
+			}
+		}
+		else if(p.nScoreSteps % 4 == 0)
+		{
+			p.nScore++;
+		}
+
+		if(p.bInvincible)
+		{
+			p.nInvincibleSteps++;
+			if(p.nInvincibleSteps == 400)
+			{
+				p.bInvincible = false;
+				p.nInvincibleSteps = 0;
+			}
+		}
+
+		if(p.bGun)
+		{
+			p.nGunSteps++;
+			if(p.nGunSteps == 300)
+				Play(ESS_TIMER);
+			if(p.nGunSteps == 500)
+			{
+				p.bGun = false;
+				p.nGunSteps = 0;
+			}
+		}
+
+		if(p.bShield)
+		{
+			p.nShieldSteps++;
+			if(p.nShieldSteps == 300)
+				Play(ESS_TIMER);
+			if(p.nShieldSteps == 500)
+			{
+				p.bShield = false;
+				p.bInvincible = false;
+				p.nShieldSteps = 0;
+				p.nInvincibleSteps = 0;
+			}
+		}
+	}
+
+	p.x += p.vx * SIM_STEP;
+	p.y += p.vy * SIM_STEP;
+	p.nShotSteps++;
+}
+
+void CSimulation::BuildBroadPhase()
+{
+	m_BroadPhase.Clear();
+	m_Entities.FillBroadPhase(EEK_CAR, m_BroadPhase);
+	m_BroadPhase.Build();
+}
+
+SAabb CSimulation::GetPlayerBox(int nPlayer) const
+{
+	const SSimPlayer &p = m_Players[nPlayer];
+	double halfW = m_Config.dPlayerSize[nPlayer][0] / 2;
+	double halfH = m_Config.dPlayerSize[nPlayer][1] / 2;
+
+	SAabb box = { p.x - halfW, p.y - halfH, p.x + halfW, p.y + halfH };
+	return box;
+}
+
+void CSimulation::CollidePlayer(int nPlayer)
+{
+	SSimPlayer &p = m_Players[nPlayer];
+
+	if(p.bDead || p.bExploding || p.bInvincible || p.nLives <= 0)
+		return;
+
+	m_BroadPhase.QueryBox(GetPlayerBox(nPlayer), m_Hits);
+	if(m_Hits.empty())
+		return;
+
+	// Lose a life and start again at the bottom, the car goes up in flames
+	p.nLives--;
+	p.nCrashes++;
+	p.x = nPlayer == 0 ? 690 : 850;
+	p.y = 600;
+	p.vx = p.vy = 0;
+	ExplodeCar(m_Entities.IndexOfSlot(m_Hits[0]));
+	Play(ESS_EXPLOSION);
+
+	p.nScore -= 100;
+	p.bInvincible = true;
+}
+
+void CSimulation::CollidePowerUps(int nPlayer)
+{
+	// Same order the game always checked them in
+	static const ESimPowerUp order[ESP_COUNT] = { ESP_LIFE, ESP_DOUBLER, ESP_SHIELD, ESP_GUN };
+	SSimPlayer &p = m_Players[nPlayer];
+
+	if(p.bDead)
+		return;
+
+	SAabb box = GetPlayerBox(nPlayer);
+
+	for(int k = 0; k < ESP_COUNT; k++)
+	{
+		ESimPowerUp eId = order[k];
+		if(!m_Entities.IsValid(m_hPowerUps[eId]))
+			continue;
+
+		// Already taken this step
+		size_t i = m_Entities.IndexOf(m_hPowerUps[eId]);
+		if(m_Entities.Flags(i) & EEF_DEAD)
+			continue;
+
+		double x = m_Entities.PosX(i), y = m_Entities.PosY(i);
+		if(x < box.left || x > box.right || y < box.top || y > box.bottom)
+			continue;
+
+		switch(eId)
+		{
+		case ESP_LIFE:
+			if(p.nLives < SIM_MAX_LIVES)
+				p.nLives++;
+			break;
+		case ESP_DOUBLER:
+			p.bDoubler = true;
+			break;
+		case ESP_SHIELD:
+			p.bShield = true;
+			p.bInvincible = true;
+			break;
+		case ESP_GUN:
+			p.bGun = true;
+			break;
+		default:
+			break;
+		}
+
+		Play(ESS_POWERUP);
+		m_Entities.Flags(i) |= EEF_DEAD;
+	}
+}
+
+void CSimulation::CollideBullets()
+{
+	for(size_t i = 0; i < m_Entities.GetCount(); i++)
+	{
+		if(m_Entities.Kind(i) != EEK_BULLET || (m_Entities.Flags(i) & EEF_DEAD))
+			continue;
+
+		double y = m_Entities.PosY(i);
+
+		m_BroadPhase.QueryPoint(m_Entities.PosX(i), y, m_Hits);
+		if(!m_Hits.empty())
+		{
+			// The shooter scores
+			m_Players[m_Entities.Variant(i)].nScore += 100;
+			ExplodeCar(m_Entities.IndexOfSlot(m_Hits[0]));
+			Play(ESS_EXPLOSION);
+			m_Entities.Flags(i) |= EEF_DEAD;
+		}
+		else if(y >= m_Config.dHeight || y <= 0)
+		{
+			m_Entities.Flags(i) |= EEF_DEAD;
+		}
+	}
+}
+
+void CSimulation::CollideTraffic()
+{
+	// Cars keep their distance within a lane (see TrafficLanes.h). Lanes
+	// closer together than a car is wide can still make two overlap, then
+	// one of them is taken off the road.
+	for(size_t i = 0; i < m_Entities.GetCount(); i++)
+	{
+		if(m_Entities.Kind(i) != EEK_CAR || (m_Entities.Flags(i) & EEF_DEAD))
+			continue;
+
+		m_BroadPhase.QueryBox(m_Entities.GetBox(i), m_Hits);
+		for(size_t k = 0; k < m_Hits.size(); k++)
+		{
+			if(m_Hits[k] != m_Entities.SlotAt(i))
+			{
+				m_Entities.Flags(m_Entities.IndexOfSlot(m_Hits[k])) |= EEF_DEAD;
+				break;
+			}
+		}
+	}
+}
+
+void CSimulation::ExplodeCar(size_t uCar)
+{
+	m_Entities.VelX(uCar) = 0;
+	m_Entities.VelY(uCar) = 0;
+
+	if(!(m_Entities.Flags(uCar) & EEF_EXPLODING))
+	{
+		m_Entities.Flags(uCar) |= EEF_EXPLODING;
+		m_Entities.Timer(uCar) = 0;
+	}
+}
+
+void CSimulation::AdvanceExplosions()
+{
+	const double dLength = SIM_EXPLOSION_FRAMES * SIM_EXPLOSION_FRAME_TIME;
+
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		SSimPlayer &p = m_Players[n];
+		if(!p.bExploding)
+			continue;
+
+		p.dExplosionTime += SIM_STEP;
+		if(p.dExplosionTime >= dLength)
+		{
+			p.bExploding = false;
+			p.bDead = true;
+		}
+	}
+
+	for(size_t i = 0; i < m_Entities.GetCount(); i++)
+	{
+		if(!(m_Entities.Flags(i) & EEF_EXPLODING))
+			continue;
+
+		m_Entities.Timer(i) += SIM_STEP;
+		if(m_Entities.Timer(i) >= dLength)
+			m_Entities.Flags(i) |= EEF_DEAD;
+	}
+}
+
+void CSimulation::RemoveDead()
+{
+	// Out of lives: the player's own car explodes, then it is out
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		SSimPlayer &p = m_Players[n];
+		if(p.nLives <= 0 && !p.bExploding && !p.bDead)
+		{
+			p.bExploding = true;
+			p.dExplosionTime = 0;
+			p.vx = p.vy = 0;
+		}
+	}
+
+	m_Entities.RemoveFlagged(EEF_DEAD);
+}
+
+void CSimulation::Play(ESimSound eSound)
+{
+	if(m_pAudio)
+		m_pAudio->PlayEffect(eSound);
+}
+
+void CSimulation::Render(CSimRenderer &renderer, double alpha) const
+{
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		const SSimPlayer &p = m_Players[n];
+		if(p.bDead)
+			continue;
+
+		double x = Lerp(p.prevX, p.x, alpha);
+		double y = Lerp(p.prevY, p.y, alpha);
+
+		if(p.bExploding)
+			renderer.DrawObject(ESO_EXPLOSION, ExplosionFrame(p.dExplosionTime), x, y);
+		else
+			renderer.DrawObject(ESO_PLAYER, n, x, y);
+	}
+
+	// Bullets under the traffic, power-ups on top
+	static const EEntityKind order[] = { EEK_BULLET, EEK_CAR, EEK_POWERUP };
+	static const ESimObject objects[] = { ESO_BULLET, ESO_CAR, ESO_POWERUP };
+
+	for(int k = 0; k < 3; k++)
+	{
+		for(size_t i = 0; i < m_Entities.GetCount(); i++)
+		{
+			if(m_Entities.Kind(i) != order[k])
+				continue;
+
+			double x = Lerp(m_Entities.PrevX(i), m_Entities.PosX(i), alpha);
+			double y = Lerp(m_Entities.PrevY(i), m_Entities.PosY(i), alpha);
+			bool bExploding = (m_Entities.Flags(i) & EEF_EXPLODING) != 0;
+
+			// Cars queued above the top edge and those leaving at the
+			// bottom are not drawn
+			double dHalfW = m_Entities.HalfWidth(i), dHalfH = m_Entities.HalfHeight(i);
+			if(bExploding)
+			{
+				dHalfW = std::max(dHalfW, (double)SIM_EXPLOSION_HALF_SIZE);
+				dHalfH = std::max(dHalfH, (double)SIM_EXPLOSION_HALF_SIZE);
+			}
+			if(x + dHalfW <= 0 || x - dHalfW >= m_Config.dWidth || y + dHalfH <= 0 || y - dHalfH >= m_Config.dHeight)
+				continue;
+
+			if(bExploding)
+				renderer.DrawObject(ESO_EXPLOSION, ExplosionFrame(m_Entities.Timer(i)), x, y);
+			else
+				renderer.DrawObject(objects[k], m_Entities.Variant(i), x, y);
+		}
+	}
+}
+
+// FNV-1a over the bytes of a value
+static void HashBytes(uint64_t &uHash, const void *pData, size_t uSize)
+{
+	const unsigned char *p = (const unsigned char *)pData;
+	for(size_t i = 0; i < uSize; i++)
+	{
+		uHash ^= p[i];
+		uHash *= 1099511628211ull;
+	}
+}
+
+template <class T>
+static void HashValue(uint64_t &uHash, const T &value)
+{
+	HashBytes(uHash, &value, sizeof(value));
+}
+
+uint64_t CSimulation::GetChecksum() const
+{
+	uint64_t uHash = 14695981039346656037ull;
+
+	HashValue(uHash, m_eState);
+	HashValue(uHash, m_nLevel);
+	HashValue(uHash, m_uSteps);
+	HashValue(uHash, m_nCarsSent);
+	HashValue(uHash, m_nCarsToCome);
+	HashValue(uHash, m_dRoad);
+	HashValue(uHash, m_TrafficPlan.GetPlanned());
+	HashValue(uHash, (uint64_t)m_uNextSlot);
+	for(int l = 0; l < m_TrafficLanes.GetLaneCount(); l++)
+		HashValue(uHash, (uint64_t)m_TrafficLanes.GetQueued(l));
+
+	// Field by field, padding bytes are undefined
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		const SSimPlayer &p = m_Players[n];
+		double values[] = { p.x, p.y, p.vx, p.vy, p.dExplosionTime };
+		int counters[] = { p.nLives, p.nScore, p.nInvincibleSteps, p.nShieldSteps,
+			p.nGunSteps, p.nDoublerSteps, p.nShotSteps, p.nScoreSteps };
+		bool flags[] = { p.bDead, p.bExploding, p.bInvincible, p.bShield, p.bGun, p.bDoubler };
+
+		HashValue(uHash, values);
+		HashValue(uHash, counters);
+		HashValue(uHash, flags);
+	}
+
+	for(size_t i = 0; i < m_Entities.GetCount(); i++)
+	{
+		double values[] = { m_Entities.PosX(i), m_Entities.PosY(i), m_Entities.VelX(i), m_Entities.VelY(i), m_Entities.Timer(i) };
+		unsigned int ids[] = { (unsigned int)m_Entities.Kind(i), m_Entities.Variant(i), m_Entities.Flags(i) };
+
+		HashValue(uHash, values);
+		HashValue(uHash, ids);
+	}
+
+	return uHash;
+}
@@ -1,7 +1,10 @@
 #include "Sprite.h"
+#include "SpriteAtlas.h"
 
 extern HINSTANCE g_hInst;
 
+const CSpriteAtlas *Sprite::spAtlas = NULL;
+
 Sprite::Sprite(int imageID, int maskID)
 {
 	// Load the bitmap resources.
@@ -16,6 +19,9 @@ Sprite::Sprite(int imageID, int maskID)
 	assert(mImageBM.bmWidth == mMaskBM.bmWidth);
 	assert(mImageBM.bmHeight == mMaskBM.bmHeight);	
 
+	setFullSource();
+	mbOwnsImage = true;
+	mhTransparentMask = 0;
 	mcTransparentColor = 0;
 	mhSpriteDC = 0;
 	frameCounter = 0;
@@ -23,8 +29,11 @@ Sprite::Sprite(int imageID, int maskID)
 
 Sprite::Sprite(const char *szImageFile, const char *szMaskFile)
 {
-	mhImage = (HBITMAP)LoadImage(g_hInst, szImageFile, IMAGE_BITMAP, 0, 0, LR_CREATEDIBSECTION | LR_LOADFROMFILE);
-	mhMask = (HBITMAP)LoadImage(g_hInst, szMaskFile, IMAGE_BITMAP, 0, 0, LR_CREATEDIBSECTION | LR_LOADFROMFILE);
+	// Shared bitmaps, only the first sprite using a file reads it.
+	mpImageAsset = CAssetCache::instance().loadBitmap(szImageFile);
+	mpMaskAsset = CAssetCache::instance().loadBitmap(szMaskFile);
+	mhImage = mpImageAsset ? mpImageAsset->getBitmap() : 0;
+	mhMask = mpMaskAsset ? mpMaskAsset->getBitmap() : 0;
 
 	// Get the BITMAP structure for each of the bitmaps.
 	GetObject(mhImage, sizeof(BITMAP), &mImageBM);
@@ -34,21 +43,54 @@ Sprite::Sprite(const char *szImageFile, const char *szMaskFile)
 	assert(mImageBM.bmWidth == mMaskBM.bmWidth);
 	assert(mImageBM.bmHeight == mMaskBM.bmHeight);
 
+	setFullSource();
+	mbOwnsImage = false;
+	mhTransparentMask = 0;
 	mcTransparentColor = 0;
 	mhSpriteDC = 0;
 	frameCounter = 0;
 }
 
-Sprite::Sprite(const char *szImageFile, COLORREF crTransparentColor)
+Sprite::Sprite(const char *szImageFile, COLORREF crTransparentColor, ELoadMode eMode)
 {
-	mhImage = (HBITMAP)LoadImage(g_hInst, szImageFile, IMAGE_BITMAP, 0, 0, LR_CREATEDIBSECTION | LR_LOADFROMFILE);
+	COLORREF crPacked;
 
 	mhMask = 0;
 	mhSpriteDC = 0;
 	mcTransparentColor = crTransparentColor;
 
-	// Get the BITMAP structure for the bitmap.
-	GetObject(mhImage, sizeof(BITMAP), &mImageBM);
+	if(spAtlas && spAtlas->Find(szImageFile, mpImageAsset, mrcSource, crPacked))
+	{
+		// Packed: draw from our rectangle of the shared page, keyed with the
+		// colour the packer filled the page with.
+		mcTransparentColor = crPacked;
+		mImageBM = mpImageAsset->getInfo();
+		mImageBM.bmWidth = mrcSource.right - mrcSource.left;
+		mImageBM.bmHeight = mrcSource.bottom - mrcSource.top;
+		mbOwnsImage = false;
+	}
+	else
+	{
+		// Shared bitmap, only the first sprite using a file reads it.
+		mpImageAsset = CAssetCache::instance().loadBitmap(szImageFile, eMode);
+
+		// Get the BITMAP structure for the bitmap (the size is known
+		// before a mapped file is decoded).
+		if(mpImageAsset)
+			mImageBM = mpImageAsset->getInfo();
+		else
+			ZeroMemory(&mImageBM, sizeof(BITMAP));
+		setFullSource();
+		mbOwnsImage = false;
+	}
+
+	// The mask only depends on the bitmap and the key, so it is built once
+	// per file (or atlas page) here instead of on every draw. A mapped
+	// file waits for its first draw.
+	mhImage = 0;
+	mhTransparentMask = 0;
+	if(eMode == ELM_IMMEDIATE)
+		resolveImage();
 
 	frameCounter = 0;
 
@@ -59,12 +101,30 @@ Sprite::Sprite(const char *szImageFile, COLORREF crTransparentColor)
 Sprite::~Sprite()
 {
 	// Free the resources we created in the constructor.
-	DeleteObject(mhImage);
-	DeleteObject(mhMask);
+	// (shared bitmaps go away with the last reference)
+	if(mbOwnsImage)
+	{
+		DeleteObject(mhImage);
+		DeleteObject(mhMask);
+	}
 
 	DeleteDC(mhSpriteDC);
 }
 
+void Sprite::resolveImage()
+{
+	if(mhImage || !mpImageAsset)
+		return;
+
+	mhImage = mpImageAsset->getBitmap();
+	mhTransparentMask = mhImage ? mpImageAsset->getMask(mcTransparentColor) : 0;
+}
+
+void Sprite::setFullSource()
+{
+	SetRect(&mrcSource, 0, 0, mImageBM.bmWidth, mImageBM.bmHeight);
+}
+
 void Sprite::update(float dt)
 {
 	// Update the sprites position.
@@ -91,6 +151,21 @@ void Sprite::draw()
 		drawTransparent();
 }
 
+void Sprite::getDrawState(RECT &rcBounds, HBITMAP &hImage, POINT &ptSource)
+{
+	int w = width();
+	int h = height();
+	int x = (int)mPosition.x - (w / 2);
+	int y = (int)mPosition.y - (h / 2);
+
+	resolveImage();
+
+	SetRect(&rcBounds, x, y, x + w, y + h);
+	hImage = mhImage;
+	ptSource.x = mrcSource.left;
+	ptSource.y = mrcSource.top;
+}
+
 void Sprite::drawMask()
 {
 	if( mpBackBuffer == NULL )
@@ -118,7 +193,7 @@ void Sprite::drawMask()
 	// only draws the black pixels in the mask to the backbuffer,
 	// thereby marking the pixels we want to draw the sprite
 	// image onto.
-	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, 0, 0, SRCAND);
+	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, mrcSource.left, mrcSource.top, SRCAND);
 
 	// Now select the image bitmap.
 	SelectObject(mhSpriteDC, mhImage);
@@ -126,7 +201,7 @@ void Sprite::drawMask()
 	// Draw the image to the backbuffer with SRCPAINT. This
 	// will only draw the image onto the pixels that where previously
 	// marked black by the mask.
-	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, 0, 0, SRCPAINT);
+	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, mrcSource.left, mrcSource.top, SRCPAINT);
 
 	// Restore the original bitmap object.
 	SelectObject(mhSpriteDC, oldObj);
@@ -134,7 +209,9 @@ void Sprite::drawMask()
 
 void Sprite::drawTransparent()
 {
-	if( mpBackBuffer == NULL )
+	resolveImage();
+
+	if( mpBackBuffer == NULL || mhTransparentMask == 0 )
 		return;
 
 	HDC hBackBuffer = mpBackBuffer->getDC();
@@ -146,42 +223,14 @@ void Sprite::drawTransparent()
 	int x = (int)mPosition.x - (w / 2);
 	int y = (int)mPosition.y - (h / 2);
 
-	COLORREF crOldBack = SetBkColor(hBackBuffer, RGB(255, 255, 255));
-	COLORREF crOldText = SetTextColor(hBackBuffer, RGB(0, 0, 0));
-	HDC dcImage, dcTrans;
-
-	// Create two memory dcs for the image and the mask
-	dcImage=CreateCompatibleDC(hBackBuffer);
-	dcTrans=CreateCompatibleDC(hBackBuffer);
-
-	// Select the image into the appropriate dc
-	SelectObject(dcImage, mhImage);
+	HGDIOBJ oldObj = SelectObject(mhSpriteDC, mhImage);
 
-	// Create the mask bitmap
-	BITMAP bitmap;
-	GetObject(mhImage, sizeof(BITMAP), &bitmap);
-	HBITMAP bitmapTrans = CreateBitmap(bitmap.bmWidth, bitmap.bmHeight, 1, 1, NULL);
+	// One masked blit with the precomputed mask: where the mask is white
+	// (transparent colour) the destination is kept, elsewhere the image is copied.
+	MaskBlt(hBackBuffer, x, y, w, h, mhSpriteDC, mrcSource.left, mrcSource.top,
+		mhTransparentMask, mrcSource.left, mrcSource.top, MAKEROP4(0x00AA0029, SRCCOPY));
 
-	// Select the mask bitmap into the appropriate dc
-	SelectObject(dcTrans, bitmapTrans);
-
-	// Build mask based on transparent color
-	SetBkColor(dcImage, mcTransparentColor);
-	BitBlt(dcTrans, 0, 0, bitmap.bmWidth, bitmap.bmHeight, dcImage, 0, 0, SRCCOPY);
-
-	// Do the work - True Mask method - cool if not actual display
-	BitBlt(hBackBuffer, x, y, bitmap.bmWidth, bitmap.bmHeight, dcImage, 0, 0, SRCINVERT);
-	BitBlt(hBackBuffer, x, y, bitmap.bmWidth, bitmap.bmHeight, dcTrans, 0, 0, SRCAND);
-	BitBlt(hBackBuffer, x, y, bitmap.bmWidth, bitmap.bmHeight, dcImage, 0, 0, SRCINVERT);
-
-	// free memory	
-	DeleteDC(dcImage);
-	DeleteDC(dcTrans);
-	DeleteObject(bitmapTrans);
-
-	// Restore settings
-	SetBkColor(hBackBuffer, crOldBack);
-	SetTextColor(hBackBuffer, crOldText);
+	SelectObject(mhSpriteDC, oldObj);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -254,4 +303,14 @@ void AnimatedSprite::draw()
 
 	// Restore the original bitmap object.
 	SelectObject(mhSpriteDC, oldObj);
-}
\ No newline at end of file
+}
+
+void AnimatedSprite::getDrawState(RECT &rcBounds, HBITMAP &hImage, POINT &ptSource)
+{
+	int x = (int)mPosition.x - (miFrameWidth / 2);
+	int y = (int)mPosition.y - (miFrameHeight / 2);
+
+	SetRect(&rcBounds, x, y, x + miFrameWidth, y + miFrameHeight);
+	hImage = mhImage;
+	ptSource = mptFrameCrop;
+}
@@ -0,0 +1,57 @@
+// SpriteAtlas.cpp
+#include "SpriteAtlas.h"
+
+CSpriteAtlas::CSpriteAtlas()
+{
+}
+
+CSpriteAtlas::~CSpriteAtlas()
+{
+	Release();
+}
+
+bool CSpriteAtlas::Load(const char *szIndexFile)
+{
+	Release();
+
+	if(!m_Index.Load(szIndexFile))
+		return false;
+
+	// pages live next to the index
+	std::string strDir(szIndexFile);
+	size_t uSlash = strDir.find_last_of("/\\");
+	strDir = uSlash == std::string::npos ? "" : strDir.substr(0, uSlash + 1);
+
+	for(size_t i = 0; i < m_Index.GetPageCount(); i++)
+	{
+		std::string strPage = strDir + m_Index.GetPage(i);
+		BitmapAssetPtr pPage = CAssetCache::instance().loadBitmap(strPage.c_str());
+		if(!pPage)
+		{
+			Release();
+			return false;
+		}
+
+		m_Pages.push_back(pPage);
+	}
+
+	return true;
+}
+
+void CSpriteAtlas::Release()
+{
+	m_Pages.clear();
+	m_Index.Clear();
+}
+
+bool CSpriteAtlas::Find(const char *szImageFile, BitmapAssetPtr &pPage, RECT &rcSource, COLORREF &crTransparent) const
+{
+	const SAtlasEntry *pEntry = m_Index.Find(szImageFile);
+	if(!pEntry || pEntry->uPage >= m_Pages.size())
+		return false;
+
+	pPage = m_Pages[pEntry->uPage];
+	rcSource = pEntry->rcSource;
+	crTransparent = pEntry->crTransparent;
+	return true;
+}
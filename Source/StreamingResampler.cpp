@@ -0,0 +1,127 @@
+// StreamingResampler.cpp
+#include "StreamingResampler.h"
+#include "ResizeKernels.h"
+
+CStreamingResampler::CStreamingResampler()
+{
+	m_uSrcWidth = m_uSrcHeight = 0;
+	m_uDstWidth = m_uDstHeight = 0;
+	m_uRowsPushed = m_uRowsEmitted = 0;
+	m_uRingRows = 0;
+}
+
+CStreamingResampler::~CStreamingResampler()
+{
+}
+
+bool CStreamingResampler::Begin(CGenericFilter *pFilter, unsigned int src_width, unsigned int src_height,
+	unsigned int dst_width, unsigned int dst_height, const ROW_SINK &fnSink)
+{
+	m_pHorzWeights.reset();
+	m_pVertWeights.reset();
+	m_Ring.clear();
+	m_OutRow.clear();
+	m_uRowsPushed = m_uRowsEmitted = 0;
+	m_uDstHeight = 0;
+
+	if (!pFilter || !src_width || !src_height || !dst_width || !dst_height)
+		return false;
+
+	m_fnSink = fnSink;
+	m_uSrcWidth = src_width;
+	m_uSrcHeight = src_height;
+	m_uDstWidth = dst_width;
+	m_uDstHeight = dst_height;
+
+	// same sizes are plain copies, exactly like the full resampler
+	if (dst_width != src_width)
+		m_pHorzWeights = CWeightsTable::Acquire(pFilter, dst_width, src_width);
+
+	if (dst_height != src_height)
+	{
+		m_pVertWeights = CWeightsTable::Acquire(pFilter, dst_height, src_height);
+
+		// Rows are emitted in order, so destination row y is produced right
+		// after the highest right bound seen up to y arrives. The ring must
+		// reach back from there to y's left bound.
+		int iMaxRight = 0;
+		m_uRingRows = 1;
+		for (UINT y = 0; y < dst_height; y++)
+		{
+			iMaxRight = max(iMaxRight, m_pVertWeights->getRightBoundary(y));
+			UINT uSpan = UINT(iMaxRight - m_pVertWeights->getLeftBoundary(y) + 1);
+			m_uRingRows = max(m_uRingRows, uSpan);
+		}
+
+		m_Taps.resize(m_pVertWeights->getWindowSize());
+		m_OutRow.resize(dst_width);
+	}
+	else
+	{
+		m_uRingRows = 1;
+	}
+
+	m_Ring.resize(m_uRingRows * dst_width);
+	return true;
+}
+
+bool CStreamingResampler::PushRow(const RGBQUAD *pSrcRow)
+{
+	if (m_uRowsPushed >= m_uSrcHeight || m_Ring.empty())
+		return false;
+
+	if (m_uRowsEmitted == m_uDstHeight)
+	{
+		// trailing rows outside every destination row's support
+		m_uRowsPushed++;
+		return true;
+	}
+
+	RGBQUAD *pSlot = &m_Ring[(m_uRowsPushed % m_uRingRows) * m_uDstWidth];
+	if (m_pHorzWeights)
+		GetHorizontalKernel()(pSrcRow, pSlot, m_uDstWidth, m_pHorzWeights.get());
+	else
+		memcpy(pSlot, pSrcRow, sizeof(RGBQUAD) * m_uDstWidth);
+
+	m_uRowsPushed++;
+	EmitReadyRows();
+	return true;
+}
+
+void CStreamingResampler::EmitReadyRows()
+{
+	if (!m_pVertWeights)
+	{
+		// no vertical scaling, every filtered row is a destination row
+		m_fnSink(m_uRowsEmitted, &m_Ring[0]);
+		m_uRowsEmitted++;
+		return;
+	}
+
+	VERTICAL_KERNEL pfnKernel = GetVerticalKernel();
+	while (m_uRowsEmitted < m_uDstHeight)
+	{
+		UINT y = m_uRowsEmitted;
+		int iLeft = m_pVertWeights->getLeftBoundary(y);
+		int iRight = m_pVertWeights->getRightBoundary(y);
+		if (iRight >= int(m_uRowsPushed))
+			break;	// support not complete yet
+
+		int iTaps = iRight - iLeft + 1;
+		for (int i = 0; i < iTaps; i++)
+		{
+			m_Taps[i] = &m_Ring[((iLeft + i) % m_uRingRows) * m_uDstWidth];
+		}
+
+		pfnKernel(&m_Taps[0], m_pVertWeights->getFixedWeights(y), iTaps, &m_OutRow[0], m_uDstWidth);
+		m_fnSink(y, &m_OutRow[0]);
+		m_uRowsEmitted++;
+	}
+
+	if (m_uRowsEmitted == m_uDstHeight)
+	{
+		// done, let go of the shared tables
+		m_pHorzWeights.reset();
+		m_pVertWeights.reset();
+	}
+}
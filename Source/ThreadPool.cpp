@@ -0,0 +1,122 @@
+// ThreadPool.cpp
+#include "ThreadPool.h"
+
+CThreadPool::CThreadPool(unsigned int uWorkers)
+{
+	m_uWorkers = uWorkers ? uWorkers : 1;
+	m_bQuit = false;
+	m_uGeneration = 0;
+	m_uBusy = 0;
+	m_pfnBand = NULL;
+	m_uBegin = m_uBandSize = m_uBandCount = m_uEnd = 0;
+	m_uNextBand = 0;
+
+	// the thread calling ParallelFor is the last worker
+	for (unsigned int i = 1; i < m_uWorkers; i++)
+		m_Threads.push_back(std::thread(&CThreadPool::WorkerLoop, this));
+}
+
+CThreadPool::~CThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_bQuit = true;
+	}
+	m_WakeWorkers.notify_all();
+
+	for (size_t i = 0; i < m_Threads.size(); i++)
+		m_Threads[i].join();
+}
+
+unsigned int CThreadPool::HardwareWorkers()
+{
+	unsigned int uCount = std::thread::hardware_concurrency();
+	return uCount ? uCount : 1;
+}
+
+void CThreadPool::RunBands()
+{
+	// bands are claimed dynamically, but each band always covers the same range
+	for (;;)
+	{
+		unsigned int uBand = m_uNextBand++;
+		if (uBand >= m_uBandCount)
+			break;
+
+		unsigned int uBegin = m_uBegin + uBand * m_uBandSize;
+		unsigned int uEnd = uBegin + m_uBandSize;
+		if (uEnd > m_uEnd)
+			uEnd = m_uEnd;
+
+		(*m_pfnBand)(uBegin, uEnd);
+	}
+}
+
+void CThreadPool::WorkerLoop()
+{
+	unsigned int uSeen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Lock);
+			while (!m_bQuit && m_uGeneration == uSeen)
+				m_WakeWorkers.wait(lock);
+
+			if (m_bQuit)
+				return;
+
+			uSeen = m_uGeneration;
+		}
+
+		RunBands();
+
+		std::lock_guard<std::mutex> lock(m_Lock);
+		if (--m_uBusy == 0)
+			m_JobDone.notify_one();
+	}
+}
+
+void CThreadPool::ParallelFor(unsigned int uBegin, unsigned int uEnd, unsigned int uGrain, const BAND_FUNC &fnBand)
+{
+	if (uEnd <= uBegin)
+		return;
+
+	unsigned int uCount = uEnd - uBegin;
+	if (uGrain == 0)
+		uGrain = 1;
+
+	// a few bands per worker keeps everybody busy when bands cost unevenly
+	unsigned int uBandSize = (uCount + m_uWorkers * 4 - 1) / (m_uWorkers * 4);
+	if (uBandSize < uGrain)
+		uBandSize = uGrain;
+
+	unsigned int uBandCount = (uCount + uBandSize - 1) / uBandSize;
+	if (m_Threads.empty() || uBandCount == 1)
+	{
+		// nothing to share, stay on this thread
+		fnBand(uBegin, uEnd);
+		return;
+	}
+
+	std::lock_guard<std::mutex> job(m_JobLock);
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_pfnBand = &fnBand;
+		m_uBegin = uBegin;
+		m_uEnd = uEnd;
+		m_uBandSize = uBandSize;
+		m_uBandCount = uBandCount;
+		m_uNextBand = 0;
+		m_uBusy = (unsigned int)m_Threads.size();
+		m_uGeneration++;
+	}
+	m_WakeWorkers.notify_all();
+
+	RunBands();
+
+	std::unique_lock<std::mutex> lock(m_Lock);
+	while (m_uBusy != 0)
+		m_JobDone.wait(lock);
+
+	m_pfnBand = NULL;
+}
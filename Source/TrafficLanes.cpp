@@ -0,0 +1,283 @@
+// TrafficLanes.cpp
+#include "TrafficLanes.h"
+#include <algorithm>
+#include <math.h>
+
+// Distances in pixels, speeds in pixels per second
+#define TRAFFIC_FOLLOW_GAP			60		// room kept to the car ahead
+#define TRAFFIC_FOLLOW_RATE			2.0		// speed given up per pixel short of it
+#define TRAFFIC_ACCELERATION		40.0	// per second
+#define TRAFFIC_BRAKING				400.0
+#define TRAFFIC_LOOK_AHEAD			120		// closer than this to a slower car, overtake
+#define TRAFFIC_OVERTAKE_MARGIN		5.0		// when it is this much slower
+#define TRAFFIC_MIN_GAP				40		// room left when pulling in ahead of a car
+#define TRAFFIC_LANE_CHANGE_SPEED	120.0
+
+CTrafficLanes::CTrafficLanes()
+{
+	m_uStamp = 0;
+	m_uLaneChanges = 0;
+}
+
+void CTrafficLanes::Start(const double *pLaneX, int nLanes)
+{
+	m_LaneX.assign(pLaneX, pLaneX + nLanes);
+	m_Queues.resize(nLanes);
+	for(int l = 0; l < nLanes; l++)
+		m_Queues[l].clear();
+
+	// Neighbours by position, the lanes may be listed in any order
+	std::vector<int> order(nLanes);
+	for(int l = 0; l < nLanes; l++)
+		order[l] = l;
+	for(int a = 1; a < nLanes; a++)
+	{
+		for(int b = a; b > 0 && m_LaneX[order[b]] < m_LaneX[order[b - 1]]; b--)
+			std::swap(order[b], order[b - 1]);
+	}
+
+	m_Left.assign(nLanes, -1);
+	m_Right.assign(nLanes, -1);
+	for(int k = 0; k < nLanes; k++)
+	{
+		if(k > 0)
+			m_Left[order[k]] = order[k - 1];
+		if(k + 1 < nLanes)
+			m_Right[order[k]] = order[k + 1];
+	}
+}
+
+double CTrafficLanes::GetEntry(const CEntityStore &entities, int nLane, double dTop) const
+{
+	const std::vector<SEntityHandle> &queue = m_Queues[nLane];
+
+	for(size_t q = queue.size(); q > 0; q--)
+	{
+		if(!entities.IsValid(queue[q - 1]))
+			continue;
+
+		size_t uBack = entities.IndexOf(queue[q - 1]);
+		double dEntry = entities.PosY(uBack) - entities.HalfHeight(uBack) - TRAFFIC_MIN_GAP;
+		return dEntry < dTop ? dEntry : dTop;
+	}
+
+	return dTop;
+}
+
+void CTrafficLanes::Add(SEntityHandle h, int nLane, double dCruise)
+{
+	if(h.uSlot >= m_Cars.size())
+		m_Cars.resize(h.uSlot + 1);
+
+	SCar &car = m_Cars[h.uSlot];
+	car.h = h;
+	car.dCruise = dCruise;
+	car.nLane = nLane;
+	car.nFromLane = -1;
+	car.uStamp = m_uStamp;
+
+	m_Queues[nLane].push_back(h);
+}
+
+void CTrafficLanes::Drive(CEntityStore &entities, double dt)
+{
+	int nLanes = GetLaneCount();
+	m_uStamp++;
+
+	// Removed cars leave their lanes
+	for(int l = 0; l < nLanes; l++)
+	{
+		std::vector<SEntityHandle> &queue = m_Queues[l];
+		size_t uKept = 0;
+		for(size_t q = 0; q < queue.size(); q++)
+		{
+			if(entities.IsValid(queue[q]))
+				queue[uKept++] = queue[q];
+		}
+		queue.resize(uKept);
+	}
+
+	// Every car once, furthest down the road first, so the cars ahead of
+	// one already have their speed for the step when it looks at them
+	m_Cursor.assign(nLanes, 0);
+	m_Order.clear();
+	for(;;)
+	{
+		int nNext = -1;
+		double dNextY = 0;
+		for(int l = 0; l < nLanes; l++)
+		{
+			if(m_Cursor[l] == m_Queues[l].size())
+				continue;
+
+			double y = entities.PosY(entities.IndexOf(m_Queues[l][m_Cursor[l]]));
+			if(nNext < 0 || y > dNextY)
+			{
+				nNext = l;
+				dNextY = y;
+			}
+		}
+		if(nNext < 0)
+			break;
+
+		SEntityHandle h = m_Queues[nNext][m_Cursor[nNext]++];
+		SCar &car = m_Cars[h.uSlot];
+
+		// The other lane of a car changing lanes
+		if(car.uStamp == m_uStamp)
+			continue;
+
+		car.uStamp = m_uStamp;
+		m_Order.push_back(h);
+		Follow(entities, entities.IndexOf(h), car, dt);
+	}
+
+	// Lane changes reorder the queues, so they come once every car has its speed
+	for(size_t o = 0; o < m_Order.size(); o++)
+		ChangeLanes(entities, entities.IndexOf(m_Order[o]), m_Cars[m_Order[o].uSlot], dt);
+}
+
+size_t CTrafficLanes::Find(const CEntityStore &entities, int nLane, double y) const
+{
+	const std::vector<SEntityHandle> &queue = m_Queues[nLane];
+	size_t uFirst = 0, uCount = queue.size();
+
+	while(uCount > 0)
+	{
+		size_t uHalf = uCount / 2;
+		if(entities.PosY(entities.IndexOf(queue[uFirst + uHalf])) > y)
+		{
+			uFirst += uHalf + 1;
+			uCount -= uHalf + 1;
+		}
+		else
+		{
+			uCount = uHalf;
+		}
+	}
+
+	return uFirst;
+}
+
+void CTrafficLanes::Remove(const CEntityStore &entities, int nLane, SEntityHandle h)
+{
+	std::vector<SEntityHandle> &queue = m_Queues[nLane];
+
+	for(size_t q = Find(entities, nLane, entities.PosY(entities.IndexOf(h))); q < queue.size(); q++)
+	{
+		if(queue[q].uSlot == h.uSlot && queue[q].uGeneration == h.uGeneration)
+		{
+			queue.erase(queue.begin() + q);
+			return;
+		}
+	}
+}
+
+double CTrafficLanes::Gap(const CEntityStore &entities, size_t uAhead, size_t uCar)
+{
+	return (entities.PosY(uAhead) - entities.HalfHeight(uAhead)) - (entities.PosY(uCar) + entities.HalfHeight(uCar));
+}
+
+void CTrafficLanes::Follow(CEntityStore &entities, size_t uCar, const SCar &car, double dt)
+{
+	// Wrecks stay where they are
+	if(entities.Flags(uCar) & EEF_EXPLODING)
+		return;
+
+	double dTarget = car.dCruise;
+	double dLimit = HUGE_VAL;
+	int lanes[2] = { car.nLane, car.nFromLane };
+
+	for(int k = 0; k < 2; k++)
+	{
+		if(lanes[k] < 0)
+			continue;
+
+		size_t q = Find(entities, lanes[k], entities.PosY(uCar));
+		if(!q)
+			continue;
+
+		size_t uAhead = entities.IndexOf(m_Queues[lanes[k]][q - 1]);
+		double dGap = Gap(entities, uAhead, uCar);
+		double dAheadVelocity = entities.VelY(uAhead);
+
+		// Slower as the gap closes, down to the speed of the car ahead at
+		// the following distance, and never into it within the step
+		dTarget = std::min(dTarget, dAheadVelocity + (dGap - TRAFFIC_FOLLOW_GAP) * TRAFFIC_FOLLOW_RATE);
+		dLimit = std::min(dLimit, dAheadVelocity + dGap / dt);
+	}
+
+	double v = entities.VelY(uCar);
+	if(dTarget > v)
+		v = std::min(dTarget, v + TRAFFIC_ACCELERATION * dt);
+	else
+		v = std::max(dTarget, v - TRAFFIC_BRAKING * dt);
+
+	entities.VelY(uCar) = std::max(std::min(v, dLimit), 0.0);
+}
+
+void CTrafficLanes::ChangeLanes(CEntityStore &entities, size_t uCar, SCar &car, double dt)
+{
+	if(entities.Flags(uCar) & EEF_EXPLODING)
+		return;
+
+	if(car.nFromLane >= 0)
+	{
+		double dx = m_LaneX[car.nLane] - entities.PosX(uCar);
+
+		// Across, the lane it left lets it go
+		if(fabs(dx) < 1e-6)
+		{
+			entities.PosX(uCar) = m_LaneX[car.nLane];
+			entities.VelX(uCar) = 0;
+			Remove(entities, car.nFromLane, car.h);
+			car.nFromLane = -1;
+			return;
+		}
+
+		double dStep = TRAFFIC_LANE_CHANGE_SPEED * dt;
+		entities.VelX(uCar) = std::max(std::min(dx, dStep), -dStep) / dt;
+		return;
+	}
+
+	// Held up by a slower car, overtake on the left if there is room, else
+	// on the right
+	size_t q = Find(entities, car.nLane, entities.PosY(uCar));
+	if(!q)
+		return;
+
+	size_t uAhead = entities.IndexOf(m_Queues[car.nLane][q - 1]);
+	double dAheadVelocity = entities.VelY(uAhead);
+	if(Gap(entities, uAhead, uCar) > TRAFFIC_LOOK_AHEAD || dAheadVelocity > car.dCruise - TRAFFIC_OVERTAKE_MARGIN)
+		return;
+
+	if(!TryLane(entities, uCar, car, m_Left[car.nLane], dAheadVelocity))
+		TryLane(entities, uCar, car, m_Right[car.nLane], dAheadVelocity);
+}
+
+bool CTrafficLanes::TryLane(CEntityStore &entities, size_t uCar, SCar &car, int nLane, double dLeaderVelocity)
+{
+	if(nLane < 0)
+		return false;
+
+	std::vector<SEntityHandle> &queue = m_Queues[nLane];
+	size_t q = Find(entities, nLane, entities.PosY(uCar));
+
+	// Room ahead, and nothing there as slow as the car it is stuck behind
+	if(q > 0)
+	{
+		size_t uAhead = entities.IndexOf(queue[q - 1]);
+		if(Gap(entities, uAhead, uCar) < TRAFFIC_LOOK_AHEAD || entities.VelY(uAhead) <= dLeaderVelocity)
+			return false;
+	}
+
+	// and room to pull in ahead of the car behind
+	if(q < queue.size() && Gap(entities, uCar, entities.IndexOf(queue[q])) < TRAFFIC_MIN_GAP)
+		return false;
+
+	queue.insert(queue.begin() + q, car.h);
+	car.nFromLane = car.nLane;
+	car.nLane = nLane;
+	m_uLaneChanges++;
+	return true;
+}
@@ -0,0 +1,75 @@
+// TrafficPlan.cpp
+#include "TrafficPlan.h"
+#include <algorithm>
+
+static bool CloserSlot(const STrafficSlot &a, const STrafficSlot &b)
+{
+	// Lanes break ties so every platform sorts the same way
+	if(a.dDistance != b.dDistance)
+		return a.dDistance < b.dDistance;
+	return a.nLane < b.nLane;
+}
+
+CTrafficPlan::CTrafficPlan()
+{
+	m_dSpacing = 1.0;
+	m_dGap = 0.0;
+	m_dPlanned = 0.0;
+}
+
+void CTrafficPlan::Start(int nLanes, double dSpacing, double dGap)
+{
+	m_dSpacing = dSpacing;
+	m_dGap = dGap;
+	m_dPlanned = 0.0;
+	m_LaneFree.assign(nLanes > 0 ? nLanes : 1, 0.0);
+}
+
+void CTrafficPlan::Plan(CRandom &random, int nCars, std::vector<STrafficSlot> &slots)
+{
+	if(nCars <= 0)
+		return;
+
+	size_t uFirst = slots.size();
+	int nLanes = (int)m_LaneFree.size();
+	double dEnd = m_dPlanned + nCars * m_dSpacing;
+	double dLast = dEnd;
+
+	m_LaneCount.assign(nLanes, 0);
+	for(int c = 0; c < nCars; c++)
+		m_LaneCount[random.Below(nLanes)]++;
+
+	for(int l = 0; l < nLanes; l++)
+	{
+		int nCount = m_LaneCount[l];
+		if(!nCount)
+			continue;
+
+		// Room to spread the lane's cars over once each has its gap. A lane
+		// dealt more cars than fit gets them a gap apart, running on past
+		// the end of the batch.
+		double dStart = std::max(m_dPlanned, m_LaneFree[l]);
+		double dRoom = std::max(dEnd - dStart - (nCount - 1) * m_dGap, 0.0);
+
+		m_Offsets.resize(nCount);
+		for(int c = 0; c < nCount; c++)
+			m_Offsets[c] = random.NextDouble() * dRoom;
+		std::sort(m_Offsets.begin(), m_Offsets.end());
+
+		for(int c = 0; c < nCount; c++)
+		{
+			STrafficSlot slot;
+			slot.dDistance = dStart + m_Offsets[c] + c * m_dGap;
+			slot.nLane = l;
+			slots.push_back(slot);
+		}
+
+		double dLaneLast = slots.back().dDistance;
+		m_LaneFree[l] = dLaneLast + m_dGap;
+		dLast = std::max(dLast, dLaneLast);
+	}
+
+	// The next batch starts after every car of this one
+	m_dPlanned = dLast;
+	std::sort(slots.begin() + uFirst, slots.end(), CloserSlot);
+}
@@ -0,0 +1,255 @@
+// AtlasPacker.cpp
+// Offline tool: packs loose sprite bitmaps into a few atlas pages and
+// writes the binary index (see AtlasIndex.h) the game loads at startup.
+//
+// Build (any platform, from the repository root):
+//	g++ -std=c++14 -O2 -IIncludes Tools/AtlasPacker/AtlasPacker.cpp Source/AtlasIndex.cpp Source/BmpCodec.cpp -o atlaspacker
+//
+// Usage:
+//	atlaspacker [-s page_size] [-p padding] [-k rrggbb] -o data/sprites.atlas data/car1.bmp data/numbers/0.bmp ...
+//
+// Entries are keyed by the paths exactly as given (normalized), so run it
+// from the directory the game runs in and pass the paths the game uses.
+// Pages are written next to the index as <index name>_<n>.bmp, 24-bit,
+// with unused space filled with the transparent colour.
+//
+// The shipped data/sprites.atlas holds the sprites drawn every frame (cars,
+// bullet, power-ups, digits and HUD text). Rebuild it after changing one,
+// from the directory holding data/:
+//	atlaspacker -o data/sprites.atlas data/car2.bmp data/car6.bmp data/police.bmp
+//		data/car4.bmp data/car4r.bmp data/car4rr.bmp data/car4rrr.bmp data/car5.bmp
+//		data/bullet.bmp data/doubler.bmp data/heart.bmp data/gun.bmp data/shield.bmp
+//		data/numbers/0.bmp ... data/numbers/9.bmp data/lives_text.bmp data/score_text.bmp
+//		data/shoot_text.bmp data/shootsel_text.bmp data/shield_text.bmp
+//		data/shieldsel_text.bmp data/doublepoints_text.bmp data/doublepointssel_text.bmp
+// Menu text, level labels and the end screens are left out, they are
+// drawn rarely.
+#include "AtlasIndex.h"
+#include "BmpCodec.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+struct SInputImage
+{
+	std::string strName;
+	LONG lWidth;
+	LONG lHeight;
+	RGBQUAD *pPixels;		// bottom-up, as BmpLoadFile returns it
+	WORD uPage;
+	LONG x, y;				// top-left corner in the page, top-down
+};
+
+struct SPage
+{
+	LONG lWidth;
+	LONG lHeight;
+};
+
+static bool TallerFirst(const SInputImage *a, const SInputImage *b)
+{
+	if(a->lHeight != b->lHeight)
+		return a->lHeight > b->lHeight;
+	if(a->lWidth != b->lWidth)
+		return a->lWidth > b->lWidth;
+	return a->strName < b->strName;
+}
+
+// Shelf packing: images sorted by height fill rows left to right, a new
+// shelf starts below the tallest image of the previous one.
+static void PackShelves(std::vector<SInputImage*> &images, LONG lPageSize, LONG lPadding, std::vector<SPage> &pages)
+{
+	LONG x = 0, y = 0, lShelfHeight = 0;
+	bool bNewPage = true;
+
+	std::sort(images.begin(), images.end(), TallerFirst);
+
+	for(size_t i = 0; i < images.size(); i++)
+	{
+		SInputImage *pImage = images[i];
+		LONG w = pImage->lWidth + lPadding;
+		LONG h = pImage->lHeight + lPadding;
+
+		if(pImage->lWidth > lPageSize || pImage->lHeight > lPageSize)
+		{
+			// too big to share, give it a page of its own
+			SPage page = { pImage->lWidth, pImage->lHeight };
+			pages.push_back(page);
+			pImage->uPage = (WORD)(pages.size() - 1);
+			pImage->x = pImage->y = 0;
+
+			// continue on a fresh page afterwards
+			bNewPage = true;
+			continue;
+		}
+
+		if(!bNewPage && x + pImage->lWidth > lPageSize)
+		{
+			// next shelf
+			x = 0;
+			y += lShelfHeight;
+			lShelfHeight = 0;
+		}
+
+		if(bNewPage || y + pImage->lHeight > lPageSize)
+		{
+			SPage page = { 0, 0 };
+			pages.push_back(page);
+			x = y = lShelfHeight = 0;
+			bNewPage = false;
+		}
+
+		SPage &page = pages.back();
+		pImage->uPage = (WORD)(pages.size() - 1);
+		pImage->x = x;
+		pImage->y = y;
+
+		page.lWidth = std::max(page.lWidth, x + pImage->lWidth);
+		page.lHeight = std::max(page.lHeight, y + pImage->lHeight);
+
+		x += w;
+		lShelfHeight = std::max(lShelfHeight, h);
+	}
+}
+
+static void Usage()
+{
+	fprintf(stderr, "usage: atlaspacker [-s page_size] [-p padding] [-k rrggbb] -o index.atlas image.bmp...\n");
+}
+
+int main(int argc, char **argv)
+{
+	LONG lPageSize = 1024;
+	LONG lPadding = 1;
+	COLORREF crKey = RGB(0xff, 0x00, 0xff);
+	const char *szOutput = NULL;
+	std::vector<SInputImage> inputs;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "-s") && i + 1 < argc)
+			lPageSize = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-p") && i + 1 < argc)
+			lPadding = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-k") && i + 1 < argc)
+		{
+			unsigned long rgb = strtoul(argv[++i], NULL, 16);
+			crKey = RGB((rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff);
+		}
+		else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+			szOutput = argv[++i];
+		else if(argv[i][0] == '-')
+		{
+			Usage();
+			return 1;
+		}
+		else
+		{
+			SInputImage image;
+			image.strName = argv[i];
+			image.pPixels = NULL;
+			inputs.push_back(image);
+		}
+	}
+
+	if(!szOutput || inputs.empty() || lPageSize <= 0 || lPageSize > 0xFFFF || lPadding < 0)
+	{
+		Usage();
+		return 1;
+	}
+
+	std::vector<SInputImage*> images;
+	for(size_t i = 0; i < inputs.size(); i++)
+	{
+		BITMAPINFOHEADER bi;
+		if(BmpLoadFile(inputs[i].strName.c_str(), bi, inputs[i].pPixels) != EBR_OK)
+		{
+			fprintf(stderr, "atlaspacker: cannot read %s\n", inputs[i].strName.c_str());
+			return 1;
+		}
+
+		if(bi.biWidth > 0xFFFF || bi.biHeight > 0xFFFF)
+		{
+			fprintf(stderr, "atlaspacker: %s is too large\n", inputs[i].strName.c_str());
+			return 1;
+		}
+
+		inputs[i].lWidth = bi.biWidth;
+		inputs[i].lHeight = bi.biHeight;
+		images.push_back(&inputs[i]);
+	}
+
+	std::vector<SPage> pages;
+	PackShelves(images, lPageSize, lPadding, pages);
+
+	// page names are relative to the index, so strip its directory
+	std::string strOutput(szOutput);
+	size_t uSlash = strOutput.find_last_of("/\\");
+	std::string strDir = uSlash == std::string::npos ? "" : strOutput.substr(0, uSlash + 1);
+	std::string strBase = strOutput.substr(strDir.size());
+	size_t uDot = strBase.find_last_of('.');
+	if(uDot != std::string::npos)
+		strBase.erase(uDot);
+
+	CAtlasIndex index;
+	RGBQUAD key = { GetBValue(crKey), GetGValue(crKey), GetRValue(crKey), 0 };
+
+	for(size_t p = 0; p < pages.size(); p++)
+	{
+		const SPage &page = pages[p];
+		std::vector<RGBQUAD> pixels(page.lWidth * page.lHeight, key);
+
+		for(size_t i = 0; i < images.size(); i++)
+		{
+			const SInputImage *pImage = images[i];
+			if(pImage->uPage != p)
+				continue;
+
+			// both buffers are bottom-up, the placement is top-down
+			for(LONG r = 0; r < pImage->lHeight; r++)
+			{
+				LONG lPageRow = page.lHeight - 1 - (pImage->y + pImage->lHeight - 1 - r);
+				memcpy(&pixels[lPageRow * page.lWidth + pImage->x], pImage->pPixels + r * pImage->lWidth,
+					pImage->lWidth * sizeof(RGBQUAD));
+			}
+		}
+
+		char szSuffix[32];
+		sprintf(szSuffix, "_%u.bmp", (unsigned)p);
+		std::string strPage = strBase + szSuffix;
+
+		if(BmpSaveFile((strDir + strPage).c_str(), &pixels[0], page.lWidth, page.lHeight, 24) != EBR_OK)
+		{
+			fprintf(stderr, "atlaspacker: cannot write %s%s\n", strDir.c_str(), strPage.c_str());
+			return 1;
+		}
+
+		index.AddPage(strPage);
+		printf("page %u: %dx%d\n", (unsigned)p, (int)page.lWidth, (int)page.lHeight);
+	}
+
+	for(size_t i = 0; i < images.size(); i++)
+	{
+		SAtlasEntry e;
+		e.strName = images[i]->strName;
+		e.uPage = images[i]->uPage;
+		e.rcSource.left = images[i]->x;
+		e.rcSource.top = images[i]->y;
+		e.rcSource.right = images[i]->x + images[i]->lWidth;
+		e.rcSource.bottom = images[i]->y + images[i]->lHeight;
+		e.crTransparent = crKey;
+		index.AddEntry(e);
+
+		delete[] images[i]->pPixels;
+	}
+
+	if(!index.Save(szOutput))
+	{
+		fprintf(stderr, "atlaspacker: cannot write %s\n", szOutput);
+		return 1;
+	}
+
+	printf("%u images in %u pages\n", (unsigned)images.size(), (unsigned)pages.size());
+	return 0;
+}
@@ -0,0 +1,331 @@
+// ResizeBench.cpp
+// Times CResizableImage on one bitmap scaled to common monitor sizes: the
+// ERM_DOUBLE reference path against ERM_FIXEDPOINT with each kernel level
+// (scalar, SSE2, AVX2) the CPU supports. Every fixed-point level gives the
+// same pixels, so only the time differs.
+//
+// With -o the image is instead resized to one size through
+// CStreamingResampler: rows are read with CBmpReader, pushed one at a time
+// and written with CBmpWriter as they come out. The written file is then
+// checked against CResizableImage::Resample on the same input, and the
+// memory both ways is reported; the exit code is 1 if any pixel differs.
+//
+// Build (Visual Studio command prompt, from the repository root; the image
+// classes need <windows.h>):
+//	cl /O2 /EHsc /IIncludes Tools\ResizeBench\ResizeBench.cpp Source\ResizeEngine.cpp Source\ResizeKernels.cpp Source\StreamingResampler.cpp Source\ThreadPool.cpp Source\ImageFile.cpp Source\BmpCodec.cpp Source\MappedFile.cpp gdi32.lib user32.lib /Feresizebench.exe
+//
+// Usage:
+//	resizebench [-i image.bmp] [-f filter] [-n runs] [-j workers] [WxH ...]
+//	resizebench [-i image.bmp] [-f filter] -o out.bmp WxH
+//
+// The image defaults to Data/Background.bmp, the filter to lanczos3 (also
+// box, bilinear, bicubic, bspline), the sizes to 1280x720 1366x768
+// 1920x1080 2560x1440 3840x2160. Each size is resized -n times (default 5)
+// from a freshly loaded image and the fastest run is reported, on one
+// thread unless -j says otherwise.
+#include "ResizeEngine.h"
+#include "ResizeKernels.h"
+#include "StreamingResampler.h"
+#include "BmpCodec.h"
+#include <chrono>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+struct SBenchSize
+{
+	unsigned int uWidth;
+	unsigned int uHeight;
+};
+
+struct SBenchPath
+{
+	const char *szName;
+	EResampleMode eMode;
+	EResizeKernel eKernel;
+};
+
+static const SBenchPath s_Paths[] =
+{
+	{ "double",		ERM_DOUBLE,		ERK_SCALAR },
+	{ "fixed",		ERM_FIXEDPOINT,	ERK_SCALAR },
+	{ "sse2",		ERM_FIXEDPOINT,	ERK_SSE2 },
+	{ "avx2",		ERM_FIXEDPOINT,	ERK_AVX2 },
+};
+
+static void Usage()
+{
+	fprintf(stderr, "usage: resizebench [-i image.bmp] [-f box|bilinear|bicubic|lanczos3|bspline] [-n runs] [-j workers] [WxH ...]\n");
+	fprintf(stderr, "       resizebench [-i image.bmp] [-f filter] -o out.bmp WxH\n");
+}
+
+static CGenericFilter *MakeFilter(const char *szName)
+{
+	if(!strcmp(szName, "box"))			return new CBoxFilter();
+	if(!strcmp(szName, "bilinear"))		return new CBilinearFilter();
+	if(!strcmp(szName, "bicubic"))		return new CBicubicFilter();
+	if(!strcmp(szName, "lanczos3"))		return new CLanczos3Filter();
+	if(!strcmp(szName, "bspline"))		return new CBSplineFilter();
+	return NULL;
+}
+
+// Fastest of uRuns resizes to one size, in seconds; negative if the image
+// cannot be read
+static double TimeResize(const char *szImage, CGenericFilter *pFilter, const SBenchPath &path,
+	const SBenchSize &size, unsigned int uRuns, unsigned int uWorkers)
+{
+	double dBest = -1;
+
+	for(unsigned int r = 0; r < uRuns; r++)
+	{
+		CResizableImage image;
+		if(!image.LoadBitmapFromFile(szImage, NULL))
+			return -1;
+
+		image.SetFilter(pFilter);
+		image.SetMode(path.eMode);
+		image.SetWorkerCount(uWorkers);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		image.Resample(size.uWidth, size.uHeight);
+		double dTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if(dBest < 0 || dTime < dBest)
+			dBest = dTime;
+	}
+
+	return dBest;
+}
+
+// Gives the tool the pixels Resample leaves behind
+class CBenchImage : public CResizableImage
+{
+public:
+	const RGBQUAD *GetPixels() { return EnsureDecoded() ? m_pRGB : NULL; }
+};
+
+// Streams szImage into szOutput at one size, then compares the file with
+// Resample on the same input. Returns the exit code.
+static int StreamResize(const char *szImage, const char *szOutput, CGenericFilter *pFilter, const SBenchSize &size)
+{
+	CBmpReader reader;
+	if(reader.Open(szImage) != EBR_OK)
+	{
+		fprintf(stderr, "resizebench: cannot read %s\n", szImage);
+		return 1;
+	}
+
+	const SBmpLayout &layout = reader.GetLayout();
+	CBmpWriter writer;
+	if(writer.Open(szOutput, size.uWidth, size.uHeight) != EBR_OK)
+	{
+		fprintf(stderr, "resizebench: cannot write %s\n", szOutput);
+		return 1;
+	}
+
+	// rows come out bottom first, in the order the writer takes them
+	bool bWritten = true;
+	CStreamingResampler resampler;
+	resampler.Begin(pFilter, layout.lWidth, layout.lHeight, size.uWidth, size.uHeight,
+		[&](unsigned int, const RGBQUAD *pRow) { bWritten = bWritten && writer.WriteRow(pRow) == EBR_OK; });
+
+	std::vector<RGBQUAD> srcRow(layout.lWidth);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(LONG y = 0; y < layout.lHeight; y++)
+	{
+		if(reader.ReadRow(&srcRow[0]) != EBR_OK)
+		{
+			fprintf(stderr, "resizebench: %s is truncated\n", szImage);
+			return 1;
+		}
+		resampler.PushRow(&srcRow[0]);
+	}
+	reader.Close();
+
+	if(!resampler.IsComplete() || !bWritten || writer.Close() != EBR_OK)
+	{
+		fprintf(stderr, "resizebench: cannot write %s\n", szOutput);
+		return 1;
+	}
+	double dStreamTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// the same resize in memory; the streaming path only has fixed-point kernels
+	CBenchImage image;
+	if(!image.LoadBitmapFromFile(szImage, NULL))
+	{
+		fprintf(stderr, "resizebench: cannot read %s\n", szImage);
+		return 1;
+	}
+	image.SetFilter(pFilter);
+	image.SetMode(ERM_FIXEDPOINT);
+	image.SetWorkerCount(1);
+
+	// Resample filters vertically first when that leaves the smaller
+	// intermediate image, which rounds differently. The streamed rows are
+	// always filtered horizontally first, so do the same in two calls.
+	bool bSplit = size.uHeight != (unsigned int)layout.lHeight &&
+		(unsigned long long)size.uWidth * layout.lHeight > (unsigned long long)size.uHeight * layout.lWidth;
+
+	start = std::chrono::steady_clock::now();
+	if(bSplit)
+		image.Resample(size.uWidth, layout.lHeight);
+	image.Resample(size.uWidth, size.uHeight);
+	double dResampleTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// read back what was written, the file is 24-bit so alpha is not compared
+	const RGBQUAD *pExpected = image.GetPixels();
+	std::vector<RGBQUAD> outRow(size.uWidth);
+	size_t uDiffering = 0;
+	int nMaxDiff = 0;
+
+	CBmpReader written;
+	if(!pExpected || written.Open(szOutput) != EBR_OK)
+	{
+		fprintf(stderr, "resizebench: cannot read back %s\n", szOutput);
+		return 1;
+	}
+	for(unsigned int y = 0; y < size.uHeight; y++)
+	{
+		if(written.ReadRow(&outRow[0]) != EBR_OK)
+		{
+			fprintf(stderr, "resizebench: cannot read back %s\n", szOutput);
+			return 1;
+		}
+
+		const RGBQUAD *pRow = pExpected + (size_t)y * size.uWidth;
+		for(unsigned int x = 0; x < size.uWidth; x++)
+		{
+			int nRed = abs(outRow[x].rgbRed - pRow[x].rgbRed);
+			int nGreen = abs(outRow[x].rgbGreen - pRow[x].rgbGreen);
+			int nBlue = abs(outRow[x].rgbBlue - pRow[x].rgbBlue);
+			if(nRed || nGreen || nBlue)
+				uDiffering++;
+			if(nRed > nMaxDiff)		nMaxDiff = nRed;
+			if(nGreen > nMaxDiff)	nMaxDiff = nGreen;
+			if(nBlue > nMaxDiff)	nMaxDiff = nBlue;
+		}
+	}
+
+	size_t uFullBytes = sizeof(RGBQUAD) * ((size_t)layout.lWidth * layout.lHeight + (size_t)size.uWidth * size.uHeight);
+
+	printf("%s, %ldx%ld -> %s, %ux%u\n", szImage, (long)layout.lWidth, (long)layout.lHeight, szOutput, size.uWidth, size.uHeight);
+	printf("streamed  %8.1f ms, %u ring rows, %lu buffer bytes\n", dStreamTime * 1000,
+		resampler.GetRingRows(), (unsigned long)resampler.GetBufferBytes());
+	printf("resample  %8.1f ms, %lu bytes of source and result%s\n", dResampleTime * 1000, (unsigned long)uFullBytes,
+		bSplit ? ", horizontal pass first" : "");
+	if(!uDiffering)
+		printf("identical to Resample\n");
+	else
+		printf("%lu pixels differ from Resample, by up to %d\n", (unsigned long)uDiffering, nMaxDiff);
+
+	return uDiffering ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *szImage = "Data/Background.bmp";
+	const char *szFilter = "lanczos3";
+	unsigned int uRuns = 5;
+	unsigned int uWorkers = 1;
+	const char *szOutput = NULL;
+	std::vector<SBenchSize> sizes;
+
+	for(int i = 1; i < argc; i++)
+	{
+		SBenchSize size;
+
+		if(!strcmp(argv[i], "-i") && i + 1 < argc)
+			szImage = argv[++i];
+		else if(!strcmp(argv[i], "-f") && i + 1 < argc)
+			szFilter = argv[++i];
+		else if(!strcmp(argv[i], "-n") && i + 1 < argc)
+			uRuns = (unsigned int)strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(argv[i], "-j") && i + 1 < argc)
+			uWorkers = (unsigned int)strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+			szOutput = argv[++i];
+		else if(sscanf(argv[i], "%ux%u", &size.uWidth, &size.uHeight) == 2 && size.uWidth && size.uHeight)
+			sizes.push_back(size);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	CGenericFilter *pFilter = MakeFilter(szFilter);
+	if(!pFilter || !uRuns || (szOutput && sizes.size() != 1))
+	{
+		Usage();
+		delete pFilter;
+		return 1;
+	}
+
+	if(szOutput)
+	{
+		int nResult = StreamResize(szImage, szOutput, pFilter, sizes[0]);
+		delete pFilter;
+		return nResult;
+	}
+
+	if(sizes.empty())
+	{
+		static const SBenchSize monitors[] = { { 1280, 720 }, { 1366, 768 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+		sizes.assign(monitors, monitors + sizeof(monitors) / sizeof(monitors[0]));
+	}
+
+	CResizableImage source;
+	if(!source.LoadBitmapFromFile(szImage, NULL))
+	{
+		fprintf(stderr, "resizebench: cannot read %s\n", szImage);
+		delete pFilter;
+		return 1;
+	}
+
+	EResizeKernel eBest = DetectResizeKernel();
+	int nPaths = sizeof(s_Paths) / sizeof(s_Paths[0]);
+
+	printf("%s, %ldx%ld, %s, best of %u on %u thread%s\n", szImage, (long)source.Width(), (long)source.Height(),
+		szFilter, uRuns, uWorkers, uWorkers == 1 ? "" : "s");
+	printf("%-10s", "size");
+	for(int p = 0; p < nPaths; p++)
+		printf(" | %8s ms  speedup", s_Paths[p].szName);
+	printf("\n");
+
+	for(size_t s = 0; s < sizes.size(); s++)
+	{
+		char szSize[32];
+		snprintf(szSize, sizeof(szSize), "%ux%u", sizes[s].uWidth, sizes[s].uHeight);
+		printf("%-10s", szSize);
+
+		double dReference = 0;
+		for(int p = 0; p < nPaths; p++)
+		{
+			if(s_Paths[p].eKernel > eBest)
+			{
+				printf(" | %20s", "not on this CPU");
+				continue;
+			}
+
+			SetResizeKernel(s_Paths[p].eKernel);
+			double dTime = TimeResize(szImage, pFilter, s_Paths[p], sizes[s], uRuns, uWorkers);
+			if(dTime < 0)
+			{
+				fprintf(stderr, "resizebench: cannot read %s\n", szImage);
+				delete pFilter;
+				return 1;
+			}
+
+			if(p == 0)
+				dReference = dTime;
+			printf(" | %11.1f  %6.2fx", dTime * 1000, dReference / dTime);
+			fflush(stdout);
+		}
+		printf("\n");
+	}
+
+	SetResizeKernel(eBest);
+	delete pFilter;
+	return 0;
+}
@@ -0,0 +1,499 @@
+// RoadSim.cpp
+// Runs the game simulation (CSimulation) without a window, as fast as the
+// CPU allows. A simple bot drives both players, or a recorded input log
+// (see InputLog.h) from the game or an earlier run. Useful for checking rule
+// changes, timing the simulation on identical sessions and looking at
+// frames of long runs or of a reported crash.
+//
+// Build (any platform, from the repository root):
+//	g++ -std=c++14 -O2 -IIncludes -ITools/RoadSim Tools/RoadSim/RoadSim.cpp Tools/RoadSim/SimBot.cpp Source/Simulation.cpp Source/TrafficPlan.cpp Source/TrafficLanes.cpp Source/LevelFile.cpp Source/InputLog.cpp Source/EntityStore.cpp Source/BroadPhase.cpp Source/Framebuffer.cpp Source/BmpCodec.cpp -o roadsim
+//
+// Usage:
+//	roadsim [-n steps] [-s seed] [-e] [-r record.input] [-d data_dir] [-f every] [-o frame_dir]
+//	roadsim -p replay.input [-d data_dir] [-f every] [-o frame_dir]
+//	roadsim -b cars [-s seed]
+//	roadsim -t frames [-d data_dir]
+//
+// The bot plays the levels of <data_dir>/levels.txt, or with -e the infinite
+// road, until -n steps (default: ten minutes of game time) or until the game
+// is won or lost, -r logs its session. -p replays a log to its end
+// and checks the final state against the one recorded (exit code 2 if they
+// differ). With -o, every -f'th step is drawn with the game's bitmaps from
+// -d and written as <frame_dir>/frame_<step>.bmp. -b times the traffic
+// planner (see TrafficPlan.h) on that many cars, all at once and in the
+// game's batches, and checks the cars are in order and never too close in
+// a lane (exit code 2 if not). -t times the software renderer (see
+// Framebuffer.h) over that many frames: a scrolling full-screen Blit, then
+// every sprite of -d drawn with DrawSprite.
+#include "Simulation.h"
+#include "InputLog.h"
+#include "SimBot.h"
+#include "LevelFile.h"
+#include "TrafficPlan.h"
+#include "Framebuffer.h"
+#include "BmpCodec.h"
+#include <chrono>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+class CSoundCounter : public CSimAudio
+{
+public:
+	CSoundCounter() { memset(m_uCounts, 0, sizeof(m_uCounts)); }
+
+	void PlayEffect(ESimSound eSound) { m_uCounts[eSound]++; }
+
+	unsigned long m_uCounts[ESS_LEVEL_FINISHED + 1];
+};
+
+// Draws the reported objects into a framebuffer with the game's bitmaps
+class CFrameRenderer : public CSimRenderer
+{
+public:
+	bool Load(const std::string &strData)
+	{
+		static const char *szPlayers[SIM_PLAYERS] = { "car4.bmp", "car5.bmp" };
+		static const char *szCars[ESC_COUNT] = { "car2.bmp", "car6.bmp", "police.bmp" };
+		static const char *szPowerUps[ESP_COUNT] = { "heart.bmp", "shield.bmp", "gun.bmp", "doubler.bmp" };
+
+		for(int n = 0; n < SIM_PLAYERS; n++)
+			if(!LoadSprite(strData + "/" + szPlayers[n], m_Players[n])) return false;
+		for(int m = 0; m < ESC_COUNT; m++)
+			if(!LoadSprite(strData + "/" + szCars[m], m_Cars[m])) return false;
+		for(int i = 0; i < ESP_COUNT; i++)
+			if(!LoadSprite(strData + "/" + szPowerUps[i], m_PowerUps[i])) return false;
+		if(!LoadSprite(strData + "/bullet.bmp", m_Bullet))
+			return false;
+
+		return LoadExplosion(strData + "/explosion.bmp", strData + "/explosionmask.bmp");
+	}
+
+	void DrawObject(ESimObject eObject, unsigned int uVariant, double x, double y)
+	{
+		const CRleSprite *pSprite = NULL;
+
+		switch(eObject)
+		{
+		case ESO_PLAYER:	pSprite = &m_Players[uVariant]; break;
+		case ESO_CAR:		pSprite = &m_Cars[uVariant]; break;
+		case ESO_BULLET:	pSprite = &m_Bullet; break;
+		case ESO_POWERUP:	pSprite = &m_PowerUps[uVariant]; break;
+		case ESO_EXPLOSION:	pSprite = &m_Explosion[uVariant]; break;
+		}
+
+		m_Target.DrawSprite(*pSprite, (LONG)(x - pSprite->Width() / 2), (LONG)(y - pSprite->Height() / 2));
+	}
+
+	// Every sprite once at a place on the target that moves with nFrame;
+	// returns the opaque pixels drawn
+	size_t DrawEverySprite(int nFrame)
+	{
+		const CRleSprite *pSprites[SIM_PLAYERS + ESC_COUNT + ESP_COUNT + 1 + 16];
+		int nCount = 0;
+		size_t uPixels = 0;
+
+		for(int n = 0; n < SIM_PLAYERS; n++)
+			pSprites[nCount++] = &m_Players[n];
+		for(int m = 0; m < ESC_COUNT; m++)
+			pSprites[nCount++] = &m_Cars[m];
+		for(int i = 0; i < ESP_COUNT; i++)
+			pSprites[nCount++] = &m_PowerUps[i];
+		pSprites[nCount++] = &m_Bullet;
+		for(int f = 0; f < 16; f++)
+			pSprites[nCount++] = &m_Explosion[f];
+
+		for(int s = 0; s < nCount; s++)
+		{
+			const CRleSprite &sprite = *pSprites[s];
+			LONG lRoomX = m_Target.Width() - sprite.Width() + 1;
+			LONG lRoomY = m_Target.Height() - sprite.Height() + 1;
+			if(lRoomX <= 0 || lRoomY <= 0)
+				continue;
+
+			m_Target.DrawSprite(sprite, (s * 211 + nFrame * 7) % lRoomX, (s * 97 + nFrame * 5) % lRoomY);
+			uPixels += sprite.OpaqueCount();
+		}
+
+		return uPixels;
+	}
+
+	CFramebuffer m_Target;
+
+private:
+	static bool LoadSprite(const std::string &strFile, CRleSprite &sprite)
+	{
+		BITMAPINFOHEADER bi;
+		RGBQUAD *pPixels;
+
+		if(BmpLoadFile(strFile.c_str(), bi, pPixels) != EBR_OK)
+		{
+			fprintf(stderr, "roadsim: cannot read %s\n", strFile.c_str());
+			return false;
+		}
+
+		sprite.Build(pPixels, bi.biWidth, bi.biHeight, true);
+		delete [] pPixels;
+		return true;
+	}
+
+	// 16 frames of 128 x 128 in rows of four, white in the mask is transparent
+	bool LoadExplosion(const std::string &strImage, const std::string &strMask)
+	{
+		BITMAPINFOHEADER bi, biMask;
+		RGBQUAD *pPixels, *pMask;
+
+		if(BmpLoadFile(strImage.c_str(), bi, pPixels) != EBR_OK)
+		{
+			fprintf(stderr, "roadsim: cannot read %s\n", strImage.c_str());
+			return false;
+		}
+		if(BmpLoadFile(strMask.c_str(), biMask, pMask) != EBR_OK || biMask.biWidth != bi.biWidth || biMask.biHeight != bi.biHeight)
+		{
+			fprintf(stderr, "roadsim: cannot read %s\n", strMask.c_str());
+			delete [] pPixels;
+			return false;
+		}
+
+		std::vector<RGBQUAD> frame(128 * 128);
+		RGBQUAD key = { 0xff, 0x00, 0xff, 0 };
+
+		for(int f = 0; f < 16; f++)
+		{
+			LONG x0 = f % 4 * 128, y0 = f / 4 * 128;		// top-down
+
+			for(LONG y = 0; y < 128; y++)
+			{
+				// both bottom-up
+				LONG lSrc = (bi.biHeight - 1 - (y0 + y)) * bi.biWidth + x0;
+				RGBQUAD *pDst = &frame[(127 - y) * 128];
+
+				for(LONG x = 0; x < 128; x++)
+					pDst[x] = pMask[lSrc + x].rgbRed ? key : pPixels[lSrc + x];
+			}
+
+			m_Explosion[f].Build(&frame[0], 128, 128, true);
+		}
+
+		delete [] pPixels;
+		delete [] pMask;
+		return true;
+	}
+
+	CRleSprite m_Players[SIM_PLAYERS];
+	CRleSprite m_Cars[ESC_COUNT];
+	CRleSprite m_PowerUps[ESP_COUNT];
+	CRleSprite m_Bullet;
+	CRleSprite m_Explosion[16];
+};
+
+static void Usage()
+{
+	fprintf(stderr, "usage: roadsim [-n steps] [-s seed] [-e] [-r record.input] [-d data_dir] [-f every] [-o frame_dir]\n");
+	fprintf(stderr, "       roadsim -p replay.input [-d data_dir] [-f every] [-o frame_dir]\n");
+	fprintf(stderr, "       roadsim -b cars [-s seed]\n");
+	fprintf(stderr, "       roadsim -t frames [-d data_dir]\n");
+}
+
+// Blit and sprite throughput of the software renderer on a target of the
+// game's screen size
+static bool TimeDrawing(const char *szData, long lFrames)
+{
+	CSimulation sim;
+	CFrameRenderer renderer;
+	LONG lWidth = (LONG)sim.GetConfig().dWidth, lHeight = (LONG)sim.GetConfig().dHeight;
+
+	if(!renderer.Load(szData))
+		return false;
+	renderer.m_Target.Create(lWidth, lHeight);
+
+	// A bottom-up gradient as tall as the screen, scrolled down like the
+	// game's background so both copies are clipped
+	std::vector<RGBQUAD> background(lWidth * lHeight);
+	for(LONG y = 0; y < lHeight; y++)
+	{
+		for(LONG x = 0; x < lWidth; x++)
+		{
+			RGBQUAD q = { (BYTE)x, (BYTE)y, (BYTE)(x ^ y), 0 };
+			background[y * lWidth + x] = q;
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(long f = 0; f < lFrames; f++)
+	{
+		LONG lScroll = (LONG)(f % lHeight);
+		renderer.m_Target.Blit(&background[0], lWidth, lHeight, 0, lScroll - lHeight);
+		renderer.m_Target.Blit(&background[0], lWidth, lHeight, 0, lScroll);
+	}
+	double dBlit = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	size_t uSpritePixels = 0;
+	start = std::chrono::steady_clock::now();
+	for(long f = 0; f < lFrames; f++)
+		uSpritePixels += renderer.DrawEverySprite((int)f);
+	double dSprites = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double dBlitPixels = (double)lWidth * lHeight * lFrames;
+	printf("blit      %ld frames of %ldx%ld in %.3f s, %.0f frames/s, %.0f Mpixels/s\n", lFrames, (long)lWidth, (long)lHeight,
+		dBlit, dBlit > 0 ? lFrames / dBlit : 0.0, dBlit > 0 ? dBlitPixels / dBlit / 1e6 : 0.0);
+	printf("sprites   %ld frames in %.3f s, %.0f frames/s, %.0f Mpixels/s\n", lFrames,
+		dSprites, dSprites > 0 ? lFrames / dSprites : 0.0, dSprites > 0 ? uSpritePixels / dSprites / 1e6 : 0.0);
+	return true;
+}
+
+// Plans nCars cars nBatch at a time on the shipped road, as the game does.
+// False if two cars of a lane are closer than the gap or out of order.
+static bool PlanTraffic(int nCars, int nBatch, uint64_t uSeed, double &dSeconds)
+{
+	static const double dSpacing = 240, dGap = 213 + 40;
+	std::vector<SSimLevel> levels;
+	CSimulation::DefaultLevels(levels);
+
+	CRandom random(uSeed);
+	CTrafficPlan plan;
+	std::vector<STrafficSlot> slots;
+	std::vector<STrafficSlot> all;
+	all.reserve(nCars);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	plan.Start(levels[0].nLanes, dSpacing, dGap);
+	for(int nPlanned = 0; nPlanned < nCars; nPlanned += nBatch)
+	{
+		slots.clear();
+		plan.Plan(random, nCars - nPlanned < nBatch ? nCars - nPlanned : nBatch, slots);
+		all.insert(all.end(), slots.begin(), slots.end());
+	}
+	dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Allow for rounding in the distances
+	std::vector<double> laneLast(levels[0].nLanes, -1e300);
+	for(size_t i = 0; i < all.size(); i++)
+	{
+		if((i && all[i].dDistance < all[i - 1].dDistance) || all[i].dDistance - laneLast[all[i].nLane] < dGap - 1e-6)
+			return false;
+		laneLast[all[i].nLane] = all[i].dDistance;
+	}
+
+	return (int)all.size() == nCars;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long uSteps = (unsigned long)(600 / SIM_STEP);
+	uint64_t uSeed = 1;
+	unsigned long uEvery = 120;
+	const char *szData = "Data";
+	const char *szFrames = NULL;
+	const char *szRecord = NULL;
+	const char *szReplay = NULL;
+	bool bEndless = false;
+	long lBenchCars = 0;
+	long lBenchFrames = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "-n") && i + 1 < argc)
+			uSteps = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(argv[i], "-s") && i + 1 < argc)
+			uSeed = strtoull(argv[++i], NULL, 10);
+		else if(!strcmp(argv[i], "-d") && i + 1 < argc)
+			szData = argv[++i];
+		else if(!strcmp(argv[i], "-f") && i + 1 < argc)
+			uEvery = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(argv[i], "-o") && i + 1 < argc)
+			szFrames = argv[++i];
+		else if(!strcmp(argv[i], "-r") && i + 1 < argc)
+			szRecord = argv[++i];
+		else if(!strcmp(argv[i], "-p") && i + 1 < argc)
+			szReplay = argv[++i];
+		else if(!strcmp(argv[i], "-e"))
+			bEndless = true;
+		else if(!strcmp(argv[i], "-b") && i + 1 < argc)
+			lBenchCars = strtol(argv[++i], NULL, 10);
+		else if(!strcmp(argv[i], "-t") && i + 1 < argc)
+			lBenchFrames = strtol(argv[++i], NULL, 10);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if(!uEvery || (szReplay && (szRecord || bEndless)) || lBenchCars < 0 || lBenchCars > 100000000 || lBenchFrames < 0)
+	{
+		Usage();
+		return 1;
+	}
+
+	if(lBenchFrames)
+		return TimeDrawing(szData, lBenchFrames) ? 0 : 1;
+
+	if(lBenchCars)
+	{
+		int nBatches[] = { (int)lBenchCars, 64 };
+		static const char *szBatches[] = { "at once", "64 at a time" };
+
+		for(int b = 0; b < 2; b++)
+		{
+			double dSeconds;
+			if(!PlanTraffic((int)lBenchCars, nBatches[b], uSeed, dSeconds))
+			{
+				printf("plan      %s: cars out of order or too close\n", szBatches[b]);
+				return 2;
+			}
+			printf("plan      %ld cars %s in %.3f s, %.0f ns a car\n", lBenchCars, szBatches[b], dSeconds,
+				dSeconds * 1e9 / lBenchCars);
+		}
+		return 0;
+	}
+
+	CSimulation sim;
+	CSimBot bot(sim);
+	CSoundCounter sounds;
+	CFrameRenderer renderer;
+	CInputRecorder recorder;
+	CInputReplay replay;
+	SInputLogHeader header;
+
+	if(szReplay)
+	{
+		if(!replay.Open(szReplay, header))
+		{
+			fprintf(stderr, "roadsim: cannot read %s\n", szReplay);
+			return 1;
+		}
+		sim.SetInput(&replay);
+	}
+	else
+	{
+		SLevelFile levels;
+		std::string strError;
+
+		if(!LevelFileLoad((std::string(szData) + "/levels.txt").c_str(), levels, strError))
+		{
+			fprintf(stderr, "roadsim: %s\n", strError.c_str());
+			return 1;
+		}
+		if(bEndless && !levels.endless.bEnabled)
+		{
+			fprintf(stderr, "roadsim: %s/levels.txt has no endless levels\n", szData);
+			return 1;
+		}
+
+		header.uSeed = uSeed;
+		header.config = sim.GetConfig();
+		header.levels = levels.levels;
+		header.endless = levels.endless;
+		header.bFromSave = false;
+
+		// The infinite road is the endless levels alone, as is a file
+		// with nothing else
+		if(bEndless || levels.levels.empty())
+			header.levels.clear();
+		else
+			header.endless.bEnabled = false;
+
+		if(szRecord && !recorder.Open(szRecord, header))
+		{
+			fprintf(stderr, "roadsim: cannot write %s\n", szRecord);
+			return 1;
+		}
+		recorder.SetSource(&bot);
+		sim.SetInput(&recorder);
+	}
+
+	sim.SetAudio(&sounds);
+	InputLogStart(sim, header);
+
+	if(szFrames)
+	{
+		if(!renderer.Load(szData))
+			return 1;
+		renderer.m_Target.Create((LONG)sim.GetConfig().dWidth, (LONG)sim.GetConfig().dHeight);
+	}
+
+	double dRenderTime = 0;
+	size_t uPeakEntities = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	while(szReplay ? !replay.AtEnd() : sim.GetStepCount() < uSteps && sim.GetState() == ESIM_RUNNING)
+	{
+		sim.Step();
+
+		if(sim.GetEntities().GetCount() > uPeakEntities)
+			uPeakEntities = sim.GetEntities().GetCount();
+
+		if(szFrames && sim.GetStepCount() % uEvery == 0)
+		{
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			char szFile[512];
+
+			renderer.m_Target.Clear(0x303030);
+			sim.Render(renderer, 1.0);
+
+			snprintf(szFile, sizeof(szFile), "%s/frame_%08lu.bmp", szFrames, sim.GetStepCount());
+			if(!renderer.m_Target.SaveToFile(szFile))
+			{
+				fprintf(stderr, "roadsim: cannot write %s\n", szFile);
+				return 1;
+			}
+
+			dRenderTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		}
+	}
+
+	double dTotal = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double dSim = dTotal - dRenderTime;
+	unsigned long uRun = sim.GetStepCount();
+	static const char *szStates[] = { "running", "won", "lost" };
+
+	printf("steps     %lu (%.1f s of game time)\n", uRun, uRun * SIM_STEP);
+	printf("sim time  %.3f s, %.0f steps/s, %.0fx real time\n", dSim,
+		dSim > 0 ? uRun / dSim : 0.0, dSim > 0 ? uRun * SIM_STEP / dSim : 0.0);
+	if(szFrames)
+		printf("drawing   %.3f s\n", dRenderTime);
+	if(sim.IsEndless())
+		printf("outcome   %s, level %d of the infinite road\n", szStates[sim.GetState()], sim.GetLevel() + 1);
+	else
+		printf("outcome   %s, level %d of %d\n", szStates[sim.GetState()], sim.GetLevel() + 1, sim.GetLevelCount());
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		const SSimPlayer &p = sim.GetPlayer(n);
+		printf("player %d  score %d, lives %d%s\n", n + 1, p.nScore, p.nLives, p.bDead ? ", out" : "");
+	}
+	printf("entities  %lu at most\n", (unsigned long)uPeakEntities);
+	printf("traffic   %lu lane changes\n", sim.GetTrafficLanes().GetLaneChanges());
+	printf("sounds    %lu explosions, %lu power-ups, %lu shots\n",
+		sounds.m_uCounts[ESS_EXPLOSION], sounds.m_uCounts[ESS_POWERUP], sounds.m_uCounts[ESS_SHOOT]);
+	printf("checksum  %016llx\n", (unsigned long long)sim.GetChecksum());
+
+	if(recorder.IsOpen() && !recorder.Close(uRun, sim.GetChecksum()))
+	{
+		fprintf(stderr, "roadsim: cannot write %s\n", szRecord);
+		return 1;
+	}
+
+	if(szReplay)
+	{
+		unsigned long uEndSteps;
+		uint64_t uEndChecksum;
+
+		if(!replay.GetEnd(uEndSteps, uEndChecksum))
+		{
+			printf("replay    log is cut short, nothing to compare\n");
+		}
+		else if(uEndSteps != uRun || uEndChecksum != sim.GetChecksum())
+		{
+			printf("replay    DIVERGED, recorded %lu steps with checksum %016llx\n", uEndSteps, (unsigned long long)uEndChecksum);
+			return 2;
+		}
+		else
+		{
+			printf("replay    matches the recording\n");
+		}
+	}
+
+	return 0;
+}
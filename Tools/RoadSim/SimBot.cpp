@@ -0,0 +1,57 @@
+// SimBot.cpp
+#include "SimBot.h"
+#include <math.h>
+
+CSimBot::CSimBot(const CSimulation &sim, double dLookAhead) : m_Sim(sim), m_dLookAhead(dLookAhead)
+{
+}
+
+unsigned int CSimBot::GetButtons(int nPlayer)
+{
+	const SSimConfig &config = m_Sim.GetConfig();
+	const SSimPlayer &p = m_Sim.GetPlayer(nPlayer);
+	const CEntityStore &entities = m_Sim.GetEntities();
+	double halfW = config.dPlayerSize[nPlayer][0] / 2;
+	double halfH = config.dPlayerSize[nPlayer][1] / 2;
+	double dThreat = 0, dNearest = 1e9;
+	unsigned int uButtons = SIM_BUTTON_FIRE;
+
+	for(size_t i = 0; i < entities.GetCount(); i++)
+	{
+		if(entities.Kind(i) != EEK_CAR)
+			continue;
+
+		double dGap = (p.y - halfH) - (entities.PosY(i) + entities.HalfHeight(i));
+		double dOverlap = halfW + entities.HalfWidth(i) + 30 - fabs(entities.PosX(i) - p.x);
+		if(dGap > -halfH && dGap < m_dLookAhead && dOverlap > 0 && dGap < dNearest)
+		{
+			dNearest = dGap;
+			dThreat = entities.PosX(i);
+		}
+	}
+
+	double dTargetVX = 0;
+	if(dNearest < 1e9)
+	{
+		// Away from the car, unless the road ends on that side
+		bool bLeft = dThreat > p.x;
+		if(bLeft && p.x - halfW < 300)
+			bLeft = false;
+		else if(!bLeft && p.x + halfW > config.dWidth - 240)
+			bLeft = true;
+		dTargetVX = bLeft ? -300 : 300;
+	}
+
+	if(p.vx > dTargetVX)
+		uButtons |= SIM_BUTTON_LEFT;
+	else if(p.vx < dTargetVX)
+		uButtons |= SIM_BUTTON_RIGHT;
+
+	// Hold the height it has
+	if(p.vy > 0)
+		uButtons |= SIM_BUTTON_UP;
+	else if(p.vy < 0)
+		uButtons |= SIM_BUTTON_DOWN;
+
+	return uButtons;
+}
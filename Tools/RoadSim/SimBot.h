@@ -0,0 +1,19 @@
+#pragma once
+// SimBot.h
+// Stand-in player for the command line tools. Presses buttons the way a
+// cautious player would: dodges the nearest car coming down its lane,
+// otherwise slows down, and keeps firing.
+#include "Simulation.h"
+
+class CSimBot : public CSimInput
+{
+public:
+	// Cars closer than dLookAhead pixels above a player are dodged
+	explicit CSimBot(const CSimulation &sim, double dLookAhead = 450);
+
+	unsigned int GetButtons(int nPlayer);
+
+private:
+	const CSimulation &m_Sim;
+	double m_dLookAhead;
+};
@@ -0,0 +1,340 @@
+// RoadSweep.cpp
+// Balance sweep: plays many seeded games of each level configuration with
+// the bot (SimBot.h) on every core, and reports how each configuration
+// plays: how often it is cleared, how long players survive, how often they
+// crash and what they score.
+//
+// Build (any platform, from the repository root):
+//	g++ -std=c++14 -O2 -pthread -IIncludes -ITools/RoadSim Tools/RoadSweep/RoadSweep.cpp Tools/RoadSim/SimBot.cpp Source/Simulation.cpp Source/TrafficPlan.cpp Source/TrafficLanes.cpp Source/LevelFile.cpp Source/EntityStore.cpp Source/BroadPhase.cpp -o roadsweep
+//
+// Usage:
+//	roadsweep [-d data_dir] [-l level] [-c cars] [-v speed] [-n runs] [-m max_seconds] [-s seed] [-j threads] [-o results.csv]
+//
+// The levels come from <data_dir>/levels.txt. -c and -v take a value or a
+// from:to:step range, the sweep runs every combination for the level given
+// with -l. Without them the level keeps the values of the file, without -l
+// every level of the file is run as it is. A grid with a configuration the
+// game cannot play (see CSimulation::CheckLevel) is refused.
+// Each run starts the level with full lives and ends when it is cleared,
+// when both players are out or after -m seconds of game time. Run r of
+// every configuration uses seed -s + r, so configurations are compared on
+// the same traffic draws.
+#include "Simulation.h"
+#include "SimBot.h"
+#include "LevelFile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+struct SSweepConfig
+{
+	int nLevel;					// 0-based
+	SSimLevel level;
+};
+
+struct SRunResult
+{
+	bool bCleared;
+	bool bLost;
+	float fTime;					// seconds until the run ended
+	float fAlive[SIM_PLAYERS];		// seconds until the player was out
+	int nScore[SIM_PLAYERS];
+	int nCrashes;
+};
+
+// from:to:step, or a single value
+static bool ParseRange(const char *szArg, std::vector<int> &values)
+{
+	int nFrom, nTo, nStep = 1;
+	int n = sscanf(szArg, "%d:%d:%d", &nFrom, &nTo, &nStep);
+
+	if(n == 1)
+		nTo = nFrom;
+	else if(n < 2 || nStep <= 0 || nTo < nFrom)
+		return false;
+
+	values.clear();
+	for(int v = nFrom; v <= nTo; v += nStep)
+		values.push_back(v);
+	return true;
+}
+
+static void PlayRun(CSimulation &sim, CSimBot &bot, const std::vector<SSimLevel> &base, const SSweepConfig &config,
+	uint64_t uSeed, unsigned long uMaxSteps, SRunResult &result)
+{
+	std::vector<SSimLevel> levels = base;
+	levels[config.nLevel] = config.level;
+	sim.SetLevels(levels);
+	sim.SetInput(&bot);
+	sim.NewGame(uSeed, config.nLevel);
+
+	bool bOut[SIM_PLAYERS] = {};
+	for(int n = 0; n < SIM_PLAYERS; n++)
+		result.fAlive[n] = 0;
+
+	while(sim.GetStepCount() < uMaxSteps && sim.GetState() == ESIM_RUNNING && sim.GetLevel() == config.nLevel)
+	{
+		sim.Step();
+
+		for(int n = 0; n < SIM_PLAYERS; n++)
+		{
+			if(!bOut[n] && sim.GetPlayer(n).nLives <= 0)
+			{
+				bOut[n] = true;
+				result.fAlive[n] = (float)(sim.GetStepCount() * SIM_STEP);
+			}
+		}
+	}
+
+	result.fTime = (float)(sim.GetStepCount() * SIM_STEP);
+	result.bCleared = sim.GetState() == ESIM_WON || sim.GetLevel() != config.nLevel;
+	result.bLost = sim.GetState() == ESIM_LOST;
+	result.nCrashes = 0;
+
+	for(int n = 0; n < SIM_PLAYERS; n++)
+	{
+		if(!bOut[n])
+			result.fAlive[n] = result.fTime;
+		result.nScore[n] = sim.GetPlayer(n).nScore;
+		result.nCrashes += sim.GetPlayer(n).nCrashes;
+	}
+}
+
+// Value at fraction p of the sorted values
+template <class T>
+static T Percentile(std::vector<T> &values, double p)
+{
+	if(values.empty())
+		return T();
+
+	std::sort(values.begin(), values.end());
+	return values[(size_t)(p * (values.size() - 1) + 0.5)];
+}
+
+static void Usage()
+{
+	fprintf(stderr, "usage: roadsweep [-d data_dir] [-l level] [-c cars] [-v speed] [-n runs] [-m max_seconds] [-s seed] [-j threads] [-o results.csv]\n");
+	fprintf(stderr, "       cars and speed: value or from:to:step\n");
+}
+
+int main(int argc, char **argv)
+{
+	int nLevel = -1;
+	std::vector<int> cars, speeds;
+	unsigned long uRuns = 1000;
+	double dMaxSeconds = 300;
+	uint64_t uSeed = 1;
+	unsigned int uThreads = std::thread::hardware_concurrency();
+	const char *szCsv = NULL;
+	const char *szData = "Data";
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool bOk = i + 1 < argc;
+
+		if(bOk && !strcmp(argv[i], "-d"))
+			szData = argv[++i];
+		else if(bOk && !strcmp(argv[i], "-l"))
+			nLevel = atoi(argv[++i]) - 1;
+		else if(bOk && !strcmp(argv[i], "-c"))
+			bOk = ParseRange(argv[++i], cars);
+		else if(bOk && !strcmp(argv[i], "-v"))
+			bOk = ParseRange(argv[++i], speeds);
+		else if(bOk && !strcmp(argv[i], "-n"))
+			uRuns = strtoul(argv[++i], NULL, 10);
+		else if(bOk && !strcmp(argv[i], "-m"))
+			dMaxSeconds = atof(argv[++i]);
+		else if(bOk && !strcmp(argv[i], "-s"))
+			uSeed = strtoull(argv[++i], NULL, 10);
+		else if(bOk && !strcmp(argv[i], "-j"))
+			uThreads = (unsigned int)strtoul(argv[++i], NULL, 10);
+		else if(bOk && !strcmp(argv[i], "-o"))
+			szCsv = argv[++i];
+		else
+			bOk = false;
+
+		if(!bOk)
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	SLevelFile file;
+	std::string strError;
+	if(!LevelFileLoad((std::string(szData) + "/levels.txt").c_str(), file, strError))
+	{
+		fprintf(stderr, "roadsweep: %s\n", strError.c_str());
+		return 1;
+	}
+
+	const std::vector<SSimLevel> &levels = file.levels;
+
+	if(nLevel >= (int)levels.size() || (nLevel < 0 && (!cars.empty() || !speeds.empty())) || !uRuns || dMaxSeconds <= 0)
+	{
+		Usage();
+		return 1;
+	}
+
+	if(!uThreads)
+		uThreads = 1;
+
+	// The grid
+	std::vector<SSweepConfig> configs;
+	for(int l = 0; l < (int)levels.size(); l++)
+	{
+		if(nLevel >= 0 && l != nLevel)
+			continue;
+
+		std::vector<int> levelCars = cars.empty() ? std::vector<int>(1, levels[l].nCars) : cars;
+		std::vector<int> levelSpeeds = speeds.empty() ? std::vector<int>(1, levels[l].nVelocity) : speeds;
+
+		for(size_t c = 0; c < levelCars.size(); c++)
+		{
+			for(size_t v = 0; v < levelSpeeds.size(); v++)
+			{
+				SSweepConfig config;
+				config.nLevel = l;
+				config.level = levels[l];
+				config.level.nCars = levelCars[c];
+				config.level.nVelocity = levelSpeeds[v];
+
+				// No cars, no speed and the like cannot be played
+				if(!CSimulation::CheckLevel(config.level))
+				{
+					fprintf(stderr, "roadsweep: level %d cannot be played with %d cars at speed %d\n",
+						l + 1, config.level.nCars, config.level.nVelocity);
+					Usage();
+					return 1;
+				}
+
+				configs.push_back(config);
+			}
+		}
+	}
+
+	if(configs.empty())
+	{
+		Usage();
+		return 1;
+	}
+
+	// Every run is a job, workers take the next one until none is left
+	size_t uJobs = configs.size() * uRuns;
+	std::vector<SRunResult> results(uJobs);
+	std::atomic<size_t> nextJob(0);
+	unsigned long uMaxSteps = (unsigned long)(dMaxSeconds / SIM_STEP);
+
+	fprintf(stderr, "roadsweep: %lu runs of %lu configurations on %u threads\n",
+		(unsigned long)uJobs, (unsigned long)configs.size(), uThreads);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for(unsigned int t = 0; t < uThreads; t++)
+	{
+		workers.push_back(std::thread([&]()
+		{
+			CSimulation sim;
+			CSimBot bot(sim);
+
+			for(size_t j = nextJob++; j < uJobs; j = nextJob++)
+				PlayRun(sim, bot, levels, configs[j / uRuns], uSeed + j % uRuns, uMaxSteps, results[j]);
+		}));
+	}
+	for(size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	double dElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double dGameTime = 0;
+	for(size_t j = 0; j < uJobs; j++)
+		dGameTime += results[j].fTime;
+
+	fprintf(stderr, "roadsweep: %.1f s, %.0f runs/s, %.0f hours of play\n",
+		dElapsed, uJobs / dElapsed, dGameTime / 3600);
+
+	FILE *pCsv = NULL;
+	if(szCsv)
+	{
+		pCsv = fopen(szCsv, "w");
+		if(!pCsv)
+		{
+			fprintf(stderr, "roadsweep: cannot write %s\n", szCsv);
+			return 1;
+		}
+		fprintf(pCsv, "level,cars,speed,runs,cleared,lost,clear_time_p50,alive_p10,alive_p50,alive_mean,crashes_per_min,score_mean,score_p10,score_p50,score_p90\n");
+	}
+
+	printf("level  cars speed | cleared   lost  clear s |  alive s p10   p50  mean | crash/min |  score mean   p10   p50   p90\n");
+
+	for(size_t c = 0; c < configs.size(); c++)
+	{
+		const SSweepConfig &config = configs[c];
+		const SRunResult *pRuns = &results[c * uRuns];
+		std::vector<float> clearTimes, alive;
+		std::vector<int> scores;
+		unsigned long uCleared = 0, uLost = 0, uCrashes = 0;
+		double dAliveSum = 0, dScoreSum = 0;
+
+		for(unsigned long r = 0; r < uRuns; r++)
+		{
+			const SRunResult &run = pRuns[r];
+
+			if(run.bCleared)
+			{
+				uCleared++;
+				clearTimes.push_back(run.fTime);
+			}
+			if(run.bLost)
+				uLost++;
+			uCrashes += run.nCrashes;
+
+			for(int n = 0; n < SIM_PLAYERS; n++)
+			{
+				alive.push_back(run.fAlive[n]);
+				scores.push_back(run.nScore[n]);
+				dAliveSum += run.fAlive[n];
+				dScoreSum += run.nScore[n];
+			}
+		}
+
+		double dCleared = 100.0 * uCleared / uRuns;
+		double dLost = 100.0 * uLost / uRuns;
+		double dClearTime = Percentile(clearTimes, 0.5);
+		double dAliveP10 = Percentile(alive, 0.1);
+		double dAliveP50 = Percentile(alive, 0.5);
+		double dAliveMean = dAliveSum / alive.size();
+		double dCrashRate = dAliveSum > 0 ? uCrashes / (dAliveSum / 60) : 0;
+		double dScoreMean = dScoreSum / scores.size();
+		int nScoreP10 = Percentile(scores, 0.1);
+		int nScoreP50 = Percentile(scores, 0.5);
+		int nScoreP90 = Percentile(scores, 0.9);
+
+		printf("%5d %5d %5d | %6.1f%% %5.1f%% %8.1f | %11.1f %5.1f %5.1f | %9.2f | %11.0f %5d %5d %5d\n",
+			config.nLevel + 1, config.level.nCars, config.level.nVelocity,
+			dCleared, dLost, dClearTime, dAliveP10, dAliveP50, dAliveMean, dCrashRate,
+			dScoreMean, nScoreP10, nScoreP50, nScoreP90);
+
+		if(pCsv)
+		{
+			fprintf(pCsv, "%d,%d,%d,%lu,%.4f,%.4f,%.2f,%.2f,%.2f,%.2f,%.4f,%.1f,%d,%d,%d\n",
+				config.nLevel + 1, config.level.nCars, config.level.nVelocity, uRuns,
+				dCleared / 100, dLost / 100, dClearTime, dAliveP10, dAliveP50, dAliveMean, dCrashRate,
+				dScoreMean, nScoreP10, nScoreP50, nScoreP90);
+		}
+	}
+
+	if(pCsv && fclose(pCsv) != 0)
+	{
+		fprintf(stderr, "roadsweep: cannot write %s\n", szCsv);
+		return 1;
+	}
+
+	return 0;
+}